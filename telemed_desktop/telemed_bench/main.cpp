@@ -0,0 +1,689 @@
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QDir>
+#include <QElapsedTimer>
+#include <QFileInfo>
+#include <QTemporaryDir>
+#include <QThread>
+#include <QThreadPool>
+#include <QTextStream>
+#include <algorithm>
+#include <functional>
+#include <memory>
+#include <random>
+#include <utility>
+#include <vector>
+#include <nlohmann/json.h>
+#include "Clock.h"
+#include "Data.h"
+#include "DataWorker.h"
+#include "DeviceApi.h"
+#include "DualBiquadCascade.h"
+#include "MAX30100_BeatDetector.h"
+#include "SessionArchive.h"
+#include "StreamingTrimmedMean.h"
+#include "SyntheticPpg.h"
+#include "TextExporter.h"
+
+namespace {
+	auto constexpr FRAME_SIZE = 100;			// samples received in one polling period
+	auto constexpr CHUNK_SECONDS = 60;			// signal generated at once, outside of the measured time
+	auto constexpr MIN_MEASURED_NS = 200000000;	// short sessions are repeated at least this long
+	auto constexpr GETTER_CALLS = 1000;
+	auto constexpr HR_QUANTILE_N = 10;
+	auto constexpr PLOT_POINTS = 3840;			// two points per pixel of a 1920 px wide plot
+	auto constexpr HR_PER_REFRESH = 2;			// heart rate values appended between plot refreshes
+	auto constexpr DEFAULT_CONCURRENT_SECONDS = 600;
+	const qint64 CLOCK_START_MS = 1600000000000;
+	const int DEVICE_COUNTS[] = { 1, 8, 32 };
+	// all benchmarks run by benchData, which fills Data only when one of them is enabled
+	const char * const DATA_BENCHMARKS[] = {
+		"data_ingest", "get_data_min_max", "get_sensor_data_10s", "get_sensor_data_full", "get_plot_data_10s",
+		"get_plot_data_full", "get_hr_plot_delta", "save_as", "save_csv", "save_ndjson", "save_archive", "load_archive"
+	};
+
+	/**
+	 * Parametry sygnału syntetycznego.
+	 */
+	struct SignalConfig {
+		double heartRate = 72.0;
+		double noiseLevel = 25.0;
+		double artifactsPerMinute = 0.0;
+		double artifactAmplitude = 3000.0;
+	};
+
+	/**
+	 * Wynik pojedynczego pomiaru.
+	 */
+	struct Measurement {
+		qint64 ops = 0;		// measured operations, e.g. frames or calls
+		qint64 items = 0;	// processed samples or returned points
+		qint64 ns = 0;
+
+		Measurement & operator+=(const Measurement & other) {
+			ops += other.ops;
+			items += other.items;
+			ns += other.ns;
+			return *this;
+		}
+	};
+
+	/**
+	 * Zapisuje wyniki w formacie NDJSON, jeden obiekt na pomiar.
+	 */
+	class Reporter {
+		QTextStream out{ stdout };
+		std::string label;
+
+	public:
+		Reporter(const QString & label_) : label(label_.toStdString()) {}
+
+		void report(const std::string & benchmark, int sessionSeconds, const Measurement & m,
+			const nlohmann::json & extra = nlohmann::json::object())
+		{
+			auto record = nlohmann::json::object();
+			if (!label.empty())
+				record["label"] = label;
+			record["benchmark"] = benchmark;
+			record["session_s"] = sessionSeconds;
+			record["ops"] = m.ops;
+			record["items"] = m.items;
+			record["ns"] = m.ns;
+			record["ns_per_op"] = m.ops > 0 ? double(m.ns) / m.ops : 0.0;
+			record["items_per_s"] = m.ns > 0 ? m.items * 1e9 / m.ns : 0.0;
+			record.update(extra);
+			out << QString::fromStdString(record.dump()) << "\n";
+			out.flush();
+		}
+
+		void skip(const std::string & benchmark, int sessionSeconds, const std::string & reason) {
+			auto record = nlohmann::json::object();
+			if (!label.empty())
+				record["label"] = label;
+			record["benchmark"] = benchmark;
+			record["session_s"] = sessionSeconds;
+			record["skipped"] = reason;
+			out << QString::fromStdString(record.dump()) << "\n";
+			out.flush();
+		}
+	};
+
+	SyntheticPpg makeGenerator(const SignalConfig & config, unsigned int seed = 0) {
+		SyntheticPpg ppg(config.heartRate, seed);
+		ppg.setNoiseLevel(config.noiseLevel);
+		ppg.setMotionArtifacts(config.artifactsPerMinute, config.artifactAmplitude);
+		return ppg;
+	}
+
+	/**
+	 * Generuje sygnał sesji porcjami, aby 24 godziny sygnału nie musiały mieścić się w pamięci.
+	 */
+	void forEachChunk(const SignalConfig & config, int sessionSeconds,
+		const std::function<void(const std::vector<SensorFrame> &)> & fn)
+	{
+		auto ppg = makeGenerator(config);
+		std::vector<SensorFrame> frames;
+		for (int s = 0; s < sessionSeconds; s += CHUNK_SECONDS) {
+			frames.clear();
+			auto seconds = std::min(CHUNK_SECONDS, sessionSeconds - s);
+			for (int f = 0; f < seconds * SAMPLING_RATE / FRAME_SIZE; ++f)
+				frames.push_back(ppg.nextFrame(FRAME_SIZE));
+			fn(frames);
+		}
+	}
+
+	/**
+	 * Powtarza pomiar krótkich sesji, aż łączny czas pomiaru będzie wystarczający.
+	 */
+	Measurement repeat(const std::function<Measurement()> & fn) {
+		Measurement total;
+		do {
+			total += fn();
+		} while (total.ns < MIN_MEASURED_NS);
+		return total;
+	}
+
+	std::string toJson(const SensorFrame & frame) {
+		auto rows = nlohmann::json::array();
+		auto seq = frame.getSeq();
+		for (auto & sample : frame.getSamples())
+			rows.push_back({ { "seq", seq++ }, { "ms", sample.getMs() },
+				{ "ir", sample.getIrLed() }, { "red", sample.getRedLed() } });
+		return rows.dump();
+	}
+
+	/**
+	 * Filtruje sygnał poza mierzonym czasem, aby zmierzyć sam detektor uderzeń.
+	 */
+	std::vector<SensorFrame> filtered(SignalPipeline & pipeline, const std::vector<SensorFrame> & frames) {
+		std::vector<SensorFrame> result;
+		for (auto & frame : frames) {
+			ProcessedBatch batch;
+			pipeline.process(frame, 0, batch);
+			result.emplace_back(frame.getSeq(), std::move(batch.samples));
+		}
+		return result;
+	}
+
+	Measurement benchParseJson(const SignalConfig & config, int sessionSeconds) {
+		Measurement m;
+		forEachChunk(config, sessionSeconds, [&m](const std::vector<SensorFrame> & frames) {
+			std::vector<std::string> payloads;
+			for (auto & frame : frames)
+				payloads.push_back(toJson(frame));
+			SensorFrame frame;
+			QElapsedTimer timer;
+			timer.start();
+			for (auto & payload : payloads) {
+				SensorFrame::fromJson(payload, frame);
+				m.items += frame.size();
+			}
+			m.ns += timer.nsecsElapsed();
+			m.ops += payloads.size();
+		});
+		return m;
+	}
+
+	Measurement benchParseBinary(const SignalConfig & config, int sessionSeconds) {
+		Measurement m;
+		forEachChunk(config, sessionSeconds, [&m](const std::vector<SensorFrame> & frames) {
+			std::vector<QByteArray> payloads;
+			for (auto & frame : frames)
+				payloads.push_back(frame.toBinary());
+			SensorFrame frame;
+			QElapsedTimer timer;
+			timer.start();
+			for (auto & payload : payloads) {
+				SensorFrame::fromBinary(payload, frame);
+				m.items += frame.size();
+			}
+			m.ns += timer.nsecsElapsed();
+			m.ops += payloads.size();
+		});
+		return m;
+	}
+
+	Measurement benchBeatDetector(const SignalConfig & config, int sessionSeconds, qint64 & beats) {
+		Measurement m;
+		SignalPipeline filter;
+		BeatDetector detector;
+		forEachChunk(config, sessionSeconds, [&](const std::vector<SensorFrame> & frames) {
+			auto input = filtered(filter, frames);
+			QElapsedTimer timer;
+			timer.start();
+			for (auto & frame : input) {
+				for (auto & sample : frame.getSamples())
+					beats += detector.addSample(sample.getMs(), float(sample.getIrLed()));
+				m.items += frame.size();
+			}
+			m.ns += timer.nsecsElapsed();
+		});
+		m.ops = m.items;
+		return m;
+	}
+
+	/**
+	 * Detekcja pulsu wraz ze średnią obciętą (dawniej Data::detectHeartRate), bez filtracji.
+	 */
+	Measurement benchDetectHeartRate(const SignalConfig & config, int sessionSeconds, qint64 & heartRates) {
+		Measurement m;
+		SignalPipeline filter;
+		SignalPipeline pipeline(HR_QUANTILE_N);
+		pipeline.setFilteringEnabled(false);
+		forEachChunk(config, sessionSeconds, [&](const std::vector<SensorFrame> & frames) {
+			auto input = filtered(filter, frames);
+			ProcessedBatch batch;
+			QElapsedTimer timer;
+			timer.start();
+			for (auto & frame : input) {
+				pipeline.process(frame, CLOCK_START_MS, batch);
+				heartRates += batch.heartRates.size();
+			}
+			m.ns += timer.nsecsElapsed();
+			m.ops += input.size();
+			m.items += input.size() * FRAME_SIZE;
+		});
+		return m;
+	}
+
+	/**
+	 * Filtracja pasmowoprzepustowa obu diod: dwa obiekty iir1 próbka po próbce albo DualBiquadCascade paczkami.
+	 */
+	Measurement benchBandPass(const SignalConfig & config, int sessionSeconds, bool block, qint64 & checksum) {
+		Measurement m;
+		Iir::Butterworth::BandPass<FILTER_ORDER> irFilter, redFilter;
+		for (auto filter : { &irFilter, &redFilter })
+			filter->setup(SAMPLING_RATE, (LOW_CUT_FREQ + HIGH_CUT_FREQ) / 2, (HIGH_CUT_FREQ - LOW_CUT_FREQ));
+		DualBiquadCascade cascade;
+		cascade.setup(irFilter);
+		std::vector<double> ir, red;
+		forEachChunk(config, sessionSeconds, [&](const std::vector<SensorFrame> & frames) {
+			QElapsedTimer timer;
+			timer.start();
+			for (auto & frame : frames) {
+				if (block) {
+					ir.clear();
+					red.clear();
+					for (auto & sample : frame.getSamples()) {
+						ir.push_back(sample.getIrLed());
+						red.push_back(sample.getRedLed());
+					}
+					cascade.filter(ir.data(), red.data(), ir.size());
+					for (size_t i = 0; i < ir.size(); ++i)
+						checksum += int(ir[i]) + int(red[i]);
+				}
+				else {
+					for (auto & sample : frame.getSamples())
+						checksum += int(irFilter.filter(sample.getIrLed())) + int(redFilter.filter(sample.getRedLed()));
+				}
+			}
+			m.ns += timer.nsecsElapsed();
+			m.ops += frames.size();
+			m.items += frames.size() * FRAME_SIZE;
+		});
+		return m;
+	}
+
+	Measurement benchPipeline(const SignalConfig & config, int sessionSeconds, qint64 & heartRates) {
+		Measurement m;
+		SignalPipeline pipeline(HR_QUANTILE_N);
+		forEachChunk(config, sessionSeconds, [&](const std::vector<SensorFrame> & frames) {
+			ProcessedBatch batch;
+			QElapsedTimer timer;
+			timer.start();
+			for (auto & frame : frames) {
+				pipeline.process(frame, CLOCK_START_MS, batch);
+				heartRates += batch.heartRates.size();
+			}
+			m.ns += timer.nsecsElapsed();
+			m.ops += frames.size();
+			m.items += frames.size() * FRAME_SIZE;
+		});
+		return m;
+	}
+
+	/**
+	 * Średnia obcięta N ostatnich wartości pulsu (dawniej Data::quantileMean), liczona po każdym uderzeniu.
+	 */
+	Measurement benchQuantileMean(const SignalConfig & config, int sessionSeconds, double & lastMean) {
+		std::mt19937 rng(0);
+		std::normal_distribution<double> hr(config.heartRate, 3.0);
+		std::vector<double> values(size_t(sessionSeconds * config.heartRate / 60.0));
+		for (auto & value : values)
+			value = hr(rng);
+
+		Measurement m;
+		StreamingTrimmedMean mean(HR_QUANTILE_N, QUANTILE_TRIM_FRACTION);
+		QElapsedTimer timer;
+		timer.start();
+		for (auto value : values) {
+			mean.push(value);
+			lastMean = mean.mean();
+		}
+		m.ns = timer.nsecsElapsed();
+		m.ops = m.items = values.size();
+		return m;
+	}
+
+	/**
+	 * Data z dostępem do slotu odbierającego paczki w formacie JSON.
+	 */
+	class BenchData : public Data {
+	public:
+		using Data::Data;
+		using Data::processNewData;
+	};
+
+	/**
+	 * Pomiary wymagające pełnego obiektu Data, wypełnianego sygnałem całej sesji.
+	 */
+	void benchData(const SignalConfig & config, int sessionSeconds, const QString & xlsxDir,
+		const std::function<bool(const QString &)> & enabled, Reporter & reporter)
+	{
+		DeviceApi devApi(nullptr);
+		VirtualClock clock;
+		clock.set(CLOCK_START_MS);
+		BenchData data(&devApi, nullptr);
+		data.setClock(&clock);
+		data.setHeartRateQuantileN(HR_QUANTILE_N);
+		data.setIrLedEnabled(true);
+		data.setRedLedEnabled(true);
+		data.setHearRateEnabled(true);
+
+		double receivedMs = 0.0;
+		QObject::connect(&data, &Data::receivedNewData, [&data, &receivedMs]() {
+			receivedMs = data.getLastSensorDataCustomPlotMs();
+		});
+
+		// processNewData: parse, filtering and detection in the worker, insert in the GUI thread
+		Measurement ingest;
+		qint64 firstFrameMs = -1;
+		forEachChunk(config, sessionSeconds, [&](const std::vector<SensorFrame> & frames) {
+			std::vector<QString> payloads;
+			for (auto & frame : frames)
+				payloads.push_back(QString::fromStdString(toJson(frame)));
+			if (firstFrameMs < 0)
+				firstFrameMs = frames.front().getSamples().back().getMs();
+			auto lastMs = Data::msToCustomPlotMs(
+				CLOCK_START_MS - firstFrameMs + frames.back().getSamples().back().getMs());
+
+			QElapsedTimer timer;
+			timer.start();
+			for (auto & payload : payloads)
+				data.processNewData(payload);
+			while (receivedMs < lastMs)
+				QCoreApplication::processEvents();
+			ingest.ns += timer.nsecsElapsed();
+			ingest.ops += frames.size();
+			ingest.items += frames.size() * FRAME_SIZE;
+		});
+		if (enabled("data_ingest"))
+			reporter.report("data_ingest", sessionSeconds, ingest);
+
+		if (enabled("get_data_min_max")) {
+			volatile double sink = 0.0;
+			auto m = repeat([&]() {
+				Measurement m;
+				QElapsedTimer timer;
+				timer.start();
+				for (int i = 0; i < GETTER_CALLS; ++i)
+					sink = data.getDataMinMax(10).second;
+				m.ns = timer.nsecsElapsed();
+				m.ops = m.items = GETTER_CALLS;
+				return m;
+			});
+			reporter.report("get_data_min_max", sessionSeconds, m);
+		}
+
+		// the heart rate graph gets the values of the last second on every refresh
+		if (enabled("get_hr_plot_delta")) {
+			auto count = data.getHeartRateCount();
+			auto from = count - std::min<size_t>(count, HR_PER_REFRESH);
+			auto m = repeat([&]() {
+				Measurement m;
+				QElapsedTimer timer;
+				timer.start();
+				for (int i = 0; i < GETTER_CALLS; ++i) {
+					auto x = data.getXHRData(from);
+					auto y = data.getYHRData(from);
+					m.items += x.size() + y.size();
+				}
+				m.ns = timer.nsecsElapsed();
+				m.ops = GETTER_CALLS;
+				return m;
+			});
+			reporter.report("get_hr_plot_delta", sessionSeconds, m);
+		}
+
+		// the plot reads the visible window, the export and zooming out read everything
+		auto lastMs = data.getLastSensorDataCustomPlotMs();
+		const std::pair<const char *, double> ranges[] = {
+			{ "get_sensor_data_10s", lastMs - 10.0 },
+			{ "get_sensor_data_full", -1.0 },
+		};
+		for (auto & range : ranges) {
+			if (!enabled(range.first))
+				continue;
+			auto m = repeat([&]() {
+				Measurement m;
+				QElapsedTimer timer;
+				timer.start();
+				auto x = data.getXSensorData(range.second);
+				auto ir = data.getYIrSensorData(range.second);
+				auto red = data.getYRedSensorData(range.second);
+				m.ns = timer.nsecsElapsed();
+				m.ops = 1;
+				m.items = x.size() + ir.size() + red.size();
+				return m;
+			});
+			reporter.report(range.first, sessionSeconds, m);
+		}
+
+		// what the plot actually gets after min/max decimation
+		const std::pair<const char *, double> plotRanges[] = {
+			{ "get_plot_data_10s", lastMs - 10.0 },
+			{ "get_plot_data_full", Data::msToCustomPlotMs(CLOCK_START_MS) },
+		};
+		for (auto & range : plotRanges) {
+			if (!enabled(range.first))
+				continue;
+			int level = -1;
+			auto m = repeat([&]() {
+				Measurement m;
+				QElapsedTimer timer;
+				timer.start();
+				auto plotData = data.getSensorPlotData(range.second, lastMs, PLOT_POINTS);
+				m.ns = timer.nsecsElapsed();
+				m.ops = 1;
+				m.items = plotData.x.size() + plotData.ir.size() + plotData.red.size();
+				level = plotData.level;
+				return m;
+			});
+			reporter.report(range.first, sessionSeconds, m, { { "level", level } });
+		}
+
+		auto rows = qint64(sessionSeconds) * SAMPLING_RATE + 1;
+		QTemporaryDir tmpDir;
+		auto dir = xlsxDir.isEmpty() ? tmpDir.path() : xlsxDir;
+		if (enabled("save_as")) {
+			auto path = QDir(dir).filePath(QString("telemed_bench_%1.xlsx").arg(sessionSeconds));
+			Measurement m;
+			QElapsedTimer timer;
+			timer.start();
+			data.saveAs(path);
+			m.ns = timer.nsecsElapsed();
+			m.ops = 1;
+			m.items = rows - 1;
+			reporter.report("save_as", sessionSeconds, m);
+		}
+
+		for (auto & text : { std::make_pair("save_csv", TextExporter::CSV),
+			std::make_pair("save_ndjson", TextExporter::NDJSON) })
+		{
+			if (!enabled(text.first))
+				continue;
+			auto suffix = text.second == TextExporter::CSV ? "csv" : "ndjson";
+			auto path = QDir(dir).filePath(QString("telemed_bench_%1.%2").arg(sessionSeconds).arg(suffix));
+			auto snapshot = data.snapshot();
+			Measurement m;
+			QElapsedTimer timer;
+			timer.start();
+			TextExporter::write(snapshot, path, text.second);
+			m.ns = timer.nsecsElapsed();
+			m.ops = 1;
+			m.items = rows - 1;
+			reporter.report(text.first, sessionSeconds, m, {
+				{ "bytes", QFileInfo(path).size() + QFileInfo(TextExporter::heartRatePath(path)).size()
+					+ QFileInfo(TextExporter::spo2Path(path)).size() }
+			});
+		}
+
+		auto archivePath = QDir(dir).filePath(QString("telemed_bench_%1.tmarc").arg(sessionSeconds));
+		if (enabled("save_archive") || enabled("load_archive")) {
+			Measurement m;
+			QElapsedTimer timer;
+			timer.start();
+			SessionArchiveWriter::write(data.snapshot(), archivePath);
+			m.ns = timer.nsecsElapsed();
+			m.ops = 1;
+			m.items = rows - 1;
+			if (enabled("save_archive"))
+				reporter.report("save_archive", sessionSeconds, m);
+		}
+		if (enabled("load_archive")) {
+			Measurement m;
+			QElapsedTimer timer;
+			timer.start();
+			SessionArchiveReader reader;
+			DataSnapshot loaded;
+			if (reader.open(archivePath))
+				reader.read(loaded);
+			m.ns = timer.nsecsElapsed();
+			m.ops = 1;
+			m.items = qint64(loaded.sensorData.size());
+			reporter.report("load_archive", sessionSeconds, m);
+		}
+	}
+
+	/**
+	 * Symulowany moduł WiFi wraz z sesją przetwarzania.
+	 */
+	struct SimulatedDevice {
+		BatchQueue queue;
+		std::unique_ptr<DataWorker> worker;
+		std::vector<SensorFrame> frames;
+	};
+
+	/**
+	 * Przepustowość wielu sesji dzielących globalną pulę wątków.
+	 */
+	Measurement benchConcurrentSessions(const SignalConfig & config, int deviceCount, int seconds) {
+		std::vector<std::unique_ptr<SimulatedDevice>> devices;
+		size_t expected = 0;
+		for (int i = 0; i < deviceCount; ++i) {
+			auto device = std::make_unique<SimulatedDevice>();
+			device->worker = std::make_unique<DataWorker>(&device->queue, QThreadPool::globalInstance());
+			auto deviceConfig = config;
+			deviceConfig.heartRate = 60.0 + i % 40;
+			auto ppg = makeGenerator(deviceConfig, unsigned(i));
+			for (int s = 0; s < seconds * SAMPLING_RATE / FRAME_SIZE; ++s) {
+				device->frames.push_back(ppg.nextFrame(FRAME_SIZE));
+				expected += FRAME_SIZE;
+			}
+			devices.push_back(std::move(device));
+		}
+
+		QElapsedTimer timer;
+		timer.start();
+
+		// frames of all devices arrive interleaved, like responses of concurrent requests
+		for (size_t f = 0; f < devices.front()->frames.size(); ++f) {
+			for (auto & device : devices)
+				device->worker->process(device->frames[f], 0, 0);
+		}
+
+		size_t consumed = 0;
+		ProcessedBatch batch;
+		while (consumed < expected) {
+			bool received = false;
+			for (auto & device : devices) {
+				while (device->queue.pop(batch)) {
+					consumed += batch.samples.size();
+					received = true;
+				}
+				device->worker->resume();
+			}
+			if (!received)
+				QThread::yieldCurrentThread();
+		}
+
+		Measurement m;
+		m.ns = timer.nsecsElapsed();
+		for (auto & device : devices)
+			device->worker->stop();
+		m.ops = qint64(devices.front()->frames.size()) * deviceCount;
+		m.items = consumed;
+		return m;
+	}
+
+	std::vector<int> parseSessions(const QString & value) {
+		std::vector<int> sessions;
+		for (auto & item : value.split(",")) {
+			auto seconds = item.trimmed().toInt();
+			if (seconds > 0)
+				sessions.push_back(seconds);
+		}
+		return sessions;
+	}
+}
+
+int main(int argc, char *argv[])
+{
+	QCoreApplication a(argc, argv);
+	QCoreApplication::setApplicationName("telemed_bench");
+
+	QCommandLineParser parser;
+	parser.setApplicationDescription("Benchmarks of the processing hot paths, results are written as NDJSON.");
+	parser.addHelpOption();
+	parser.addOptions({
+		{ "sessions", "Comma separated session lengths in seconds.", "seconds", "60,600,3600,86400" },
+		{ "label", "Label added to every result, e.g. a commit hash.", "label" },
+		{ "filter", "Run only benchmarks whose name contains the text.", "text" },
+		{ "heart-rate", "Heart rate of the synthetic signal in bpm.", "bpm", "72" },
+		{ "noise", "Standard deviation of the noise added to the samples.", "level", "25" },
+		{ "artifacts", "Motion artifacts per minute.", "count", "0" },
+		{ "artifact-amplitude", "Maximum amplitude of motion artifacts.", "level", "3000" },
+		{ "concurrent-seconds", "Signal length of every device in the concurrent sessions benchmark.",
+			"seconds", QString::number(DEFAULT_CONCURRENT_SECONDS) },
+		{ "xlsx-dir", "Directory for files written by the save_ benchmarks, a temporary one by default.", "dir" },
+		{ "no-save", "Skip save_as, save_csv, save_ndjson, save_archive and load_archive." },
+	});
+	parser.process(a);
+
+	SignalConfig config;
+	config.heartRate = parser.value("heart-rate").toDouble();
+	config.noiseLevel = parser.value("noise").toDouble();
+	config.artifactsPerMinute = parser.value("artifacts").toDouble();
+	config.artifactAmplitude = parser.value("artifact-amplitude").toDouble();
+	auto sessions = parseSessions(parser.value("sessions"));
+	auto filter = parser.value("filter");
+	auto saveEnabled = !parser.isSet("no-save");
+	auto enabled = [&filter, saveEnabled](const QString & name) {
+		if ((name.startsWith("save_") || name == "load_archive") && !saveEnabled)
+			return false;
+		return filter.isEmpty() || name.contains(filter);
+	};
+	Reporter reporter(parser.value("label"));
+
+	for (auto seconds : sessions) {
+		if (enabled("parse_json"))
+			reporter.report("parse_json", seconds, repeat([&]() { return benchParseJson(config, seconds); }));
+		if (enabled("parse_binary"))
+			reporter.report("parse_binary", seconds, repeat([&]() { return benchParseBinary(config, seconds); }));
+		if (enabled("beat_detector")) {
+			qint64 beats = 0;
+			auto m = repeat([&]() { beats = 0; return benchBeatDetector(config, seconds, beats); });
+			reporter.report("beat_detector", seconds, m, { { "beats", beats } });
+		}
+		if (enabled("detect_heart_rate")) {
+			qint64 heartRates = 0;
+			auto m = repeat([&]() { heartRates = 0; return benchDetectHeartRate(config, seconds, heartRates); });
+			reporter.report("detect_heart_rate", seconds, m, { { "heart_rates", heartRates } });
+		}
+		// the checksums match when the cascade gives the same samples as iir1
+		for (auto & filter : { std::make_pair("band_pass_iir1", false), std::make_pair("band_pass_block", true) }) {
+			if (!enabled(filter.first))
+				continue;
+			qint64 checksum = 0;
+			auto m = repeat([&]() { checksum = 0; return benchBandPass(config, seconds, filter.second, checksum); });
+			reporter.report(filter.first, seconds, m, { { "checksum", checksum } });
+		}
+		if (enabled("pipeline_process")) {
+			qint64 heartRates = 0;
+			auto m = repeat([&]() { heartRates = 0; return benchPipeline(config, seconds, heartRates); });
+			reporter.report("pipeline_process", seconds, m, { { "heart_rates", heartRates } });
+		}
+		if (enabled("quantile_mean")) {
+			double lastMean = 0.0;
+			auto m = repeat([&]() { return benchQuantileMean(config, seconds, lastMean); });
+			reporter.report("quantile_mean", seconds, m, { { "mean", lastMean } });
+		}
+		if (std::any_of(std::begin(DATA_BENCHMARKS), std::end(DATA_BENCHMARKS), enabled))
+			benchData(config, seconds, parser.value("xlsx-dir"), enabled, reporter);
+	}
+
+	if (enabled("concurrent_sessions")) {
+		auto seconds = parser.value("concurrent-seconds").toInt();
+		if (seconds <= 0)
+			seconds = DEFAULT_CONCURRENT_SECONDS;
+		for (auto deviceCount : DEVICE_COUNTS) {
+			auto m = benchConcurrentSessions(config, deviceCount, seconds);
+			reporter.report("concurrent_sessions", seconds, m, {
+				{ "devices", deviceCount },
+				{ "threads", QThreadPool::globalInstance()->maxThreadCount() },
+				{ "realtime_devices", m.ns > 0 ? m.items * 1e9 / m.ns / SAMPLING_RATE : 0.0 },
+			});
+		}
+	}
+	return 0;
+}
@@ -0,0 +1,71 @@
+# ----------------------------------------------------
+# Benchmarks of the processing hot paths on a synthetic
+# PPG signal, results are written as NDJSON.
+# ------------------------------------------------------
+
+TEMPLATE = app
+TARGET = telemed_bench
+DESTDIR = ../Release
+CONFIG += console release
+CONFIG -= app_bundle
+QT += core network websockets
+QT -= gui
+INCLUDEPATH += ../telemed_desktop \
+    "../../../../../libs/iir/include" \
+    "../../../../../libs/json/include"
+LIBS += -L"../../../../../libs/iir/lib" \
+    -liir_static
+# zlib for ZipWriter, bundled with Qt on Windows
+unix:LIBS += -lz
+DEPENDPATH += . ../telemed_desktop
+MOC_DIR += .
+OBJECTS_DIR += release
+HEADERS += ../telemed_desktop/Clock.h \
+    ../telemed_desktop/Data.h \
+    ../telemed_desktop/DataSnapshot.h \
+    ../telemed_desktop/DataWorker.h \
+    ../telemed_desktop/DeviceApi.h \
+    ../telemed_desktop/DualBiquadCascade.h \
+    ../telemed_desktop/HeartRate.h \
+    ../telemed_desktop/LatencyHistogram.h \
+    ../telemed_desktop/LatencyMonitor.h \
+    ../telemed_desktop/MAX30100_BeatDetector.h \
+    ../telemed_desktop/MinMaxPyramid.h \
+    ../telemed_desktop/SensorData.h \
+    ../telemed_desktop/SensorDataStore.h \
+    ../telemed_desktop/SensorFrame.h \
+    ../telemed_desktop/SessionArchive.h \
+    ../telemed_desktop/SessionJournal.h \
+    ../telemed_desktop/SessionJournalWorker.h \
+    ../telemed_desktop/SessionStrand.h \
+    ../telemed_desktop/SignalPipeline.h \
+    ../telemed_desktop/SlidingMinMax.h \
+    ../telemed_desktop/SpO2.h \
+    ../telemed_desktop/SpO2Estimator.h \
+    ../telemed_desktop/SpscQueue.h \
+    ../telemed_desktop/StreamingTrimmedMean.h \
+    ../telemed_desktop/SyntheticPpg.h \
+    ../telemed_desktop/TextExporter.h \
+    ../telemed_desktop/XlsxExporter.h \
+    ../telemed_desktop/ZipWriter.h
+SOURCES += ./main.cpp \
+    ../telemed_desktop/Data.cpp \
+    ../telemed_desktop/DataWorker.cpp \
+    ../telemed_desktop/DeviceApi.cpp \
+    ../telemed_desktop/DualBiquadCascade.cpp \
+    ../telemed_desktop/LatencyHistogram.cpp \
+    ../telemed_desktop/LatencyMonitor.cpp \
+    ../telemed_desktop/MAX30100_BeatDetector.cpp \
+    ../telemed_desktop/SensorDataStore.cpp \
+    ../telemed_desktop/SensorFrame.cpp \
+    ../telemed_desktop/SessionArchive.cpp \
+    ../telemed_desktop/SessionJournal.cpp \
+    ../telemed_desktop/SessionJournalWorker.cpp \
+    ../telemed_desktop/SessionStrand.cpp \
+    ../telemed_desktop/SignalPipeline.cpp \
+    ../telemed_desktop/SpO2Estimator.cpp \
+    ../telemed_desktop/StreamingTrimmedMean.cpp \
+    ../telemed_desktop/SyntheticPpg.cpp \
+    ../telemed_desktop/TextExporter.cpp \
+    ../telemed_desktop/XlsxExporter.cpp \
+    ../telemed_desktop/ZipWriter.cpp
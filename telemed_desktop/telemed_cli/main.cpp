@@ -0,0 +1,259 @@
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QDateTime>
+#include <QDebug>
+#include <QDir>
+#include <QFileInfo>
+#include <QThreadPool>
+#include <QTimer>
+#include <QTextStream>
+#include <nlohmann/json.h>
+#include <csignal>
+#include <memory>
+#include <vector>
+#include "Data.h"
+#include "DeviceApi.h"
+#include "RawCapture.h"
+#include "ReplayEngine.h"
+#include "SessionArchive.h"
+
+namespace {
+	auto constexpr DEFAULT_LED_CURRENT = DeviceApi::MAX30100_LED_CURR_27_1MA;
+	auto constexpr DEFAULT_QUANTILE_N = 9;
+	auto constexpr STOP_POLL_INTERVAL = 200;	// ms
+
+	volatile std::sig_atomic_t stopRequested = 0;
+
+	void requestStop(int) {
+		stopRequested = 1;
+	}
+
+	/**
+	 * Sesja pomiarowa jednego modułu WiFi.
+	 */
+	struct Session {
+		QString ip;
+		DeviceApi * devApi = nullptr;
+		Data * data = nullptr;
+		RawCaptureWriter capture;
+		qint64 lastHrBeginMs = -1;
+	};
+
+	QString fileNameFor(const QString & ip, const QString & extension) {
+		return QString(ip).replace(':', '_') + extension;
+	}
+
+	template<class Container>
+	void printHeartRates(const QString & device, const Container & raw, const Container & mean, QTextStream & out) {
+		for (size_t i = 0; i < size_t(raw.size()) && i < size_t(mean.size()); ++i) {
+			nlohmann::json line = {
+				{ "device", device.toStdString() },
+				{ "begin", raw[i].getBeginMs() },
+				{ "end", raw[i].getEndMs() },
+				{ "hr", raw[i].getHR() },
+				{ "hr_mean", mean[i].getHR() }
+			};
+			out << QString::fromStdString(line.dump()) << '\n';
+		}
+		out.flush();
+	}
+
+	void printNewHeartRates(Session & session, QTextStream & out) {
+		auto raw = session.data->getHeartRate(session.lastHrBeginMs);
+		auto mean = session.data->getQuantileMeanHeartRate(session.lastHrBeginMs);
+		printHeartRates(session.ip, raw, mean, out);
+		if (!raw.isEmpty())
+			session.lastHrBeginMs = raw.back().getBeginMs();
+	}
+
+	int convert(const QString & path, QTextStream & out) {
+		DataSnapshot data;
+		if (!SessionRecording::readXlsx(path, data)) {
+			qCritical() << "Cannot read" << path;
+			return 1;
+		}
+		QFileInfo info(path);
+		auto archivePath = info.dir().filePath(info.completeBaseName() + ".tmarc");
+		if (!SessionArchiveWriter::write(data, archivePath)) {
+			qCritical() << "Cannot write" << archivePath;
+			return 1;
+		}
+		nlohmann::json summary = {
+			{ "converted", info.fileName().toStdString() },
+			{ "archive", archivePath.toStdString() },
+			{ "samples", data.sensorData.size() },
+			{ "heart_rates", data.heartRate.size() },
+			{ "xlsx_bytes", info.size() },
+			{ "archive_bytes", QFileInfo(archivePath).size() }
+		};
+		out << QString::fromStdString(summary.dump()) << '\n';
+		out.flush();
+		return 0;
+	}
+
+	int replay(const QString & path, const QString & referencePath, double speed, QTextStream & out) {
+		SessionRecording recording;
+		if (!recording.load(path)) {
+			qCritical() << "Cannot load recorded session" << path;
+			return 1;
+		}
+		if (!referencePath.isEmpty() && !recording.loadReference(referencePath)) {
+			qCritical() << "Cannot load reference heart rate" << referencePath;
+			return 1;
+		}
+
+		ReplayEngine engine(DEFAULT_QUANTILE_N);
+		engine.setSpeed(speed);
+		auto device = QFileInfo(path).fileName();
+		auto report = engine.run(recording, [&device, &out](const ProcessedBatch & batch) {
+			printHeartRates(device, batch.heartRatesRaw, batch.heartRates, out);
+		});
+
+		nlohmann::json summary = {
+			{ "replay", device.toStdString() },
+			{ "frames", report.frames },
+			{ "samples", report.samples },
+			{ "elapsed_ms", report.elapsedNs / 1e6 },
+			{ "samples_per_s", report.samplesPerSecond() },
+			{ "heart_rates", report.heartRates }
+		};
+		if (recording.hasReference()) {
+			summary["reference_heart_rates"] = report.referenceHeartRates;
+			summary["compared"] = report.compared;
+			summary["mismatches"] = report.mismatches;
+			summary["match"] = report.matches();
+		}
+		out << QString::fromStdString(summary.dump()) << '\n';
+		out.flush();
+		return recording.hasReference() && !report.matches() ? 2 : 0;
+	}
+}
+
+int main(int argc, char *argv[])
+{
+	QCoreApplication a(argc, argv);
+	QCoreApplication::setApplicationName("telemed_cli");
+
+	QCommandLineParser parser;
+	parser.setApplicationDescription(
+		"Headless heart rate recorder. Heart rate is written to stdout as NDJSON, one object per beat.");
+	parser.addHelpOption();
+	QCommandLineOption deviceOpt({ "d", "device" }, "IP address of a WiFi module, may be repeated.", "ip");
+	QCommandLineOption streamOpt({ "s", "streaming" }, "Receive samples over WebSocket instead of polling.");
+	QCommandLineOption rawOpt({ "r", "raw-dir" }, "Directory for raw captures, one file per device.", "dir");
+	QCommandLineOption xlsxOpt({ "x", "xlsx-dir" }, "Directory for .xlsx exports written on exit.", "dir");
+	QCommandLineOption archiveOpt({ "a", "archive-dir" }, "Directory for session archives (.tmarc) written on exit.", "dir");
+	QCommandLineOption csvOpt("csv-dir", "Directory for .csv exports written on exit.", "dir");
+	QCommandLineOption ndjsonOpt("ndjson-dir", "Directory for .ndjson exports written on exit.", "dir");
+	QCommandLineOption latencyOpt("latency-dir", "Directory for latency reports (.hgrm) written on exit.", "dir");
+	QCommandLineOption irOpt("ir-current", "IR LED current index (0-15).", "index",
+		QString::number(DEFAULT_LED_CURRENT));
+	QCommandLineOption redOpt("red-current", "Red LED current index (0-15).", "index",
+		QString::number(DEFAULT_LED_CURRENT));
+	QCommandLineOption threadsOpt({ "t", "threads" }, "Number of processing threads.", "n", "1");
+	QCommandLineOption memoryOpt("memory-budget", "Sample memory budget per device in MB, 0 - unlimited.", "MB",
+		QString::number(DEFAULT_MEMORY_BUDGET >> 20));
+	QCommandLineOption durationOpt("duration", "Stop after given number of seconds.", "s");
+	QCommandLineOption replayOpt("replay", "Replay a recorded session (.tmcap, .xlsx or .tmarc) instead of recording.", "file");
+	QCommandLineOption speedOpt("speed", "Replay speed as a multiple of real time, 0 - as fast as possible.", "x", "0");
+	QCommandLineOption referenceOpt("reference", "Compare replayed heart rate with the one saved in .xlsx or .tmarc.", "file");
+	QCommandLineOption convertOpt("convert", "Convert an .xlsx export to a session archive (.tmarc) and exit.", "file");
+	parser.addOptions({ deviceOpt, streamOpt, rawOpt, xlsxOpt, archiveOpt, csvOpt, ndjsonOpt, latencyOpt, irOpt, redOpt, threadsOpt,
+		memoryOpt, durationOpt, replayOpt, speedOpt, referenceOpt, convertOpt });
+	parser.process(a);
+
+	QTextStream out(stdout);
+	if (parser.isSet(convertOpt))
+		return convert(parser.value(convertOpt), out);
+	if (parser.isSet(replayOpt))
+		return replay(parser.value(replayOpt), parser.value(referenceOpt), parser.value(speedOpt).toDouble(), out);
+
+	auto devices = parser.values(deviceOpt);
+	if (devices.isEmpty()) {
+		qCritical() << "No device given";
+		parser.showHelp(1);
+	}
+	QThreadPool::globalInstance()->setMaxThreadCount(std::max(1, parser.value(threadsOpt).toInt()));
+
+	std::vector<std::unique_ptr<Session>> sessions;
+	for (auto & ip : devices) {
+		auto session = std::make_unique<Session>();
+		auto s = session.get();
+		s->ip = ip;
+		s->devApi = new DeviceApi(&a);
+		s->devApi->setDeviceIp(ip);
+		s->data = new Data(s->devApi, &a);
+		s->data->setHeartRateQuantileN(DEFAULT_QUANTILE_N);
+		s->data->setStreamingEnabled(parser.isSet(streamOpt));
+		s->data->setMemoryBudget(parser.value(memoryOpt).toLongLong() << 20);
+
+		if (parser.isSet(rawOpt)) {
+			auto path = QDir(parser.value(rawOpt)).filePath(fileNameFor(ip, ".tmcap"));
+			if (!s->capture.open(path)) {
+				qCritical() << "Cannot open raw capture" << path;
+				return 1;
+			}
+			QObject::connect(s->devApi, &DeviceApi::newMeasuresFrame, [s](const SensorFrame & frame) {
+				if (!s->capture.write(frame, QDateTime::currentMSecsSinceEpoch()))
+					qWarning() << "Raw capture write failed for" << s->ip;
+			});
+		}
+		QObject::connect(s->data, &Data::receivedNewData, [s, &out] {
+			printNewHeartRates(*s, out);
+			// stdout is the screen of the recorder
+			s->data->markRendered();
+		});
+		sessions.push_back(std::move(session));
+	}
+
+	for (auto & session : sessions) {
+		session->data->start();
+		session->devApi->setIrLedCurrent(parser.value(irOpt).toUInt());
+		session->devApi->setRedLedCurrent(parser.value(redOpt).toUInt());
+	}
+
+	std::signal(SIGINT, requestStop);
+	std::signal(SIGTERM, requestStop);
+	auto deadline = parser.isSet(durationOpt)
+		? QDateTime::currentMSecsSinceEpoch() + parser.value(durationOpt).toLongLong() * 1000
+		: -1;
+	QTimer stopTimer;
+	QObject::connect(&stopTimer, &QTimer::timeout, [deadline] {
+		if (stopRequested || (deadline >= 0 && QDateTime::currentMSecsSinceEpoch() >= deadline))
+			QCoreApplication::quit();
+	});
+	stopTimer.start(STOP_POLL_INTERVAL);
+
+	auto rc = a.exec();
+
+	// every file is attempted, a failed one only changes the exit code
+	auto checkWritten = [&rc](bool written, const QString & path) {
+		if (!written) {
+			qCritical() << "Cannot write" << path;
+			rc = 1;
+		}
+	};
+	for (auto & session : sessions) {
+		session->data->stop();
+		// frames already handed to the worker belong to the session
+		session->data->drain();
+		session->capture.close();
+		for (auto & format : { std::make_pair(&xlsxOpt, ".xlsx"), std::make_pair(&csvOpt, ".csv"),
+			std::make_pair(&ndjsonOpt, ".ndjson") })
+		{
+			if (!parser.isSet(*format.first))
+				continue;
+			auto path = QDir(parser.value(*format.first)).filePath(fileNameFor(session->ip, format.second));
+			checkWritten(session->data->saveAs(path), path);
+		}
+		if (parser.isSet(latencyOpt)) {
+			auto path = QDir(parser.value(latencyOpt)).filePath(fileNameFor(session->ip, ".hgrm"));
+			checkWritten(session->data->getLatency().writeReport(path), path);
+		}
+		if (parser.isSet(archiveOpt)) {
+			auto path = QDir(parser.value(archiveOpt)).filePath(fileNameFor(session->ip, ".tmarc"));
+			checkWritten(SessionArchiveWriter::write(session->data->snapshot(), path), path);
+		}
+	}
+	return rc;
+}
@@ -0,0 +1,101 @@
+#pragma once
+#include <QDateTime>
+#include "SensorFrame.h"
+
+/**
+ * Interfejs źródła czasu, pozwala zastąpić zegar systemowy zegarem wirtualnym podczas odtwarzania sesji.
+ */
+class Clock {
+public:
+	virtual ~Clock() {}
+
+	/**
+	 * Getter.
+	 * @return Aktualny czas w milisekundach od początku epoki.
+	 */
+	virtual qint64 nowMs() const = 0;
+};
+
+/**
+ * Zegar systemowy.
+ */
+class SystemClock : public Clock {
+public:
+	qint64 nowMs() const override {
+		return QDateTime::currentMSecsSinceEpoch();
+	}
+
+	/**
+	 * Getter.
+	 * @return Współdzielona instancja zegara systemowego.
+	 */
+	static SystemClock * instance() {
+		static SystemClock clock;
+		return &clock;
+	}
+};
+
+/**
+ * Zegar wirtualny, którego czas ustawiany jest jawnie.
+ */
+class VirtualClock : public Clock {
+	qint64 ms = 0;
+
+public:
+	qint64 nowMs() const override {
+		return ms;
+	}
+
+	/**
+	 * Setter.
+	 * @param ms_ Czas w milisekundach od początku epoki.
+	 */
+	void set(qint64 ms_) {
+		ms = ms_;
+	}
+};
+
+/**
+ * Klasa wyznaczająca przesunięcie zegara modułu WiFi względem początku epoki.
+ * Przesunięcie wyznaczane jest przy pierwszej paczce po utworzeniu lub wyzerowaniu obiektu
+ * tak, aby ostatnia próbka paczki otrzymała czas jej odebrania.
+ */
+class TimeBase {
+	const Clock * clock;
+	qint64 begMs = 0;
+
+public:
+	/**
+	 * Konstruktor inicjalizujący.
+	 * @param clock_ Źródło czasu odebrania paczki.
+	 */
+	TimeBase(const Clock * clock_ = SystemClock::instance()) :
+		clock(clock_)
+	{}
+
+	/**
+	 * Setter.
+	 * @param clock_ Źródło czasu odebrania paczki.
+	 */
+	void setClock(const Clock * clock_) {
+		clock = clock_;
+	}
+
+	/**
+	 * Wyznacza przesunięcie dla odebranej paczki, jeżeli nie zostało jeszcze wyznaczone.
+	 * @param frame Niepusta paczka próbek ze stemplami czasowymi zegara modułu.
+	 * @return Przesunięcie zegara modułu w milisekundach.
+	 */
+	qint64 anchor(const SensorFrame & frame) {
+		if (begMs == 0)
+			begMs = clock->nowMs() - frame.getSamples().back().getMs();
+		return begMs;
+	}
+
+	/**
+	 * Zeruje przesunięcie, zostanie wyznaczone na nowo przy kolejnej paczce.
+	 */
+	void reset() {
+		begMs = 0;
+	}
+};
@@ -0,0 +1,31 @@
+#pragma once
+#include <QtGlobal>
+#include <array>
+#include <cstddef>
+
+/**
+ * Suma kontrolna CRC-32 (wielomian 0xEDB88320, jak w formatach ZIP i PNG).
+ * Suma może być liczona przyrostowo, wynik poprzedniego wywołania jest wartością początkową kolejnego.
+ * @param crc Suma kontrolna dotychczasowych danych, 0 dla pierwszego fragmentu.
+ * @param data Dane.
+ * @param size Rozmiar danych w bajtach.
+ * @return Suma kontrolna danych wraz z dotychczasowymi.
+ */
+inline quint32 crc32(quint32 crc, const void * data, size_t size) {
+	static const auto table = [] {
+		std::array<quint32, 256> table;
+		for (quint32 i = 0; i < 256; ++i) {
+			auto c = i;
+			for (int k = 0; k < 8; ++k)
+				c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+			table[i] = c;
+		}
+		return table;
+	}();
+
+	auto bytes = static_cast<const quint8 *>(data);
+	crc = ~crc;
+	for (size_t i = 0; i < size; ++i)
+		crc = table[(crc ^ bytes[i]) & 0xFF] ^ (crc >> 8);
+	return ~crc;
+}
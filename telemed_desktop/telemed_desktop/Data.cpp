@@ -1,94 +1,193 @@
 #include "Data.h"
 
-#include <nlohmann/json.h>
-#include <OpenXLSX/OpenXLSX.h>
 #include <QDateTime>
 #include <QTimer>
+#include <QThreadPool>
 #include <QFile>
 #include <QTextStream>
 #include <QDebug>
-#include <iir/Butterworth.h>
 #include <iterator>
-#include "ObjectFactory.h"
 #include "DeviceApi.h"
+#include "TextExporter.h"
+#include "XlsxExporter.h"
+
+namespace {
+	auto constexpr MIN_RESIDENT_CHUNKS = 2;
+	auto constexpr PLOT_PAGE_IN_CHUNKS = 64;	// longest spilled range decimated from samples read back from disk
+
+	/**
+	 * Najniższy poziom piramidy min/max, którego przedziały obejmują całe bloki magazynu próbek.
+	 * Niższe poziomy zwalniane są dla próbek przeniesionych na dysk.
+	 */
+	int chunkPyramidLevel() {
+		int level = 0;
+		while (MinMaxPyramid<int>::bucketSize(level) < SENSOR_DATA_CHUNK_SIZE)
+			++level;
+		return level;
+	}
+}
 
-Data::Data(QObject *parent)
-	: QObject(parent)
+Data::Data(DeviceApi * devApi_, QObject *parent)
+	: QObject(parent),
+	devApi(devApi_)
 {
 	timer = new QTimer(this);
-	auto devApi = ObjectFactory::getInstance<DeviceApi>();
-	
-	connect(devApi, &DeviceApi::newMeasuresData, this, &Data::processNewData);
+	worker = new DataWorker(&batchQueue, QThreadPool::globalInstance(), this);
+	connect(worker, &DataWorker::batchReady, this, &Data::consumeBatches);
+	journal = new SessionJournalWorker(this);
+	connect(journal, &SessionJournalWorker::failed, this, &Data::journalFailed);
+
+	connect(devApi, &DeviceApi::newMeasuresFrame, this, &Data::processNewFrame);
+	connect(devApi, &DeviceApi::sequenceReset, this, &Data::resetTimeBase);
+	connect(devApi, &DeviceApi::streamingStopped, this, &Data::streamingStopped);
 	connect(timer, &QTimer::timeout, this, &Data::timerTimeout);
 	timer->setInterval(TIMER_INTERVAL);
+}
 
-	irFilter.setup(
-		SAMPLING_RATE,
-		(LOW_CUT_FREQ + HIGH_CUT_FREQ) / 2,
-		(HIGH_CUT_FREQ - LOW_CUT_FREQ)
-	);	
-	redFilter.setup(
-		SAMPLING_RATE,
-		(LOW_CUT_FREQ + HIGH_CUT_FREQ) / 2,
-		(HIGH_CUT_FREQ - LOW_CUT_FREQ)
-	);
+Data::~Data() {
+	// the worker must not touch batchQueue after it is destroyed
+	worker->stop();
 }
 
 void Data::timerTimeout() {
-	dataSaved = false;
-	auto devApi = ObjectFactory::getInstance<DeviceApi>();
 	devApi->readNewMeasures();
 }
 
 void Data::start() {
-	timer->start();
+	running = true;
+	if (streamingEnabled)
+		devApi->startStreaming();
+	else
+		timer->start();
 }
 
 void Data::stop() {
+	running = false;
 	timer->stop();
+	devApi->stopStreaming();
+}
+
+void Data::drain() {
+	for (;;) {
+		worker->drain();
+		auto stalled = worker->isStalled();
+		// resumes the worker, which then pushes the batches put aside
+		consumeBatches();
+		if (!stalled)
+			break;
+	}
+}
+
+void Data::setStreamingEnabled(bool enabled) {
+	streamingEnabled = enabled;
+	if (running) {
+		stop();
+		start();
+	}
+}
+
+void Data::setClock(const Clock * clock) {
+	timeBase.setClock(clock);
+	latency.setClock(clock);
+}
+
+void Data::streamingStopped() {
+	qDebug() << "Streaming stopped, falling back to polling";
+	if (running)
+		timer->start();
 }
 
 void Data::clear() {
-	sensorDataSet.clear();
+	sensorData.clear();
 	beatSet.clear();
 	heartRateVec.clear();
 	heartRateVecRaw.clear();
-	begMs = 0;
+	spo2Vec.clear();
+	irMinMax.clear();
+	redMinMax.clear();
+	hrMinMax.clear();
+	spo2MinMax.clear();
+	latency.clear();
+	irPyramid.clear();
+	redPyramid.clear();
+	timeBase.reset();
 	dataSaved = true;
+	++revision;
+	if (journal->isOpen())
+		journal->create(journal->fileName(), ProcessedBatch());
+
+	// batches already queued belong to the previous generation and are dropped
+	++generation;
+	worker->clearHistory();
+}
+
+bool Data::saveAs(const QString & filepath) {
+	auto data = snapshot();
+	TextExporter::Format format;
+	auto ok = TextExporter::formatFor(filepath, format)
+		? TextExporter::write(data, filepath, format)
+		: XlsxExporter::write(data, filepath);
+	if (!ok)
+		return false;
+	markSaved(data.revision);
+	return true;
+}
+
+DataSnapshot Data::snapshot() const {
+	DataSnapshot data;
+	data.sensorData = sensorData;
+	data.beats.assign(beatSet.begin(), beatSet.end());
+	data.heartRateRaw = heartRateVecRaw;
+	data.heartRate = heartRateVec;
+	data.spo2 = spo2Vec;
+	data.revision = revision;
+	return data;
 }
 
-void Data::saveAs(const QString & filepath) {
-	using namespace OpenXLSX;
-	XLDocument doc;
+void Data::markSaved(quint64 snapshotRevision) {
+	if (snapshotRevision == revision)
+		dataSaved = true;
+}
 
-	doc.CreateDocument(filepath.toStdString());
+void Data::markRendered() {
+	latency.rendered();
+}
 
-	doc.Workbook().AddWorksheet("Heart rate");
-	auto wks = doc.Workbook().Worksheet("Heart rate");
-	wks.Cell("A1").Value() = "Timestamp";
-	wks.Cell("B1").Value() = "Heart Rate Raw [bpm]";
-	wks.Cell("C1").Value() = "Heart Quantile Mean [bpm]";
-	for (int row = 0; row < heartRateVec.size() && row < heartRateVecRaw.size(); ++row) {
-		wks.Cell(row + 2, 1).Value() = timestampStringFromMsSinceEpoch(heartRateVec.at(row).getEndMs());
-		wks.Cell(row + 2, 2).Value() = heartRateVecRaw.at(row).getHR();
-		wks.Cell(row + 2, 3).Value() = heartRateVec.at(row).getHR();
-	}
+void Data::startJournal(const QString & path) {
+	ProcessedBatch batch;
+	batch.samples.reserve(sensorData.size());
+	sensorData.forEach(0, sensorData.size(), [&batch](qint64 ms, int ir, int red) {
+		batch.samples.emplace_back(ms, ir, red);
+	});
+	batch.beats.assign(beatSet.begin(), beatSet.end());
+	batch.heartRates = heartRateVec;
+	batch.spo2 = spo2Vec;
+	journal->create(path, std::move(batch));
+}
 
-	doc.Workbook().AddWorksheet("Raw data");
-	wks = doc.Workbook().Worksheet("Raw data");
-	wks.Cell("A1").Value() = "Timestamp";
-	wks.Cell("B1").Value() = "IR led";
-	wks.Cell("C1").Value() = "Red led";
-	int row = 2;
-	for (auto & sd : sensorDataSet) {
-		wks.Cell(row, 1).Value() = timestampStringFromMsSinceEpoch(sd.getMs());
-		wks.Cell(row, 2).Value() = sd.getIrLed();
-		wks.Cell(row++, 3).Value() = sd.getRedLed();
-	}
+bool Data::recoverJournal(const QString & path) {
+	SessionJournalContents contents;
+	if (!SessionJournalReader::read(path, contents))
+		return false;
 
-	doc.Workbook().DeleteSheet("Sheet1");
-	doc.SaveDocument();
-	dataSaved = true;
+	journal->close();
+	clear();
+	auto resumed = journal->resume(path, contents);
+	sensorData = std::move(contents.sensorData);
+	beatSet.insert(contents.beats.begin(), contents.beats.end());
+	heartRateVecRaw = std::move(contents.heartRateRaw);
+	heartRateVec = std::move(contents.heartRate);
+	spo2Vec = std::move(contents.spo2);
+	setMinMaxRange(minMaxRangeSize);
+	updatePyramids();
+	applyMemoryBudget();
+	dataSaved = sensorData.empty();
+	++revision;
+	return resumed;
+}
+
+void Data::discardJournal() {
+	journal->discard();
 }
 
 void Data::setIrLedEnabled(bool enabled) {
@@ -103,6 +202,10 @@ void Data::setHearRateEnabled(bool enabled) {
 	hrDataEnabled = enabled;
 }
 
+void Data::setSpO2Enabled(bool enabled) {
+	spo2DataEnabled = enabled;
+}
+
 QString Data::getYIrSensorDataName() const {
 	return IR_DATA_NAME;
 }
@@ -112,47 +215,131 @@ QString Data::getYRedSensorDataName() const {
 }
 
 QVector<double> Data::getXSensorData(double dataLaterThan) {
-	return getSensorData(dataLaterThan, [](const SensorData & data)->double {
-		return data.toCustomPlotMs();
+	return getSensorData(dataLaterThan, [](qint64 ms, int, int)->double {
+		return msToCustomPlotMs(ms);
 	});
 }
 
 QVector<double> Data::getYIrSensorData(double dataLaterThan) {
-	return getSensorData(dataLaterThan, [](const SensorData & data)->double {
-		return data.getIrLed();
+	return getSensorData(dataLaterThan, [](qint64, int ir, int)->double {
+		return ir;
 	});
 }
 
 QVector<double> Data::getYRedSensorData(double dataLaterThan) {
-	return getSensorData(dataLaterThan, [](const SensorData & data)->double {
-		return data.getRedLed();
+	return getSensorData(dataLaterThan, [](qint64, int, int red)->double {
+		return red;
 	});
 }
 
+SensorPlotData Data::getSensorPlotData(double fromCustomPlotMs, double toCustomPlotMs, int maxPoints) const {
+	SensorPlotData plotData;
+	if (sensorData.empty())
+		return plotData;
+
+	auto begin = sensorData.upperBound(customPlotMsToMs(fromCustomPlotMs));
+	auto end = sensorData.upperBound(customPlotMsToMs(toCustomPlotMs));
+	if (begin > 0)
+		--begin;
+	if (end < sensorData.size())
+		++end;
+	if (begin >= end)
+		return plotData;
+
+	// every bucket gives two points, its minimum and maximum
+	plotData.level = irPyramid.levelFor(end - begin, size_t(std::max(maxPoints, 4)) / 2);
+	if (plotData.level < 0) {
+		plotData.x.reserve(int(end - begin));
+		plotData.ir.reserve(int(end - begin));
+		plotData.red.reserve(int(end - begin));
+		sensorData.forEach(begin, end, [&plotData](qint64 ms, int ir, int red) {
+			plotData.x.append(msToCustomPlotMs(ms));
+			plotData.ir.append(ir);
+			plotData.red.append(red);
+		});
+		return plotData;
+	}
+
+	// lower levels of spilled samples are released, a long range uses the coarser complete levels
+	auto released = begin / MinMaxPyramid<int>::bucketSize(plotData.level) < irPyramid.firstBucket(plotData.level);
+	if (released && end - begin > PLOT_PAGE_IN_CHUNKS * SENSOR_DATA_CHUNK_SIZE) {
+		plotData.level = std::max(plotData.level, std::min(chunkPyramidLevel(), irPyramid.levelCount() - 1));
+		released = false;
+	}
+
+	auto bucketSize = MinMaxPyramid<int>::bucketSize(plotData.level);
+	auto firstBucket = begin / bucketSize;
+	auto lastBucket = std::min((end - 1) / bucketSize + 1, irPyramid.bucketCount(plotData.level));
+	auto points = int(lastBucket - firstBucket) * 2;
+	plotData.x.reserve(points);
+	plotData.ir.reserve(points);
+	plotData.red.reserve(points);
+	if (released) {
+		// a short range is decimated from the samples read back from disk
+		auto from = firstBucket * bucketSize;
+		auto i = from;
+		sensorData.forEach(from, std::min(lastBucket * bucketSize, sensorData.size()),
+			[&plotData, &i, from, bucketSize](qint64 ms, int ir, int red) {
+			if ((i++ - from) % bucketSize == 0) {
+				plotData.x.append(msToCustomPlotMs(ms));
+				plotData.x.append(msToCustomPlotMs(ms));
+				plotData.ir.append(ir);
+				plotData.ir.append(ir);
+				plotData.red.append(red);
+				plotData.red.append(red);
+				return;
+			}
+			auto last = plotData.x.size() - 1;
+			plotData.ir[last - 1] = std::min(plotData.ir[last - 1], double(ir));
+			plotData.ir[last] = std::max(plotData.ir[last], double(ir));
+			plotData.red[last - 1] = std::min(plotData.red[last - 1], double(red));
+			plotData.red[last] = std::max(plotData.red[last], double(red));
+		});
+		return plotData;
+	}
+	for (auto bucket = firstBucket; bucket < lastBucket; ++bucket) {
+		auto x = msToCustomPlotMs(sensorData.getMs(bucket * bucketSize));
+		plotData.x.append(x);
+		plotData.x.append(x);
+		plotData.ir.append(irPyramid.min(plotData.level, bucket));
+		plotData.ir.append(irPyramid.max(plotData.level, bucket));
+		plotData.red.append(redPyramid.min(plotData.level, bucket));
+		plotData.red.append(redPyramid.max(plotData.level, bucket));
+	}
+	return plotData;
+}
+
 double Data::getLastSensorDataCustomPlotMs() {
-	return (*sensorDataSet.rbegin()).toCustomPlotMs();
+	return sensorData.back().toCustomPlotMs();
 }
 
 std::pair<double, double> Data::getDataMinMax(int rangeSizeInSeconds) {
-	if (sensorDataSet.empty()) 
+	if (sensorData.empty()) 
 		return std::pair<double, double>(0, 1);
 
-	auto begin = getRangeBegin((*sensorDataSet.rbegin()).getMs() - rangeSizeInSeconds * 1000);
-	if (begin == sensorDataSet.end())
-		begin = sensorDataSet.begin();
-	auto sensorMinMax = sensorDataMinMax(begin, sensorDataSet.end());
-	if (hrDataEnabled == false || heartRateVec.empty()) 
-		return sensorMinMax;
-	
-	auto hrBegin = getHeartRateBegin(heartRateVec.back().getEndMs() - rangeSizeInSeconds * 1000);
-	if (hrBegin == heartRateVec.end())
-		hrBegin = heartRateVec.begin();
-	auto hrMinMax = heartRateMinMax(hrBegin, heartRateVec.end());
+	if (rangeSizeInSeconds != minMaxRangeSize)
+		setMinMaxRange(rangeSizeInSeconds);
 
-	return std::pair<double, double>(
-		std::min(sensorMinMax.first, hrMinMax.first),
-		std::max(sensorMinMax.second, hrMinMax.second)
-	);
+	std::pair<double, double> sensorMinMax(0, 1);
+	if (irDataEnabled && redDataEnabled) {
+		sensorMinMax.first = std::min(irMinMax.min(), redMinMax.min());
+		sensorMinMax.second = std::max(irMinMax.max(), redMinMax.max());
+	}
+	else if (irDataEnabled) {
+		sensorMinMax = std::pair<double, double>(irMinMax.min(), irMinMax.max());
+	}
+	else if (redDataEnabled) {
+		sensorMinMax = std::pair<double, double>(redMinMax.min(), redMinMax.max());
+	}
+	if (hrDataEnabled && !hrMinMax.empty()) {
+		sensorMinMax.first = std::min(sensorMinMax.first, hrMinMax.min());
+		sensorMinMax.second = std::max(sensorMinMax.second, hrMinMax.max());
+	}
+	if (spo2DataEnabled && !spo2MinMax.empty()) {
+		sensorMinMax.first = std::min(sensorMinMax.first, spo2MinMax.min());
+		sensorMinMax.second = std::max(sensorMinMax.second, spo2MinMax.max());
+	}
+	return sensorMinMax;
 }
 
 QString Data::getBeatDataName() const {
@@ -173,7 +360,7 @@ QVector<double> Data::getYBeatData(int rangeSizeInSeconds) {
 }
 
 void Data::setHeartRateQuantileN(unsigned int n) {
-	quantileMeanN = n;
+	worker->setHeartRateQuantileN(n);
 }
 
 QString Data::getHeartRateDataName() const {
@@ -181,7 +368,8 @@ QString Data::getHeartRateDataName() const {
 }
 
 QVector<HeartRate> Data::getHeartRate(qint64 laterThan) {
-	auto begin = getHeartRateBegin(laterThan);
+	// both vectors hold the same periods, so the index found in heartRateVec applies to the raw one
+	auto begin = heartRateVecRaw.begin() + std::distance(heartRateVec.begin(), getHeartRateBegin(laterThan));
 	QVector<HeartRate> hr(std::distance(begin, heartRateVecRaw.end()));
 	std::copy(begin, heartRateVecRaw.end(), hr.begin());
 	return hr;
@@ -194,164 +382,214 @@ QVector<HeartRate> Data::getQuantileMeanHeartRate(qint64 laterThan) {
 	return out;
 }
 
-QVector<double> Data::getXHRData() const {
-	QVector<double> x(heartRateVec.size());
-	std::transform(heartRateVec.begin(), heartRateVec.end(), x.begin(), 
+size_t Data::getHeartRateCount() const {
+	return heartRateVec.size();
+}
+
+const HeartRate & Data::getQuantileMeanHeartRateAt(size_t i) const {
+	return heartRateVec[i];
+}
+
+QVector<double> Data::getXHRData(size_t from) const {
+	auto begin = heartRateVec.begin() + std::min(from, heartRateVec.size());
+	QVector<double> x(int(std::distance(begin, heartRateVec.end())));
+	std::transform(begin, heartRateVec.end(), x.begin(), 
 		[](const HeartRate & hr)->double {
 			return msToCustomPlotMs(hr.getEndMs());
 	});
 	return x;
 }
 
-QVector<double> Data::getYHRData() const {
-	QVector<double> y(heartRateVec.size());
-	std::transform(heartRateVec.begin(), heartRateVec.end(), y.begin(),
+QVector<double> Data::getYHRData(size_t from) const {
+	auto begin = heartRateVec.begin() + std::min(from, heartRateVec.size());
+	QVector<double> y(int(std::distance(begin, heartRateVec.end())));
+	std::transform(begin, heartRateVec.end(), y.begin(),
 		[](const HeartRate & hr)->double {
 		return hr.getHR();
 	});
 	return y;
 }
 
+QString Data::getSpO2DataName() const {
+	return SPO2_DATA_NAME;
+}
 
-void Data::processNewData(const QString & data_) {
-	nlohmann::json data;
-	try {
-		data = nlohmann::json::parse(data_.toStdString());
-	}
-	catch (const std::exception & ex) {
-		qDebug() << ex.what();
-		return;
-	}
-	try {
-		qDebug() << data["status"].get<std::string>().c_str();
-		return;
-	}
-	catch (std::exception ex) {}
-	
-	// set begin time of measures
-	if (begMs == 0) {
-		auto max = std::max_element(data.begin(), data.end(), 
-			[](const nlohmann::json::value_type & l, const nlohmann::json::value_type & r)->bool {
-				return l["ms"].get<unsigned long long>() < r["ms"].get<unsigned long long>();
-		});
-		begMs = QDateTime::currentDateTime().toMSecsSinceEpoch() - (*max)["ms"].get<unsigned long long>();
-	}
-	
-	auto previousLastMs = sensorDataSet.empty() ? 
-		-1 : (*sensorDataSet.rbegin()).getMs();
-	
-	std::transform(data.begin(), data.end(), std::inserter(sensorDataSet, sensorDataSet.begin()),
-		[this](const nlohmann::json::value_type & row)->SensorData {
-			return SensorData(
-				(row["ms"].get<unsigned long long>() + this->begMs),
-				irFilter.filter(row["ir"].get<int>()),
-				redFilter.filter(row["red"].get<int>())
-			);	
+size_t Data::getSpO2Count() const {
+	return spo2Vec.size();
+}
+
+const SpO2 & Data::getSpO2At(size_t i) const {
+	return spo2Vec[i];
+}
+
+QVector<double> Data::getXSpO2Data(size_t from) const {
+	auto begin = spo2Vec.begin() + std::min(from, spo2Vec.size());
+	QVector<double> x(int(std::distance(begin, spo2Vec.end())));
+	std::transform(begin, spo2Vec.end(), x.begin(),
+		[](const SpO2 & spo2)->double {
+		return msToCustomPlotMs(spo2.getMs());
 	});
+	return x;
+}
 
-	auto it = previousLastMs == -1 ? 
-		sensorDataSet.begin() : sensorDataSet.find(SensorData(previousLastMs));
-	detectHeartRate(it);
+QVector<double> Data::getYSpO2Data(size_t from) const {
+	auto begin = spo2Vec.begin() + std::min(from, spo2Vec.size());
+	QVector<double> y(int(std::distance(begin, spo2Vec.end())));
+	std::transform(begin, spo2Vec.end(), y.begin(),
+		[](const SpO2 & spo2)->double {
+		return spo2.getSpO2();
+	});
+	return y;
+}
 
-	emit receivedNewData();
+
+void Data::processNewData(const QString & data_) {
+	SensorFrame frame;
+	if (SensorFrame::fromJson(data_.toStdString(), frame))
+		processNewFrame(frame);
 }
 
-void Data::detectHeartRate(std::set<SensorData>::iterator begin) {
-	auto it = begin;
-	auto lastHrInVec = heartRateVecRaw.size() ? heartRateVecRaw.size() - 1 : -1;
+void Data::resetTimeBase() {
+	timeBase.reset();
+}
 
-	for (; it != sensorDataSet.end(); ++it) {
-		auto sd = *it;
-		if (beatDetector.addSample(sd.getMs(), sd.getIrLed() * -1)) {
-			if (!beatSet.empty()) {
-				heartRateVecRaw.push_back(HeartRate(
-					(*beatSet.rbegin()),	// begin
-					sd.getMs()				// end
-				));
-			}
-			beatSet.insert(sd.getMs());
+void Data::processNewFrame(const SensorFrame & frame) {
+	if (frame.empty())
+		return;
+	worker->process(frame, timeBase.anchor(frame), generation);
+}
+
+void Data::consumeBatches() {
+	ProcessedBatch batch;
+	bool received = false;
+	while (batchQueue.pop(batch)) {
+		if (batch.generation != generation)
+			continue;
+		received = true;
+		size_t appended = 0;
+		for (auto & row : batch.samples) {
+			if (!sensorData.append(row.getMs(), row.getIrLed(), row.getRedLed()))
+				continue;
+			irMinMax.push(row.getMs(), row.getIrLed());
+			redMinMax.push(row.getMs(), row.getRedLed());
+			batch.samples[appended++] = row;
+		}
+		// the journal holds exactly what the stores hold
+		batch.samples.resize(appended);
+		// a snapshot taken before this batch is appended must not count as saving it
+		if (appended > 0 || !batch.beats.empty() || !batch.heartRates.empty() || !batch.spo2.empty()) {
+			dataSaved = false;
+			++revision;
 		}
+		// replayed and generated frames have no receiving time
+		if (appended > 0 && batch.receivedNs != 0)
+			latency.processed(batch.receivedNs, batch.samples.back().getMs());
+		beatSet.insert(batch.beats.begin(), batch.beats.end());
+		heartRateVecRaw.insert(heartRateVecRaw.end(), batch.heartRatesRaw.begin(), batch.heartRatesRaw.end());
+		for (auto & hr : batch.heartRates) {
+			heartRateVec.push_back(hr);
+			hrMinMax.push(hr.getBeginMs(), hr.getHR());
+		}
+		for (auto & spo2 : batch.spo2) {
+			spo2Vec.push_back(spo2);
+			spo2MinMax.push(spo2.getMs(), spo2.getSpO2());
+		}
+		if (journal->isOpen())
+			journal->append(std::move(batch));
 	}
+	// the queue has room again for batches the worker had to put aside
+	worker->resume();
+	if (!received || sensorData.empty())
+		return;
+	updatePyramids();
+	applyMemoryBudget();
 
-	// Compute quantile mean
-	for (int i = lastHrInVec + 1; i < heartRateVecRaw.size(); ++i) {
-		auto quantileBegin = heartRateVecRaw.begin();
-		if((i - (int)quantileMeanN + 1) >= 0)
-			std::advance(quantileBegin, i - quantileMeanN + 1);
-		auto quantileEnd = heartRateVecRaw.begin();
-		std::advance(quantileEnd, i + 1);
-
-		heartRateVec.emplace_back(
-			heartRateVecRaw.at(i).getBeginMs(),
-			heartRateVecRaw.at(i).getEndMs(),
-			quantileMean<HeartRate>(quantileBegin, quantileEnd,
-				[](const HeartRate & v)->double { return v.getHR(); }
-			)
-		);
-	}
-}
+	irMinMax.evictNotLaterThan(sensorData.back().getMs() - minMaxRangeSize * 1000);
+	redMinMax.evictNotLaterThan(sensorData.back().getMs() - minMaxRangeSize * 1000);
+	if (!heartRateVec.empty())
+		hrMinMax.evictNotLaterThan(heartRateVec.back().getEndMs() - minMaxRangeSize * 1000);
+	if (!spo2Vec.empty())
+		spo2MinMax.evictNotLaterThan(spo2Vec.back().getMs() - minMaxRangeSize * 1000);
 
-QVector<double> Data::getSensorData(double dataLaterThan, const std::function<double(const SensorData&)> & fMap) {
-	auto begin = getRangeBegin(dataLaterThan);
-	auto size = std::distance(begin, sensorDataSet.end());
-	QVector<double> data(size);
-	std::transform(begin, sensorDataSet.end(), data.begin(), fMap);
-	return data;
+	emit receivedNewData();
 }
 
-std::set<SensorData>::iterator Data::getRangeBegin(double laterThanCustomPlotMs) {
+size_t Data::getRangeBegin(double laterThanCustomPlotMs) {
 	return getRangeBegin(customPlotMsToMs(laterThanCustomPlotMs));
 }
 
-std::set<SensorData>::iterator Data::getRangeBegin(qint64 laterThanMs) {
-	return std::find_if(sensorDataSet.begin(), sensorDataSet.end(),
-		[laterThanMs](const SensorData & data)->bool {
-			return data.getMs() > laterThanMs;
-	});
+size_t Data::getRangeBegin(qint64 laterThanMs) {
+	return sensorData.upperBound(laterThanMs);
 }
 
-std::pair<double, double> Data::sensorDataMinMax(
-	const std::set<SensorData>::iterator & begin,
-	const std::set<SensorData>::iterator & end)
-{
-	if (std::distance(begin, end) == 0 || (!irDataEnabled && !redDataEnabled))
-		return std::pair<double, double>(0, 1);
 
-	std::set<int> tmp;
-	if (irDataEnabled) {
-		std::transform(begin, end, std::inserter(tmp, tmp.begin()),
-			[](const SensorData & data)->int {
-			return data.getIrLed();
+std::vector<HeartRate>::iterator Data::getHeartRateBegin(qint64 laterThanMs) {
+	return std::upper_bound(heartRateVec.begin(), heartRateVec.end(), laterThanMs,
+		[](qint64 ms, const HeartRate & hr)->bool {
+		return ms < hr.getBeginMs();
+	});
+}
+
+void Data::setMinMaxRange(int rangeSizeInSeconds) {
+	minMaxRangeSize = rangeSizeInSeconds;
+	irMinMax.clear();
+	redMinMax.clear();
+	hrMinMax.clear();
+	spo2MinMax.clear();
+
+	if (!sensorData.empty()) {
+		auto begin = std::min(
+			getRangeBegin(sensorData.back().getMs() - minMaxRangeSize * 1000),
+			sensorData.size() - 1);
+		sensorData.forEach(begin, sensorData.size(), [this](qint64 ms, int ir, int red) {
+			irMinMax.push(ms, ir);
+			redMinMax.push(ms, red);
 		});
 	}
-	if (redDataEnabled) {
-		std::transform(begin, end, std::inserter(tmp, tmp.begin()),
-			[](const SensorData & data)->int {
-			return data.getRedLed();
+	if (!heartRateVec.empty()) {
+		auto hrBegin = getHeartRateBegin(heartRateVec.back().getEndMs() - minMaxRangeSize * 1000);
+		if (hrBegin == heartRateVec.end())
+			--hrBegin;
+		for (; hrBegin != heartRateVec.end(); ++hrBegin)
+			hrMinMax.push(hrBegin->getBeginMs(), hrBegin->getHR());
+	}
+	if (!spo2Vec.empty()) {
+		auto spo2Begin = std::upper_bound(spo2Vec.begin(), spo2Vec.end(), spo2Vec.back().getMs() - minMaxRangeSize * 1000,
+			[](qint64 ms, const SpO2 & spo2)->bool {
+			return ms < spo2.getMs();
 		});
+		for (; spo2Begin != spo2Vec.end(); ++spo2Begin)
+			spo2MinMax.push(spo2Begin->getMs(), spo2Begin->getSpO2());
 	}
-	return std::pair<double, double>(*tmp.begin(), *tmp.rbegin());
 }
 
-std::vector<HeartRate>::iterator Data::getHeartRateBegin(qint64 laterThanMs) {
-	return std::find_if(heartRateVec.begin(), heartRateVec.end(),
-		[laterThanMs](const HeartRate & hr)->bool {
-		return hr.getBeginMs() > laterThanMs;
+void Data::updatePyramids() {
+	sensorData.forEach(irPyramid.size(), sensorData.size(), [this](qint64, int ir, int red) {
+		irPyramid.push(ir);
+		redPyramid.push(red);
 	});
+	irPyramid.propagate();
+	redPyramid.propagate();
 }
 
-std::pair<double, double> Data::heartRateMinMax(
-	const std::vector<HeartRate>::iterator & begin, 
-	const std::vector<HeartRate>::iterator & end
-) {
-	auto minMax = std::minmax_element(begin, end, 
-		[](const HeartRate & l, const HeartRate & r)->bool {
-			return l.getHR() < r.getHR();
-	});
-	return std::pair<double, double>(
-			(*(minMax.first)).getHR(),
-			(*(minMax.second)).getHR()
-		);
+void Data::applyMemoryBudget() {
+	if (memoryBudget <= 0)
+		return;
+	// a resident chunk also holds the lower pyramid levels of its samples
+	auto chunkBytes = SensorDataStore::chunkBytes();
+	for (int level = 0; level < chunkPyramidLevel(); ++level)
+		chunkBytes += SENSOR_DATA_CHUNK_SIZE / MinMaxPyramid<int>::bucketSize(level) * 2 * sizeof(int) * 2;
+	auto maxResident = std::max<size_t>(MIN_RESIDENT_CHUNKS, size_t(memoryBudget) / chunkBytes);
+	if (sensorData.residentChunks() <= maxResident)
+		return;
+	sensorData.spill(maxResident);
+	irPyramid.release(sensorData.spilledSize(), chunkPyramidLevel());
+	redPyramid.release(sensorData.spilledSize(), chunkPyramidLevel());
+}
+
+void Data::setMemoryBudget(qint64 bytes) {
+	memoryBudget = bytes;
+	applyMemoryBudget();
 }
 
 double Data::msToCustomPlotMs(qint64 ms) {
@@ -361,9 +599,3 @@ double Data::msToCustomPlotMs(qint64 ms) {
 qint64 Data::customPlotMsToMs(double cMs) {
 	return cMs * 1000 + 0.5;
 }
-
-std::string Data::timestampStringFromMsSinceEpoch(qint64 ms) {
-	return QDateTime::fromMSecsSinceEpoch(ms)
-		.toString("yyyy-MM-dd hh:mm:ss.zzz")
-		.toStdString();
-}
@@ -3,111 +3,218 @@
 #include <QObject>
 #include <set>
 #include <vector>
-#include <functional>
-#include <iir/Butterworth.h>
-#include "MAX30100_BeatDetector.h"
 #include "HeartRate.h"
+#include "SpO2.h"
+#include "MinMaxPyramid.h"
 #include "SensorData.h"
+#include "SensorFrame.h"
+#include "SensorDataStore.h"
+#include "SlidingMinMax.h"
+#include "DataWorker.h"
+#include "Clock.h"
+#include "DataSnapshot.h"
+#include "LatencyMonitor.h"
+#include "SessionJournalWorker.h"
 
 auto constexpr TIMER_INTERVAL = 1000;	/**< Okres wysyłanie żądań typu GET w milisekundach. */
-auto constexpr FILTER_ORDER = 2;		/**< Rząd filtru. */
-
-auto constexpr SAMPLING_RATE = 100.0;	/**< Częstotliwość próbkowania czujnika w Hz. */
-auto constexpr LOW_CUT_FREQ = 1.4;		/**< Dolna częstotliwość odcięcia filtru w Hz. */// Hz
-auto constexpr HIGH_CUT_FREQ = 6;		/**< Górna częstotliwość odcięcia filtru w Hz. */// Hz
+auto constexpr DEFAULT_MEMORY_BUDGET = qint64(64) << 20;	/**< Domyślny budżet pamięci próbek w bajtach. */
 
 class QTimer;
+class DeviceApi;
+
+/**
+ * Dane diod do wyświetlenia na wykresie.
+ */
+struct SensorPlotData {
+	QVector<double> x;		/**< Stemple czasowe w milisekundach w formacie custom plot. */
+	QVector<double> ir;		/**< Wartości diody podczerwonej. */
+	QVector<double> red;	/**< Wartości diody czerwonej. */
+	int level = -1;			/**< Poziom piramidy min/max, -1 jeżeli dane nie zostały zdecymowane. */
+};
 
 /**
  * Klasa odpowiedzialna za przetwarzanie danych.
+ * Każdy obiekt obsługuje jedną sesję pomiarową, czyli jeden moduł WiFi reprezentowany przez DeviceApi.
+ * Filtracja i detekcja pulsu wykonywane są w puli wątków przez obiekt DataWorker.
+ * Przetworzone paczki odbierane są z kolejki bezblokadowej i dopisywane do magazynów w wątku GUI,
+ * dlatego gettery mogą być bezpiecznie wywoływane z GUI w trakcie pracy wątku przetwarzającego.
+ * Próbki przekraczające budżet pamięci (Data::setMemoryBudget) przenoszone są na dysk
+ * i wczytywane ponownie przy odczycie, np. przy przewinięciu wykresu do historii.
  */
 class Data : public QObject
 {
 	Q_OBJECT
 private:
 	bool dataSaved = true;
+	quint64 revision = 0;
+	bool running = false;
+	bool streamingEnabled = false;
 
 	QTimer * timer;
+	DeviceApi * devApi;
 
-	Iir::Butterworth::BandPass<FILTER_ORDER> redFilter;
-	Iir::Butterworth::BandPass<FILTER_ORDER> irFilter;
-	BeatDetector beatDetector;
+	DataWorker * worker;
+	BatchQueue batchQueue;
+	quint64 generation = 0;
 
 	const QString IR_DATA_NAME = "IR led";
 	const QString RED_DATA_NAME = "Red led";
 	const QString BEAT_DATA_NAME = "Beat";
 	const QString HEART_DATA_NAME = "Heart Rate";
+	const QString SPO2_DATA_NAME = "SpO2";
 	bool irDataEnabled = false;
 	bool redDataEnabled = false;
 	bool hrDataEnabled = false;
+	bool spo2DataEnabled = false;
+
+	SessionJournalWorker * journal;
 
-	std::set<SensorData> sensorDataSet;
+	SensorDataStore sensorData;
 	std::set<qint64> beatSet;
 	std::vector<HeartRate> heartRateVecRaw;
 	std::vector<HeartRate> heartRateVec;
-	unsigned int quantileMeanN = 10;
+	std::vector<SpO2> spo2Vec;
 
-	qint64 begMs = 0;
+	SlidingMinMax<int> irMinMax;
+	SlidingMinMax<int> redMinMax;
+	SlidingMinMax<double> hrMinMax;
+	SlidingMinMax<double> spo2MinMax;
+	int minMaxRangeSize = 10;
 
+	MinMaxPyramid<int> irPyramid;
+	MinMaxPyramid<int> redPyramid;
+	qint64 memoryBudget = DEFAULT_MEMORY_BUDGET;
+
+	TimeBase timeBase;
+	LatencyMonitor latency;
+
+	template<class Functor>
 	QVector<double> getSensorData(
 		double dataLaterThan, 
-		const std::function<double(const SensorData &)> & fMap);
-	std::set<SensorData>::iterator getRangeBegin(double laterThanCustomPlotMs);
-	std::set<SensorData>::iterator getRangeBegin(qint64 laterThanMs);
-	std::pair<double, double> sensorDataMinMax(
-		const std::set<SensorData>::iterator & begin,
-		const std::set<SensorData>::iterator & end);
+		const Functor & fMap);
+	size_t getRangeBegin(double laterThanCustomPlotMs);
+	size_t getRangeBegin(qint64 laterThanMs);
 	std::vector<HeartRate>::iterator getHeartRateBegin(qint64 laterThanMs);
-	std::pair<double, double> heartRateMinMax(
-		const std::vector<HeartRate>::iterator & begin,
-		const std::vector<HeartRate>::iterator & end
-	);
-	template<class T>
-	double quantileMean(
-		const typename std::vector<T>::iterator & begin,
-		const typename std::vector<T>::iterator & end
-	);
-	template<class T, class Functor>
-	double quantileMean(
-		const typename std::vector<T>::iterator & begin,
-		const typename std::vector<T>::iterator & end,
-		const Functor & mapF
-	);
-	static std::string timestampStringFromMsSinceEpoch(qint64 ms);
+	void setMinMaxRange(int rangeSizeInSeconds);
+	void updatePyramids();
+	void applyMemoryBudget();
 
 public:
 	/**
-	 * Domyślny konstruktor.
+	 * Konstruktor inicjalizujący.
+	 * @param devApi_ Moduł WiFi, z którego odczytywane są dane sesji.
 	 * @param parent Przodek obiektu.
 	 */
-	Data(QObject *parent);
+	Data(DeviceApi * devApi_, QObject *parent);
 
 	/**
-	 * Domyślny destruktor.
+	 * Destruktor, czeka na zakończenie przetwarzania w puli wątków.
 	 */
-	~Data() {};
+	~Data();
 
 	/**
-	 * Metoda startuje timer.
+	 * Metoda startuje akwizycję danych.
+	 * W trybie strumieniowym otwierane jest połączenie WebSocket, w przeciwnym razie startuje timer.
 	 */
 	void start();
 
 	/**
-	 * Metoda zatrzymuje timer.
+	 * Metoda zatrzymuje akwizycję danych.
 	 */
 	void stop();
 
+	/**
+	 * Czeka na przetworzenie zleconych paczek i dopisuje je do magazynów, np. przed zapisem danych
+	 * po zatrzymaniu akwizycji. Blokuje wątek wywołujący.
+	 */
+	void drain();
+
+	/**
+	 * Aktywuje tryb strumieniowy, w którym moduł WiFi sam wysyła nowe próbki przez WebSocket.
+	 * Jeżeli połączenie zostanie zerwane, akwizycja kontynuowana jest odpytywaniem modułu.
+	 * @param enabled true - tryb strumieniowy, false - odpytywanie co TIMER_INTERVAL.
+	 */
+	void setStreamingEnabled(bool enabled);
+
+	/**
+	 * Setter.
+	 * Zmienia źródło czasu używane do wyznaczenia początku pomiarów, np. na zegar wirtualny.
+	 * @param clock Źródło czasu, musi istnieć przez cały czas życia obiektu.
+	 */
+	void setClock(const Clock * clock);
+
+	/**
+	 * Setter.
+	 * Najstarsze próbki przekraczające budżet, wraz z niższymi poziomami piramid min/max, przenoszone są
+	 * do pliku tymczasowego (SensorDataStore::spill). W pamięci pozostają uderzenia serca i wartości pulsu,
+	 * czyli ok. 1% danych sesji.
+	 * @param bytes Budżet pamięci próbek w bajtach, 0 - bez ograniczeń.
+	 */
+	void setMemoryBudget(qint64 bytes);
+
 	/**
 	 * Metoda czyści zgormadzone dane.
 	 */
 	void clear();
 
 	/**
-	 * Metoda zapisuje dane do pilku .xlsx.
+	 * Metoda zapisuje dane do pilku .xlsx, .csv lub .ndjson (TextExporter) w bieżącym wątku.
+	 * Długie sesje należy zapisywać w tle przy pomocy XlsxExporter i Data::snapshot.
 	 * @param filepath Ścieżka do pliku.
-	 * @see https://github.com/troldal/OpenXLSX
+	 * @return false jeżeli zapis się nie powiódł.
+	 */
+	bool saveAs(const QString & filepath);
+
+	/**
+	 * Wykonuje spójną migawkę danych, np. do zapisu w innym wątku.
+	 * Koszt nie zależy od liczby próbek, bloki magazynu próbek są współdzielone.
+	 * @return Migawka danych.
+	 */
+	DataSnapshot snapshot() const;
+
+	/**
+	 * Oznacza dane jako zapisane, o ile od wykonania migawki nie odebrano nowych danych.
+	 * @param snapshotRevision Wersja zapisanych danych, DataSnapshot::revision.
+	 */
+	void markSaved(quint64 snapshotRevision);
+
+	/**
+	 * Getter.
+	 * @return Histogramy opóźnień odebranych paczek.
+	 */
+	const LatencyMonitor & getLatency() const {
+		return latency;
+	}
+
+	/**
+	 * Zapisuje opóźnienia paczek dopisanych od poprzedniego odświeżenia wykresu.
+	 * Wywoływana po zakończeniu odświeżenia wykresu.
+	 * @see LatencyMonitor::rendered
+	 */
+	void markRendered();
+
+	/**
+	 * Rozpoczyna zapis dziennika sesji, do którego na bieżąco dopisywane są próbki, uderzenia serca i wartości pulsu.
+	 * Dotychczasowe dane zapisywane są w pierwszym bloku dziennika, Data::clear rozpoczyna dziennik od nowa.
+	 * Zapis wykonywany jest we własnym wątku, o niepowodzeniu informuje sygnał journalFailed.
+	 * @param path Ścieżka do pliku dziennika, istniejący plik jest nadpisywany.
+	 * @see SessionJournalWorker
+	 */
+	void startJournal(const QString & path);
+
+	/**
+	 * Odtwarza dane z dziennika sesji przerwanej awarią i kontynuuje jego zapis.
+	 * Dotychczasowe dane są usuwane, odtworzone dane oznaczane są jako niezapisane.
+	 * Średnia obcięta pulsu liczona jest od nowa dla kolejnych uderzeń.
+	 * @param path Ścieżka do pliku dziennika.
+	 * @return false jeżeli dziennika nie można odczytać lub kontynuować jego zapisu.
+	 */
+	bool recoverJournal(const QString & path);
+
+	/**
+	 * Kończy zapis dziennika i usuwa jego pliki, np. przy zamknięciu programu.
 	 */
-	void saveAs(const QString & filepath);
+	void discardJournal();
 
 	/**
 	 * Aktywuje serię danych związaną z diodą podczerwoną.
@@ -124,6 +231,11 @@ public:
 	 */
 	void setHearRateEnabled(bool enabled);
 
+	/**
+	 * Aktywuje serię danych związaną z saturacją krwi tlenem.
+	 */
+	void setSpO2Enabled(bool enabled);
+
 	/**
 	 * Getter
 	 * @return Nazwa serii danych diody IR
@@ -162,6 +274,20 @@ public:
 	 */
 	QVector<double> getYRedSensorData(double dataLaterThan = -1.0);
 
+	/**
+	 * Getter.
+	 * Dane diod z zakresu czasu do wyświetlenia na wykresie, niezależnie od długości sesji złożone z co najwyżej
+	 * maxPoints punktów na serię. Jeżeli zakres zawiera więcej próbek, dla każdego przedziału najniższego
+	 * wystarczającego poziomu piramidy min/max zwracane są dwa punkty o tym samym stemplu czasowym:
+	 * minimum i maksimum przedziału. Zwracana jest również jedna próbka lub przedział poza zakresem z każdej strony,
+	 * aby linia wykresu dochodziła do krawędzi.
+	 * @param fromCustomPlotMs Początek zakresu, milisekundy w formacie custom plot.
+	 * @param toCustomPlotMs Koniec zakresu, milisekundy w formacie custom plot.
+	 * @param maxPoints Maksymalna liczba punktów serii, np. dwukrotność szerokości wykresu w pikselach.
+	 * @return Dane wykresu.
+	 */
+	SensorPlotData getSensorPlotData(double fromCustomPlotMs, double toCustomPlotMs, int maxPoints) const;
+
 	/**
 	 * Getter.
 	 * @return Stempel czasowy ostatniej odczytanej danej z sensora, 
@@ -172,6 +298,7 @@ public:
 	/**
 	 * Getter.
 	 * Wyznacza minimalną i maksymalną wartość z zakresu od ostatniej danej minus rangeSizeInSeconds do ostatniej danej.
+	 * Wartości utrzymywane są przyrostowo w przesuwnych oknach, zmiana zakresu powoduje ich jednorazowe przeliczenie.
 	 * @param rangeSizeInSeconds zakres wyświetlanych danych.
 	 * @return Minimalną i maksymalną wartość spośród serii:
 	 *	- wartości diody podczerwonej,
@@ -201,6 +328,7 @@ public:
 
 	/**
 	 * Setter.
+	 * Okno średniej obciętej odtwarzane jest z ostatnich n wartości pulsu.
 	 * @param n Liczba próbek do liczenia średniej.
 	 */
 	void setHeartRateQuantileN(unsigned int n);
@@ -229,15 +357,67 @@ public:
 
 	/**
 	 * Getter.
+	 * Wartości pulsu są wyłącznie dopisywane, więc liczba zwrócona przy poprzednim odświeżeniu
+	 * może posłużyć za kursor do pobrania samych nowych wartości (Data::getXHRData, Data::getYHRData).
+	 * Liczba mniejsza od poprzedniej oznacza, że dane zostały wyczyszczone.
+	 * @return Liczba wartości pulsu (uśrednionych).
+	 */
+	size_t getHeartRateCount() const;
+
+	/**
+	 * Getter.
+	 * @param i Indeks wartości pulsu, mniejszy od Data::getHeartRateCount.
+	 * @return Wartość pulsu (uśredniona).
+	 */
+	const HeartRate & getQuantileMeanHeartRateAt(size_t i) const;
+
+	/**
+	 * Getter.
+	 * @param from Indeks pierwszej zwracanej wartości pulsu.
 	 * @return Stemple czasowe pulsu wyrażone w milisekudach sformatowanych zgodnie z formatem custom plot.
 	 */
-	QVector<double> getXHRData() const;
+	QVector<double> getXHRData(size_t from = 0) const;
 
 	/**
 	 * Getter.
+	 * @param from Indeks pierwszej zwracanej wartości pulsu.
 	 * @return Wartości pulsu wyrażone w uderzeniach serca na minutę [BPM].
 	 */
-	QVector<double> getYHRData() const;
+	QVector<double> getYHRData(size_t from = 0) const;
+
+	/**
+	 * Getter.
+	 * @return Nazwa serii saturacji krwi tlenem.
+	 */
+	QString getSpO2DataName() const;
+
+	/**
+	 * Getter.
+	 * Oszacowania saturacji są wyłącznie dopisywane, podobnie jak wartości pulsu (Data::getHeartRateCount).
+	 * @return Liczba oszacowań saturacji krwi tlenem.
+	 */
+	size_t getSpO2Count() const;
+
+	/**
+	 * Getter.
+	 * @param i Indeks oszacowania, mniejszy od Data::getSpO2Count.
+	 * @return Oszacowanie saturacji krwi tlenem.
+	 */
+	const SpO2 & getSpO2At(size_t i) const;
+
+	/**
+	 * Getter.
+	 * @param from Indeks pierwszego zwracanego oszacowania.
+	 * @return Stemple czasowe oszacowań saturacji sformatowane zgodnie z formatem custom plot.
+	 */
+	QVector<double> getXSpO2Data(size_t from = 0) const;
+
+	/**
+	 * Getter.
+	 * @param from Indeks pierwszego zwracanego oszacowania.
+	 * @return Saturacja krwi tlenem w procentach.
+	 */
+	QVector<double> getYSpO2Data(size_t from = 0) const;
 
 	/**
 	 * Konterter milisekund na format custom plot.
@@ -269,54 +449,64 @@ protected slots:
 	void timerTimeout();
 
 	/**
-	 * Metoda wywoływana po odebraniu nowej paczki danych.
-	 * Średnio raz na sekundę. Ilość danych to 130 (cały bufor w module ESP8266-12E).
-	 * Część danych jest pomijana ponieważ w ciągu  1 sekundy gromadzonych jest 100 pomiarów.
-	 * Dzięki temu zabiegowi zapewniona jest ciągłość danych.
-	 * Następnie dane podawane są filtracji za pomocą filtru pasmowoprzepustowgo IIR Butterworha drugiego rzędu.
-	 * Dolna częstotliwość odcięcia to 1.4Hz, a górna 6Hz. 
-	 * Przefiltrowane próbki pochodzące z diody podczerwonej trafiają do datektora uderzeń serca.
+	 * Metoda przetwarzająca paczkę danych w formacie JSON.
+	 * Dane dekodowane są do postaci ramki i przekazywane dalej, 
+	 * paczka nie może zawierać próbek przetworzonych wcześniej.
 	 * @param data_ Dane odebrane z modułu WiFi.
-	 * @see Data::detectHeartRate
-	 * @see https://github.com/berndporr/iir1
+	 * @see Data::processNewFrame
 	 */
 	void processNewData(const QString & data_);
 
 	/**
-	 * Metoda służąca do detekcji pulsu.
-	 * Na początek próbki trafiają do detektora uderzeń serca.
-	 * Jeżeli wykryte zostanie uderzenie to następuje detekcja pulsu.
-	 * @param begin Iterator początku nowych danych w zbiorze.
-	 * @see https://github.com/oxullo/Arduino-MAX30100
+	 * Metoda wywoływana po odebraniu nowej paczki danych.
+	 * Średnio raz na sekundę. DeviceApi przekazuje wyłącznie próbki, które nie zostały wcześniej odebrane,
+	 * dzięki czemu każda próbka jest przetwarzana dokładnie raz i dopisywana na końcu magazynu.
+	 * Metoda wyznacza początek pomiarów i przekazuje paczkę do puli wątków.
+	 * @param frame Paczka próbek odebrana z modułu WiFi.
+	 * @see SignalPipeline::process
+	 */
+	void processNewFrame(const SensorFrame & frame);
+
+	/**
+	 * Metoda odbierająca przetworzone paczki z kolejki obiektu DataWorker.
+	 * Próbki i wartości pulsu dopisywane są do magazynów, aktualizowane są przesuwne okna i piramidy min/max.
+	 * Paczki wyznaczone przed wywołaniem Data::clear są pomijane.
 	 */
-	void detectHeartRate(std::set<SensorData>::iterator begin);
+	void consumeBatches();
+
+	/**
+	 * Metoda wywoływana po restarcie modułu WiFi.
+	 * Początek pomiarów zostanie wyznaczony na nowo przy odebraniu kolejnej paczki danych.
+	 */
+	void resetTimeBase();
+
+	/**
+	 * Metoda wywoływana po zerwaniu połączenia WebSocket, przełącza akwizycję na odpytywanie modułu.
+	 */
+	void streamingStopped();
 
 signals:
 	/**
 	 * Sygnał emitowany w momencie zakończenia analizy nowych danych.
 	 */
 	void receivedNewData();
-};
 
-template<class T> inline double Data::quantileMean(
-	const typename std::vector<T>::iterator & begin, 
-	const typename std::vector<T>::iterator & end) 
-{
-	return quantileMean(begin, end, [](const T & v)->double { return double(v); });
-}
+	/**
+	 * Sygnał emitowany, jeżeli dziennika sesji nie udało się utworzyć lub zapisać.
+	 * Dane nie zostaną wtedy odtworzone po awarii programu.
+	 */
+	void journalFailed();
+};
 
-template<class T, class Functor> inline double Data::quantileMean(
-	const typename std::vector<T>::iterator & begin,
-	const typename std::vector<T>::iterator & end,
-	const Functor & mapF)
+template<class Functor> inline QVector<double> Data::getSensorData(
+	double dataLaterThan,
+	const Functor & fMap)
 {
-	std::vector<double> vals(std::distance(begin, end));
-	std::transform(begin, end, vals.begin(), mapF);
-	std::sort(vals.begin(), vals.end());
-	int beginIndex = vals.size() * 0.3; //> 3 ? 1 : 0;
-	int endIndex = vals.size() - beginIndex;
-	double sum = std::accumulate(
-		vals.begin() + beginIndex,
-		vals.begin() + endIndex, 0.0);
-	return sum / (endIndex - beginIndex);
+	auto begin = getRangeBegin(dataLaterThan);
+	QVector<double> data;
+	data.reserve(int(sensorData.size() - begin));
+	sensorData.forEach(begin, sensorData.size(), [&data, &fMap](qint64 ms, int ir, int red) {
+		data.append(fMap(ms, ir, red));
+	});
+	return data;
 }
@@ -0,0 +1,19 @@
+#pragma once
+#include <QtGlobal>
+#include <vector>
+#include "HeartRate.h"
+#include "SpO2.h"
+#include "SensorDataStore.h"
+
+/**
+ * Spójna migawka danych sesji pomiarowej, np. do zapisu w innym wątku.
+ * Migawka nie zmienia się, gdy do obiektu Data dopisywane są kolejne próbki.
+ */
+struct DataSnapshot {
+	SensorDataStore sensorData;				/**< Próbki, współdzielone z magazynem Data. */
+	std::vector<qint64> beats;				/**< Stemple czasowe uderzeń serca. */
+	std::vector<HeartRate> heartRateRaw;	/**< Nieuśrednione wartości pulsu. */
+	std::vector<HeartRate> heartRate;		/**< Uśrednione wartości pulsu. */
+	std::vector<SpO2> spo2;					/**< Oszacowania saturacji krwi tlenem. */
+	quint64 revision = 0;					/**< Wersja danych w chwili wykonania migawki. */
+};
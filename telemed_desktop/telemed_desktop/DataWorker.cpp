@@ -0,0 +1,66 @@
+#include "DataWorker.h"
+
+DataWorker::DataWorker(BatchQueue * queue_, QThreadPool * pool, QObject * parent)
+	: QObject(parent),
+	queue(queue_),
+	strand(pool)
+{
+}
+
+void DataWorker::process(const SensorFrame & frame, qint64 begMs, quint64 generation) {
+	strand.post([this, frame, begMs, generation] {
+		ProcessedBatch batch;
+		batch.generation = generation;
+		batch.receivedNs = frame.getReceivedNs();
+		pipeline.process(frame, begMs, batch);
+		if (batch.samples.empty())
+			return;
+		pending.push_back(std::move(batch));
+		if (flushPending())
+			emit batchReady();
+	});
+}
+
+bool DataWorker::flushPending() {
+	if (pending.empty())
+		return false;
+	// set before pushing, a consumer draining the queue meanwhile will then call resume
+	stalled.store(true);
+	bool pushed = false;
+	while (!pending.empty() && queue->push(std::move(pending.front()))) {
+		pending.pop_front();
+		pushed = true;
+	}
+	if (pending.empty())
+		stalled.store(false);
+	return pushed;
+}
+
+void DataWorker::resume() {
+	if (!stalled.exchange(false))
+		return;
+	strand.post([this] {
+		if (flushPending())
+			emit batchReady();
+	});
+}
+
+void DataWorker::drain() {
+	strand.drain();
+}
+
+void DataWorker::setHeartRateQuantileN(unsigned int n) {
+	strand.post([this, n] {
+		pipeline.setHeartRateQuantileN(n);
+	});
+}
+
+void DataWorker::clearHistory() {
+	strand.post([this] {
+		pipeline.clearHistory();
+	});
+}
+
+void DataWorker::stop() {
+	strand.close();
+}
@@ -0,0 +1,93 @@
+#pragma once
+
+#include <QObject>
+#include <atomic>
+#include <deque>
+#include "SignalPipeline.h"
+#include "SessionStrand.h"
+#include "SpscQueue.h"
+
+class QThreadPool;
+
+auto constexpr BATCH_QUEUE_CAPACITY = 64;	/**< Liczba przetworzonych paczek oczekujących na odbiór przez wątek GUI. */
+
+using BatchQueue = SpscQueue<ProcessedBatch, BATCH_QUEUE_CAPACITY>;
+
+/**
+ * Klasa przetwarzająca próbki jednej sesji pomiarowej w puli wątków.
+ * Wszystkie operacje na potoku przetwarzania wykonywane są asynchronicznie, po kolei, w kolejności wywołań.
+ * Wyniki umieszczane są w kolejce BatchQueue, a o ich dostępności informuje sygnał batchReady.
+ */
+class DataWorker : public QObject
+{
+	Q_OBJECT
+private:
+	SignalPipeline pipeline;
+	BatchQueue * queue;
+	std::deque<ProcessedBatch> pending;
+	std::atomic<bool> stalled{ false };
+	SessionStrand strand;
+
+	bool flushPending();
+
+public:
+	/**
+	 * Konstruktor inicjalizujący.
+	 * @param queue_ Kolejka do której trafiają przetworzone paczki, obiekt jest jej jedynym producentem.
+	 * @param pool Pula wątków wykonująca przetwarzanie, współdzielona przez sesje.
+	 * @param parent Przodek obiektu.
+	 */
+	DataWorker(BatchQueue * queue_, QThreadPool * pool, QObject * parent = nullptr);
+
+	/**
+	 * Zleca przetworzenie paczki próbek i umieszczenie wyniku w kolejce.
+	 * Jeżeli kolejka jest pełna, paczka odkładana jest do czasu wywołania DataWorker::resume
+	 * - dane nie są porzucane, a wątek puli nie jest blokowany.
+	 * @param frame Paczka próbek ze stemplami czasowymi zegara modułu.
+	 * @param begMs Przesunięcie zegara modułu względem początku epoki w milisekundach.
+	 * @param generation Numer generacji danych.
+	 */
+	void process(const SensorFrame & frame, qint64 begMs, quint64 generation);
+
+	/**
+	 * Wznawia umieszczanie odłożonych paczek w kolejce, jeżeli wcześniej była pełna.
+	 * Wywoływana przez konsumenta po opróżnieniu kolejki.
+	 */
+	void resume();
+
+	/**
+	 * Czeka na wykonanie zleconych zadań. Blokuje wątek wywołujący.
+	 * Paczki odłożone przy pełnej kolejce pozostają odłożone, @see DataWorker::isStalled.
+	 */
+	void drain();
+
+	/**
+	 * Metoda sprawdzająca czy obiekt odłożył paczki, które nie zmieściły się w kolejce.
+	 */
+	bool isStalled() const {
+		return stalled.load();
+	}
+
+	/**
+	 * @see SignalPipeline::setHeartRateQuantileN
+	 */
+	void setHeartRateQuantileN(unsigned int n);
+
+	/**
+	 * @see SignalPipeline::clearHistory
+	 */
+	void clearHistory();
+
+	/**
+	 * Porzuca zlecone zadania i czeka na zakończenie bieżącego.
+	 * Po powrocie obiekt nie korzysta już z kolejki.
+	 */
+	void stop();
+
+signals:
+	/**
+	 * Sygnał informujący o umieszczeniu nowej paczki w kolejce.
+	 * Emitowany z wątku puli.
+	 */
+	void batchReady();
+};
@@ -3,7 +3,9 @@
 #include <QNetworkAccessManager>
 #include <QNetworkReply>
 #include <QNetworkRequest>
-
+#include <QTimer>
+#include <QWebSocket>
+#include "LatencyMonitor.h"
 
 DeviceApi::DeviceApi(QObject *parent)
 	: QObject(parent)
@@ -12,8 +14,9 @@ DeviceApi::DeviceApi(QObject *parent)
 	connect(manager, &QNetworkAccessManager::finished, this, &DeviceApi::networkResponse);
 }
 
-void DeviceApi::setLedCurrent(const QString & ledName, unsigned int I) {
+void DeviceApi::setLedCurrent(const QString & ledName, unsigned int I, ResponseSource source) {
 	QNetworkRequest request;
+	request.setAttribute(QNetworkRequest::User, source);
 	request.setUrl(
 		QUrl(tr("http://%1/set_led_current?%2=%3")
 			.arg(devIp)
@@ -28,29 +31,176 @@ void DeviceApi::setDeviceIp(const QString & ip) {
 }
 
 void DeviceApi::readNewMeasures() {
-	responseSource = DATA;
+	if (dataRequestPending)
+		return;
+	dataRequestPending = true;
+	requestData(binaryTransport ? DATA_BIN : DATA);
+}
+
+void DeviceApi::requestBackfill() {
+	backfillPending = true;
+	requestData(BACKFILL);
+}
+
+void DeviceApi::requestData(ResponseSource source) {
 	QNetworkRequest request;
-	request.setUrl(QUrl(tr("http://%1").arg(devIp)));
-	manager->get(request);
+	request.setAttribute(QNetworkRequest::User, source);
+	if (source == DATA)
+		request.setUrl(QUrl(tr("http://%1/?since=%2").arg(devIp).arg(nextSeq)));
+	else
+		request.setUrl(QUrl(tr("http://%1/bin?since=%2").arg(devIp).arg(nextSeq)));
+	auto reply = manager->get(request);
+	// a stalled reply would block polling, aborting it finishes the request with an error
+	QTimer::singleShot(DATA_REQUEST_TIMEOUT, reply, [reply] {
+		if (reply->isRunning())
+			reply->abort();
+	});
+}
+
+void DeviceApi::startStreaming() {
+	stopStreaming();
+	streaming = true;
+	// every connection gets its own socket, so a late close of the previous one is not reported
+	socket = new QWebSocket(QString(), QWebSocketProtocol::VersionLatest, this);
+	connect(socket, &QWebSocket::connected, this, &DeviceApi::socketConnected);
+	connect(socket, &QWebSocket::binaryMessageReceived, this, &DeviceApi::socketMessage);
+	connect(socket, &QWebSocket::disconnected, this, &DeviceApi::socketClosed);
+	connect(socket, qOverload<QAbstractSocket::SocketError>(&QWebSocket::error), this, &DeviceApi::socketClosed);
+	socket->open(QUrl(tr("ws://%1/ws").arg(devIp)));
+}
+
+void DeviceApi::stopStreaming() {
+	streaming = false;
+	heldFrames.clear();
+	if (!socket)
+		return;
+	socket->disconnect(this);
+	socket->close();
+	socket->deleteLater();
+	socket = nullptr;
+}
+
+void DeviceApi::setBinaryTransportEnabled(bool enabled) {
+	binaryTransport = enabled;
 }
 
 void DeviceApi::setIrLedCurrent(unsigned int I) {
-	responseSource = IR;
-	setLedCurrent("ir", I);
+	setLedCurrent("ir", I, IR);
 }
 
 void DeviceApi::setRedLedCurrent(unsigned int I) {
-	responseSource = RED;
-	setLedCurrent("red", I);
+	setLedCurrent("red", I, RED);
 }
 
 void DeviceApi::networkResponse(QNetworkReply * reply) {
+	auto receivedNs = LatencyMonitor::nowNs();
+	reply->deleteLater();
+	auto responseSource = reply->request().attribute(QNetworkRequest::User).toInt();
+	if (responseSource == DATA || responseSource == DATA_BIN)
+		dataRequestPending = false;
+	if (responseSource == BACKFILL) {
+		// held frames go on even if the backfill failed, the missed samples are lost then
+		backfillPending = false;
+		backfilled = true;
+		SensorFrame frame;
+		if (!reply->error() && SensorFrame::fromBinary(reply->readAll(), frame))
+			processFrame(frame, receivedNs);
+		else if (reply->error())
+			qDebug() << reply->errorString();
+		processHeldFrames();
+		return;
+	}
 	if (reply->error()) {
 		qDebug() << reply->errorString();
+		if (responseSource == DATA_BIN && reply->error() == QNetworkReply::ContentNotFoundError) {
+			qDebug() << "Binary frames not supported by device, falling back to JSON";
+			binaryTransport = false;
+		}
+		return;
+	}
+	SensorFrame frame;
+	if (responseSource == DATA_BIN) {
+		if (SensorFrame::fromBinary(reply->readAll(), frame))
+			processFrame(frame, receivedNs);
+	}
+	else if (responseSource == DATA) {
+		if (SensorFrame::fromJson(reply->readAll().toStdString(), frame))
+			processFrame(frame, receivedNs);
+	}
+}
+
+void DeviceApi::socketConnected() {
+	// samples between the last polled one and the first pushed frame are still in the ring buffer
+	requestBackfill();
+	emit streamingStarted();
+}
+
+void DeviceApi::socketMessage(const QByteArray & message) {
+	auto receivedNs = LatencyMonitor::nowNs();
+	SensorFrame frame;
+	if (!SensorFrame::fromBinary(message, frame))
 		return;
+	frame.setReceivedNs(receivedNs);
+	heldFrames.push_back(std::move(frame));
+	processHeldFrames();
+}
+
+void DeviceApi::processHeldFrames() {
+	while (!backfillPending && !heldFrames.empty()) {
+		auto & frame = heldFrames.front();
+		// a frame dropped by the module leaves a gap, fill it once from the ring buffer
+		if (frame.isSequenced() && nextSeq != 0 && frame.getSeq() > nextSeq && !backfilled) {
+			requestBackfill();
+			return;
+		}
+		backfilled = false;
+		processFrame(frame, frame.getReceivedNs());
+		heldFrames.pop_front();
 	}
-	if (responseSource == DATA) {
-		QString answer = reply->readAll();
-		emit newMeasuresData(std::move(answer));
+}
+
+void DeviceApi::socketClosed() {
+	if (!streaming)
+		return;
+	qDebug() << socket->errorString();
+	stopStreaming();
+	emit streamingStopped();
+}
+
+void DeviceApi::processFrame(SensorFrame & frame, qint64 receivedNs) {
+	frame.setReceivedNs(receivedNs);
+	if (frame.isSequenced()) {
+		auto end = frame.getSeq() + quint32(frame.size());
+		auto restarted = end < nextSeq;
+		if (!restarted && end > nextSeq && lastDeviceMs >= 0) {
+			// a rebooted module may already have produced nextSeq samples, its clock starts over though
+			auto first = frame.getSeq() < nextSeq ? nextSeq - frame.getSeq() : 0;
+			restarted = frame.getSamples()[first].getMs() < lastDeviceMs;
+		}
+		if (restarted) {
+			qDebug() << "Device restarted";
+			emit sequenceReset();
+			nextSeq = frame.getSeq();
+			lastDeviceMs = -1;
+		}
+		else if (frame.getSeq() > nextSeq && nextSeq != 0) {
+			qDebug() << "Lost" << frame.getSeq() - nextSeq << "samples";
+		}
+		frame.trimBefore(nextSeq);
+		nextSeq = frame.getSeq() + quint32(frame.size());
+	}
+	else {
+		// firmware without sequence numbers, overlapping samples are recognized by time
+		if (!frame.empty() && frame.getSamples().back().getMs() < lastDeviceMs) {
+			qDebug() << "Device restarted";
+			emit sequenceReset();
+			lastDeviceMs = -1;
+		}
+		frame.trimNotLaterThan(lastDeviceMs);
 	}
+
+	if (frame.empty())
+		return;
+	lastDeviceMs = frame.getSamples().back().getMs();
+	emit newMeasuresFrame(frame);
 }
\ No newline at end of file
@@ -2,9 +2,15 @@
 
 #include <QObject>
 #include <QUrl>
+#include <QAbstractSocket>
+#include <deque>
+#include "SensorFrame.h"
+
+auto constexpr DATA_REQUEST_TIMEOUT = 3000;	/**< Czas oczekiwania na odpowiedź z danymi w milisekundach, po którym żądanie jest przerywane. */
 
 class QNetworkReply;
 class QNetworkAccessManager;
+class QWebSocket;
 
 /**
  * Klasa odpowiedzialna za komunikację z modułem WiFi ESP8266-12E.
@@ -14,15 +20,30 @@ class DeviceApi : public QObject
 	Q_OBJECT
 private:
 	QNetworkAccessManager * manager;
+	QWebSocket * socket = nullptr;
 	QString devIp;
+	bool streaming = false;
+	bool binaryTransport = true;
+	bool dataRequestPending = false;
+	bool backfillPending = false;
+	bool backfilled = false;
+	std::deque<SensorFrame> heldFrames;
+	quint32 nextSeq = 0;
+	qint64 lastDeviceMs = -1;
 
 	enum ResponseSource {
 		DATA,
+		DATA_BIN,
 		IR,
-		RED
-	} responseSource = DATA;
+		RED,
+		BACKFILL
+	};
 
-	void setLedCurrent(const QString & ledName, unsigned int I);
+	void setLedCurrent(const QString & ledName, unsigned int I, ResponseSource source);
+	void requestData(ResponseSource source);
+	void requestBackfill();
+	void processHeldFrames();
+	void processFrame(SensorFrame & frame, qint64 receivedNs);
 
 public:
 	/**
@@ -60,18 +81,61 @@ public:
 
 signals:
 	/**
-	 * Sygnał emitowany po otrzymaniu nowych danych.
-	 * @param json Dane w formacie JSON.
+	 * Sygnał emitowany po otrzymaniu i zdekodowaniu nowych danych.
+	 * Paczka zawiera wyłącznie próbki, które nie zostały wcześniej wyemitowane.
+	 * @param frame Paczka próbek.
+	 */
+	void newMeasuresFrame(const SensorFrame & frame);
+
+	/**
+	 * Sygnał emitowany po wykryciu restartu modułu, 
+	 * numery sekwencyjne i stemple czasowe kolejnych próbek zaczynają się od nowa.
+	 */
+	void sequenceReset();
+
+	/**
+	 * Sygnał emitowany po nawiązaniu połączenia WebSocket.
+	 */
+	void streamingStarted();
+
+	/**
+	 * Sygnał emitowany po nieoczekiwanym zerwaniu lub nieudanym nawiązaniu połączenia WebSocket.
 	 */
-	void newMeasuresData(const QString & json);
+	void streamingStopped();
 
 public slots:
 	/**
 	 *  Metoda służąca do wysłania żadania odczytu nowych danych typu GET na adres
-	 *  <pre>http://192.168.4.1/</pre>
+	 *  <pre>http://192.168.4.1/bin?since=seq</pre>
+	 *  lub, jeżeli moduł nie obsługuje ramek binarnych, na adres
+	 *  <pre>http://192.168.4.1/?since=seq</pre>
+	 *  Parametr seq to numer sekwencyjny pierwszej próbki, która nie została jeszcze odebrana.
+	 *  Żądanie nie jest wysyłane, jeżeli poprzednie nie zostało jeszcze obsłużone.
+	 *  Żądanie bez odpowiedzi przerywane jest po DATA_REQUEST_TIMEOUT.
 	 */
 	void readNewMeasures();
 
+	/**
+	 * Metoda służąca do nawiązania połączenia WebSocket na adres
+	 * <pre>ws://192.168.4.1/ws</pre>
+	 * Moduł wysyła nowe próbki samodzielnie, w ramkach binarnych co kilka próbek.
+	 * Po nawiązaniu połączenia oraz po wykryciu luki w numerach sekwencyjnych próbki brakujące od ostatnio
+	 * odebranej pobierane są z bufora cyklicznego modułu (<pre>http://192.168.4.1/bin?since=seq</pre>),
+	 * a kolejne ramki WebSocket wstrzymywane są do czasu odebrania odpowiedzi.
+	 */
+	void startStreaming();
+
+	/**
+	 * Metoda służąca do zamknięcia połączenia WebSocket.
+	 */
+	void stopStreaming();
+
+	/**
+	 * Metoda służąca do wyboru formatu przesyłu danych.
+	 * @param enabled true - ramki binarne, false - JSON.
+	 */
+	void setBinaryTransportEnabled(bool enabled);
+
 	/**
 	 * Metoda służąca do zmiany adresu ip modułu WiFi.
 	 * W trybie Access Point używanie jej jest niezalecane.
@@ -94,4 +158,7 @@ public slots:
 
 private slots:
 	void networkResponse(QNetworkReply * reply);
+	void socketConnected();
+	void socketMessage(const QByteArray & message);
+	void socketClosed();
 };
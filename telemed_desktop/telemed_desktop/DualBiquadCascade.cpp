@@ -0,0 +1,79 @@
+#include "DualBiquadCascade.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define DUAL_BIQUAD_SSE2
+#include <emmintrin.h>
+#endif
+
+void DualBiquadCascade::setStage(int i, double a0, double a1, double a2, double b0, double b1, double b2) {
+	// iir1 keeps the coefficients divided by a0 and returns them multiplied back, a0 is 1 for its designs
+	auto & stage = stages[i];
+	stage.b0 = b0 / a0;
+	stage.b1 = b1 / a0;
+	stage.b2 = b2 / a0;
+	stage.a1 = a1 / a0;
+	stage.a2 = a2 / a0;
+	stageCount = i + 1;
+}
+
+void DualBiquadCascade::reset() {
+	for (int i = 0; i < BIQUAD_CASCADE_MAX_STAGES; ++i) {
+		v1[i][0] = v1[i][1] = 0.0;
+		v2[i][0] = v2[i][1] = 0.0;
+	}
+}
+
+void DualBiquadCascade::filter(double * a, double * b, size_t n) {
+	filter(a, b, a, b, n);
+}
+
+void DualBiquadCascade::filter(const double * inA, const double * inB, double * outA, double * outB, size_t n) {
+	// the operation order follows Iir::DirectFormII::filter, which keeps the results bit-identical
+#ifdef DUAL_BIQUAD_SSE2
+	__m128d b0[BIQUAD_CASCADE_MAX_STAGES], b1[BIQUAD_CASCADE_MAX_STAGES], b2[BIQUAD_CASCADE_MAX_STAGES];
+	__m128d a1[BIQUAD_CASCADE_MAX_STAGES], a2[BIQUAD_CASCADE_MAX_STAGES];
+	__m128d s1[BIQUAD_CASCADE_MAX_STAGES], s2[BIQUAD_CASCADE_MAX_STAGES];
+	for (int i = 0; i < stageCount; ++i) {
+		b0[i] = _mm_set1_pd(stages[i].b0);
+		b1[i] = _mm_set1_pd(stages[i].b1);
+		b2[i] = _mm_set1_pd(stages[i].b2);
+		a1[i] = _mm_set1_pd(stages[i].a1);
+		a2[i] = _mm_set1_pd(stages[i].a2);
+		s1[i] = _mm_load_pd(v1[i]);
+		s2[i] = _mm_load_pd(v2[i]);
+	}
+	for (size_t k = 0; k < n; ++k) {
+		auto x = _mm_set_pd(inB[k], inA[k]);
+		for (int i = 0; i < stageCount; ++i) {
+			auto w = _mm_sub_pd(_mm_sub_pd(x, _mm_mul_pd(a1[i], s1[i])), _mm_mul_pd(a2[i], s2[i]));
+			x = _mm_add_pd(_mm_add_pd(_mm_mul_pd(b0[i], w), _mm_mul_pd(b1[i], s1[i])), _mm_mul_pd(b2[i], s2[i]));
+			s2[i] = s1[i];
+			s1[i] = w;
+		}
+		_mm_storel_pd(outA + k, x);
+		_mm_storeh_pd(outB + k, x);
+	}
+	for (int i = 0; i < stageCount; ++i) {
+		_mm_store_pd(v1[i], s1[i]);
+		_mm_store_pd(v2[i], s2[i]);
+	}
+#else
+	const double * inputs[] = { inA, inB };
+	double * outputs[] = { outA, outB };
+	for (int c = 0; c < 2; ++c) {
+		auto in = inputs[c];
+		auto y = outputs[c];
+		for (size_t k = 0; k < n; ++k) {
+			auto out = in[k];
+			for (int i = 0; i < stageCount; ++i) {
+				auto & s = stages[i];
+				auto w = out - s.a1 * v1[i][c] - s.a2 * v2[i][c];
+				out = s.b0 * w + s.b1 * v1[i][c] + s.b2 * v2[i][c];
+				v2[i][c] = v1[i][c];
+				v1[i][c] = w;
+			}
+			y[k] = out;
+		}
+	}
+#endif
+}
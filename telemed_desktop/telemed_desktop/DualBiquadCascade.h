@@ -0,0 +1,66 @@
+#pragma once
+#include <array>
+#include <cstddef>
+
+auto constexpr BIQUAD_CASCADE_MAX_STAGES = 8;	/**< Maksymalna liczba sekcji bikwadratowych kaskady. */
+
+/**
+ * Kaskada sekcji bikwadratowych filtrująca blokami dwa kanały jednocześnie, np. diodę podczerwoną i czerwoną.
+ * Współczynniki kopiowane są z filtru biblioteki iir1 (DualBiquadCascade::setup), a każda sekcja liczona jest
+ * w postaci Direct Form II w tej samej kolejności działań co Iir::DirectFormII, więc wynik jest identyczny
+ * z filtrowaniem obu kanałów próbka po próbce przez dwa obiekty iir1.
+ * Na procesorach z SSE2 oba kanały liczone są w jednym rejestrze, na pozostałych - kolejno.
+ */
+class DualBiquadCascade {
+	struct Stage {
+		double b0 = 1.0, b1 = 0.0, b2 = 0.0;
+		double a1 = 0.0, a2 = 0.0;
+	};
+
+	std::array<Stage, BIQUAD_CASCADE_MAX_STAGES> stages;
+	int stageCount = 0;
+	// state of both channels side by side, {channel a, channel b}
+	alignas(16) double v1[BIQUAD_CASCADE_MAX_STAGES][2] = {};
+	alignas(16) double v2[BIQUAD_CASCADE_MAX_STAGES][2] = {};
+
+	void setStage(int i, double a0, double a1, double a2, double b0, double b1, double b2);
+
+public:
+	/**
+	 * Kopiuje współczynniki skonfigurowanego filtru iir1 (np. Iir::Butterworth::BandPass) i zeruje stan.
+	 * @param filter Filtr iir1, po wywołaniu setup.
+	 */
+	template<class Filter>
+	void setup(Filter & filter) {
+		stageCount = 0;
+		for (int i = 0; i < filter.getNumStages() && i < BIQUAD_CASCADE_MAX_STAGES; ++i) {
+			auto & stage = filter[i];
+			setStage(i, stage.getA0(), stage.getA1(), stage.getA2(), stage.getB0(), stage.getB1(), stage.getB2());
+		}
+		reset();
+	}
+
+	/**
+	 * Zeruje stan filtru obu kanałów.
+	 */
+	void reset();
+
+	/**
+	 * Filtruje blok próbek obu kanałów w miejscu.
+	 * @param a Próbki pierwszego kanału.
+	 * @param b Próbki drugiego kanału.
+	 * @param n Liczba próbek w każdym kanale.
+	 */
+	void filter(double * a, double * b, size_t n);
+
+	/**
+	 * Filtruje blok próbek obu kanałów, pozostawiając wejście bez zmian.
+	 * Wyjście może pokrywać się z wejściem.
+	 * @param inA Próbki pierwszego kanału.
+	 * @param inB Próbki drugiego kanału.
+	 * @param outA Bufor na przefiltrowane próbki pierwszego kanału.
+	 * @param outB Bufor na przefiltrowane próbki drugiego kanału.
+	 * @param n Liczba próbek w każdym kanale.
+	 */
+	void filter(const double * inA, const double * inB, double * outA, double * outB, size_t n);
+};
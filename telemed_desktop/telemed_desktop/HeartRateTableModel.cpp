@@ -0,0 +1,57 @@
+#include "HeartRateTableModel.h"
+#include "Data.h"
+
+HeartRateTableModel::HeartRateTableModel(const Data * source_, QObject * parent)
+	: QAbstractTableModel(parent), source(source_)
+{
+}
+
+void HeartRateTableModel::update() {
+	auto count = int(source->getHeartRateCount());
+	if (count < rows) {
+		beginResetModel();
+		rows = count;
+		endResetModel();
+	}
+	else if (count > rows) {
+		beginInsertRows(QModelIndex(), rows, count - 1);
+		rows = count;
+		endInsertRows();
+	}
+}
+
+int HeartRateTableModel::rowCount(const QModelIndex & parent) const {
+	return parent.isValid() ? 0 : rows;
+}
+
+int HeartRateTableModel::columnCount(const QModelIndex & parent) const {
+	return parent.isValid() ? 0 : COLUMN_COUNT;
+}
+
+QVariant HeartRateTableModel::data(const QModelIndex & index, int role) const {
+	if (role != Qt::DisplayRole || !index.isValid() || index.row() >= rows)
+		return QVariant();
+	// only rows in view are asked for, so they are formatted here instead of on insert
+	auto & hr = source->getQuantileMeanHeartRateAt(size_t(index.row()));
+	switch (index.column()) {
+	case TIMESTAMP:
+		return hr.getEndTimeStr();
+	case HEART_RATE:
+		return hr.getHRStr();
+	default:
+		return QVariant();
+	}
+}
+
+QVariant HeartRateTableModel::headerData(int section, Qt::Orientation orientation, int role) const {
+	if (role != Qt::DisplayRole || orientation != Qt::Horizontal)
+		return QAbstractTableModel::headerData(section, orientation, role);
+	switch (section) {
+	case TIMESTAMP:
+		return QString("Timestamp");
+	case HEART_RATE:
+		return QString("Heart Rate [bpm]");
+	default:
+		return QVariant();
+	}
+}
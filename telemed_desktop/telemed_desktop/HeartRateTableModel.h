@@ -0,0 +1,45 @@
+#pragma once
+#include <QAbstractTableModel>
+
+class Data;
+
+/**
+ * Model tabeli wartości pulsu (uśrednionych), odczytujący je bezpośrednio z obiektu Data.
+ * Wiersze formatowane są dopiero przy wyświetlaniu, więc koszt tabeli nie zależy od liczby wartości,
+ * a nowe wartości dodawane są jedną operacją wstawienia wierszy (HeartRateTableModel::update).
+ */
+class HeartRateTableModel : public QAbstractTableModel
+{
+	Q_OBJECT
+private:
+	const Data * source;
+	int rows = 0;
+
+public:
+	/**
+	 * Kolumny tabeli.
+	 */
+	enum Column {
+		TIMESTAMP,
+		HEART_RATE,
+		COLUMN_COUNT
+	};
+
+	/**
+	 * Konstruktor inicjalizujący.
+	 * @param source_ Obiekt z danymi, musi istnieć przez cały czas życia modelu.
+	 * @param parent Przodek obiektu.
+	 */
+	HeartRateTableModel(const Data * source_, QObject * parent = nullptr);
+
+	/**
+	 * Uzgadnia liczbę wierszy z liczbą wartości pulsu, należy wywołać po każdej zmianie danych.
+	 * Nowe wartości wstawiane są na końcu, mniejsza liczba wartości (wyczyszczenie danych) resetuje model.
+	 */
+	void update();
+
+	int rowCount(const QModelIndex & parent = QModelIndex()) const override;
+	int columnCount(const QModelIndex & parent = QModelIndex()) const override;
+	QVariant data(const QModelIndex & index, int role = Qt::DisplayRole) const override;
+	QVariant headerData(int section, Qt::Orientation orientation, int role = Qt::DisplayRole) const override;
+};
@@ -0,0 +1,53 @@
+#include "LatencyHistogram.h"
+#include <algorithm>
+#include <cmath>
+
+int LatencyHistogram::bucketOf(qint64 value) {
+	if (value < SUB_BUCKETS)
+		return int(value);
+	// the highest LATENCY_SUB_BUCKET_BITS bits select the bucket within the magnitude
+	int magnitude = 0;
+	for (auto v = quint64(value) >> LATENCY_SUB_BUCKET_BITS; v != 0; v >>= 1)
+		++magnitude;
+	auto bucket = SUB_BUCKETS + (magnitude - 1) * HALF_SUB_BUCKETS
+		+ int(value >> magnitude) - HALF_SUB_BUCKETS;
+	return std::min(bucket, BUCKET_COUNT - 1);
+}
+
+qint64 LatencyHistogram::highestEquivalent(int bucket) {
+	if (bucket < SUB_BUCKETS)
+		return bucket;
+	auto magnitude = (bucket - SUB_BUCKETS) / HALF_SUB_BUCKETS + 1;
+	auto subBucket = (bucket - SUB_BUCKETS) % HALF_SUB_BUCKETS + HALF_SUB_BUCKETS;
+	return ((qint64(subBucket) + 1) << magnitude) - 1;
+}
+
+void LatencyHistogram::record(qint64 value) {
+	value = std::max<qint64>(value, 0);
+	++counts[bucketOf(value)];
+	minValue = total == 0 ? value : std::min(minValue, value);
+	maxValue = total == 0 ? value : std::max(maxValue, value);
+	sum += double(value);
+	++total;
+}
+
+void LatencyHistogram::clear() {
+	counts.fill(0);
+	total = 0;
+	minValue = 0;
+	maxValue = 0;
+	sum = 0.0;
+}
+
+qint64 LatencyHistogram::valueAtPercentile(double percentile) const {
+	if (total == 0)
+		return 0;
+	auto rank = std::max<quint64>(1, quint64(std::ceil(std::min(percentile, 100.0) / 100.0 * total)));
+	quint64 cumulative = 0;
+	for (int i = 0; i < BUCKET_COUNT; ++i) {
+		cumulative += counts[i];
+		if (cumulative >= rank)
+			return bucketValue(i);
+	}
+	return maxValue;
+}
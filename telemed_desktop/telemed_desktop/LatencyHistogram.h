@@ -0,0 +1,102 @@
+#pragma once
+#include <QtGlobal>
+#include <algorithm>
+#include <array>
+
+auto constexpr LATENCY_SUB_BUCKET_BITS = 7;		/**< Liczba bitów przedziałów liniowych, względna dokładność 2^-(bits-1), ok. 1.6%. */
+auto constexpr LATENCY_MAX_MAGNITUDE = 36;		/**< Liczba bitów największej rozróżnialnej wartości (ok. 19 godzin w mikrosekundach). */
+
+/**
+ * Histogram opóźnień w stylu HdrHistogram: przedział [2^k, 2^(k+1)) dzielony jest na 2^(LATENCY_SUB_BUCKET_BITS-1)
+ * równych części, więc każda wartość zapisywana jest ze stałą względną dokładnością, a pamięć nie zależy
+ * od liczby pomiarów. Wartości mniejsze od 2^LATENCY_SUB_BUCKET_BITS zapisywane są dokładnie.
+ * Dodanie wartości ma koszt O(1), wyznaczenie percentyla koszt proporcjonalny do liczby przedziałów.
+ * Minimum i maksimum zapamiętywane są dokładnie.
+ */
+class LatencyHistogram {
+public:
+	static constexpr int SUB_BUCKETS = 1 << LATENCY_SUB_BUCKET_BITS;		/**< Liczba przedziałów pierwszego zakresu. */
+	static constexpr int HALF_SUB_BUCKETS = SUB_BUCKETS / 2;				/**< Liczba przedziałów każdego kolejnego zakresu. */
+	static constexpr int BUCKET_COUNT = SUB_BUCKETS + (LATENCY_MAX_MAGNITUDE - LATENCY_SUB_BUCKET_BITS) * HALF_SUB_BUCKETS;	/**< Liczba przedziałów. */
+
+private:
+	std::array<quint64, BUCKET_COUNT> counts = {};
+	quint64 total = 0;
+	qint64 minValue = 0;
+	qint64 maxValue = 0;
+	double sum = 0.0;
+
+	static int bucketOf(qint64 value);
+	static qint64 highestEquivalent(int bucket);
+
+	qint64 bucketValue(int bucket) const {
+		// the last bucket also holds the values beyond LATENCY_MAX_MAGNITUDE
+		return bucket == BUCKET_COUNT - 1 ? maxValue : std::min(highestEquivalent(bucket), maxValue);
+	}
+
+public:
+	/**
+	 * Dodaje pomiar, wartości ujemne zapisywane są jako 0.
+	 * @param value Wartość, np. opóźnienie w mikrosekundach.
+	 */
+	void record(qint64 value);
+
+	/**
+	 * Usuwa wszystkie pomiary.
+	 */
+	void clear();
+
+	/**
+	 * Getter.
+	 * @return Liczba pomiarów.
+	 */
+	quint64 count() const {
+		return total;
+	}
+
+	/**
+	 * Getter.
+	 * @return Najmniejsza zapisana wartość, 0 jeżeli histogram jest pusty.
+	 */
+	qint64 min() const {
+		return minValue;
+	}
+
+	/**
+	 * Getter.
+	 * @return Największa zapisana wartość, 0 jeżeli histogram jest pusty.
+	 */
+	qint64 max() const {
+		return maxValue;
+	}
+
+	/**
+	 * Getter.
+	 * @return Średnia zapisanych wartości, 0 jeżeli histogram jest pusty.
+	 */
+	double mean() const {
+		return total == 0 ? 0.0 : sum / total;
+	}
+
+	/**
+	 * Wyznacza percentyl, z dokładnością przedziału, nie większy niż maksimum.
+	 * @param percentile Percentyl z zakresu 0-100.
+	 * @return Największa wartość równoważna przedziałowi, w którym znajduje się percentyl, 0 jeżeli histogram jest pusty.
+	 */
+	qint64 valueAtPercentile(double percentile) const;
+
+	/**
+	 * Wywołuje funkcję dla kolejnych niepustych przedziałów, w kolejności rosnących wartości.
+	 * @param f Funkcja przyjmująca największą wartość przedziału (qint64) i liczbę pomiarów do niego włącznie (quint64).
+	 */
+	template<class Functor>
+	void forEachBucket(const Functor & f) const {
+		quint64 cumulative = 0;
+		for (int i = 0; i < BUCKET_COUNT && cumulative < total; ++i) {
+			if (counts[i] == 0)
+				continue;
+			cumulative += counts[i];
+			f(bucketValue(i), cumulative);
+		}
+	}
+};
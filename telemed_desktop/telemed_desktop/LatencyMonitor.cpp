@@ -0,0 +1,97 @@
+#include "LatencyMonitor.h"
+#include <QSaveFile>
+#include <QStringList>
+#include <QTextStream>
+#include <chrono>
+
+namespace {
+	const char * const STAGE_NAMES[] = { "device", "processing", "render", "end-to-end" };
+	const char * const STAGE_DESCRIPTIONS[] = {
+		"sample -> received",
+		"received -> processed",
+		"processed -> rendered",
+		"sample -> rendered"
+	};
+
+	QString msText(qint64 us) {
+		return QString::number(us / 1000.0, 'f', 1);
+	}
+}
+
+qint64 LatencyMonitor::nowNs() {
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(
+		std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+QString LatencyMonitor::stageName(Stage stage) {
+	return STAGE_NAMES[stage];
+}
+
+void LatencyMonitor::processed(qint64 receivedNs, qint64 newestSampleMs) {
+	auto now = nowNs();
+	// the wall clock time of receiving, the sample timestamps are anchored to the wall clock
+	auto receivedUs = clock->nowMs() * 1000 - (now - receivedNs) / 1000;
+	auto deviceUs = receivedUs - newestSampleMs * 1000;
+	histograms[DEVICE].record(deviceUs);
+	histograms[PROCESSING].record((now - receivedNs) / 1000);
+	if (pending.size() >= LATENCY_PENDING_LIMIT)
+		pending.pop_front();
+	pending.push_back({ receivedNs, now, std::max<qint64>(deviceUs, 0) });
+}
+
+void LatencyMonitor::rendered() {
+	auto now = nowNs();
+	for (auto & batch : pending) {
+		histograms[RENDER].record((now - batch.processedNs) / 1000);
+		histograms[END_TO_END].record(batch.deviceUs + (now - batch.receivedNs) / 1000);
+	}
+	pending.clear();
+}
+
+QString LatencyMonitor::summary() const {
+	QStringList stages;
+	for (int i = 0; i < STAGE_COUNT; ++i) {
+		auto & h = histograms[i];
+		stages.append(QString("%1 p50 %2 p99 %3 max %4 ms")
+			.arg(STAGE_NAMES[i])
+			.arg(msText(h.valueAtPercentile(50.0)))
+			.arg(msText(h.valueAtPercentile(99.0)))
+			.arg(msText(h.max())));
+	}
+	return stages.join(" | ");
+}
+
+bool LatencyMonitor::writeReport(const QString & path) const {
+	QSaveFile file(path);
+	if (!file.open(QIODevice::WriteOnly | QIODevice::Text))
+		return false;
+	QTextStream out(&file);
+	for (int i = 0; i < STAGE_COUNT; ++i) {
+		auto & h = histograms[i];
+		out << "# " << STAGE_NAMES[i] << ": " << STAGE_DESCRIPTIONS[i] << "\n";
+		out << "       Value     Percentile TotalCount 1/(1-Percentile)\n\n";
+		auto total = h.count();
+		h.forEachBucket([&out, total](qint64 value, quint64 cumulative) {
+			auto percentile = double(cumulative) / total;
+			out << QString("%1 %2 %3 %4\n")
+				.arg(value / 1000.0, 12, 'f', 3)
+				.arg(percentile, 14, 'f', 12)
+				.arg(cumulative, 10)
+				.arg(percentile < 1.0 ? QString::number(1.0 / (1.0 - percentile), 'f', 2) : QString("inf"), 14);
+		});
+		out << QString("#[Mean    = %1, Min            = %2]\n")
+			.arg(h.mean() / 1000.0, 12, 'f', 3)
+			.arg(h.min() / 1000.0, 12, 'f', 3);
+		out << QString("#[Max     = %1, Total count    = %2]\n\n")
+			.arg(h.max() / 1000.0, 12, 'f', 3)
+			.arg(total, 12);
+	}
+	out.flush();
+	return file.commit();
+}
+
+void LatencyMonitor::clear() {
+	for (auto & h : histograms)
+		h.clear();
+	pending.clear();
+}
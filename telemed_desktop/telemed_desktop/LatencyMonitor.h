@@ -0,0 +1,120 @@
+#pragma once
+#include <QString>
+#include <QtGlobal>
+#include <array>
+#include <deque>
+#include "Clock.h"
+#include "LatencyHistogram.h"
+
+auto constexpr LATENCY_PENDING_LIMIT = 1024;	/**< Liczba przetworzonych paczek oczekujących na narysowanie, starsze są pomijane. */
+
+/**
+ * Klasa mierząca opóźnienie danych od pobrania próbki przez czujnik do ich narysowania na ekranie.
+ * Każda paczka oznaczana jest chwilą odebrania przez DeviceApi (LatencyMonitor::nowNs), przekazywaną
+ * wraz z paczką do przetwarzania (SensorFrame::getReceivedNs, ProcessedBatch::receivedNs).
+ * Opóźnienia zapisywane są w histogramach (LatencyHistogram) w mikrosekundach, osobno dla etapów:
+ *	- DEVICE: najnowsza próbka paczki - odebranie paczki,
+ *	- PROCESSING: odebranie - dopisanie przetworzonej paczki do Data,
+ *	- RENDER: dopisanie - koniec odświeżenia wykresu, na którym pojawiła się paczka,
+ *	- END_TO_END: najnowsza próbka paczki - koniec odświeżenia wykresu.
+ *
+ * Zegar modułu nie jest zsynchronizowany z zegarem komputera, stemple czasowe próbek przesuwane są tak,
+ * aby ostatnia próbka pierwszej paczki otrzymała czas jej odebrania (TimeBase). Etap DEVICE mierzy więc
+ * opóźnienie względem pierwszej paczki - buforowanie w module, jitter sieci i dryft zegarów.
+ * Pozostałe etapy mierzone są zegarem monotonicznym.
+ */
+class LatencyMonitor {
+public:
+	/**
+	 * Etap, dla którego mierzone jest opóźnienie.
+	 */
+	enum Stage {
+		DEVICE,
+		PROCESSING,
+		RENDER,
+		END_TO_END,
+		STAGE_COUNT
+	};
+
+private:
+	struct Pending {
+		qint64 receivedNs;
+		qint64 processedNs;
+		qint64 deviceUs;
+	};
+
+	const Clock * clock;
+	std::array<LatencyHistogram, STAGE_COUNT> histograms;
+	std::deque<Pending> pending;
+
+public:
+	/**
+	 * Konstruktor inicjalizujący.
+	 * @param clock_ Zegar, względem którego wyznaczane są stemple czasowe próbek.
+	 */
+	LatencyMonitor(const Clock * clock_ = SystemClock::instance()) :
+		clock(clock_)
+	{}
+
+	/**
+	 * Setter.
+	 * @param clock_ Zegar, względem którego wyznaczane są stemple czasowe próbek.
+	 */
+	void setClock(const Clock * clock_) {
+		clock = clock_;
+	}
+
+	/**
+	 * Getter.
+	 * @return Czas zegara monotonicznego w nanosekundach, używany do oznaczania paczek.
+	 */
+	static qint64 nowNs();
+
+	/**
+	 * Getter.
+	 * @param stage Etap.
+	 * @return Nazwa etapu.
+	 */
+	static QString stageName(Stage stage);
+
+	/**
+	 * Zapisuje opóźnienia paczki dopisanej do Data i oczekuje na jej narysowanie.
+	 * @param receivedNs Chwila odebrania paczki, LatencyMonitor::nowNs.
+	 * @param newestSampleMs Stempel czasowy najnowszej próbki paczki w milisekundach od początku epoki.
+	 */
+	void processed(qint64 receivedNs, qint64 newestSampleMs);
+
+	/**
+	 * Zapisuje opóźnienia paczek dopisanych od poprzedniego odświeżenia wykresu.
+	 * Wywoływana po zakończeniu odświeżenia.
+	 */
+	void rendered();
+
+	/**
+	 * Getter.
+	 * @param stage Etap.
+	 * @return Histogram opóźnień etapu w mikrosekundach.
+	 */
+	const LatencyHistogram & histogram(Stage stage) const {
+		return histograms[stage];
+	}
+
+	/**
+	 * Getter.
+	 * @return Mediana, 99 percentyl i maksimum opóźnienia każdego etapu w milisekundach, w jednej linii.
+	 */
+	QString summary() const;
+
+	/**
+	 * Zapisuje rozkład opóźnień każdego etapu do pliku tekstowego, w formacie rozkładu percentyli
+	 * HdrHistogram (kolumny Value [ms], Percentile, TotalCount, 1/(1-Percentile)).
+	 * @param path Ścieżka do pliku.
+	 * @return false jeżeli zapis się nie powiódł.
+	 */
+	bool writeReport(const QString & path) const;
+
+	/**
+	 * Usuwa wszystkie pomiary.
+	 */
+	void clear();
+};
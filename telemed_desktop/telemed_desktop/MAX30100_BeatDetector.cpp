@@ -19,122 +19,6 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 //#include <Arduino.h>
 
 #include "MAX30100_BeatDetector.h"
-#include <algorithm>
-/*
-#ifndef min
-#define min(a,b) \
-   ({ __typeof__ (a) _a = (a); \
-       __typeof__ (b) _b = (b); \
-     _a < _b ? _a : _b; })
-#endif
-*/
-BeatDetector::BeatDetector() :
-	state(BEATDETECTOR_STATE_INIT),
-	threshold(BEATDETECTOR_MIN_THRESHOLD),
-	beatPeriod(0),
-	lastMaxValue(0),
-	tsLastBeat(0)
-{
-}
-
-bool BeatDetector::addSample(unsigned long long millis, float sample)
-{
-	return checkForBeat(millis, sample);
-}
-
-float BeatDetector::getRate()
-{
-	if (beatPeriod != 0) {
-		return 1 / beatPeriod * 1000 * 60;
-	}
-	else {
-		return 0;
-	}
-}
-
-float BeatDetector::getCurrentThreshold()
-{
-	return threshold;
-}
-
-bool BeatDetector::checkForBeat(unsigned long long millis, float sample)
-{
-	bool beatDetected = false;
-
-	switch (state) {
-	case BEATDETECTOR_STATE_INIT:
-		if (millis > BEATDETECTOR_INIT_HOLDOFF) {
-			state = BEATDETECTOR_STATE_WAITING;
-		}
-		break;
-
-	case BEATDETECTOR_STATE_WAITING:
-		if (sample > threshold) {
-			threshold = std::min(sample, (float)BEATDETECTOR_MAX_THRESHOLD);
-			state = BEATDETECTOR_STATE_FOLLOWING_SLOPE;
-		}
-
-		// Tracking lost, resetting
-		if (millis - tsLastBeat > BEATDETECTOR_INVALID_READOUT_DELAY) {
-			beatPeriod = 0;
-			lastMaxValue = 0;
-		}
-
-		decreaseThreshold();
-		break;
-
-	case BEATDETECTOR_STATE_FOLLOWING_SLOPE:
-		if (sample < threshold) {
-			state = BEATDETECTOR_STATE_MAYBE_DETECTED;
-		}
-		else {
-			threshold = std::min(sample, (float)BEATDETECTOR_MAX_THRESHOLD);
-		}
-		break;
-
-	case BEATDETECTOR_STATE_MAYBE_DETECTED:
-		if (sample + BEATDETECTOR_STEP_RESILIENCY < threshold) {
-			// Found a beat
-			beatDetected = true;
-			lastMaxValue = sample;
-			state = BEATDETECTOR_STATE_MASKING;
-			float delta = millis - tsLastBeat;
-			if (delta) {
-				beatPeriod = BEATDETECTOR_BPFILTER_ALPHA * delta +
-					(1 - BEATDETECTOR_BPFILTER_ALPHA) * beatPeriod;
-			}
-
-			tsLastBeat = millis;
-		}
-		else {
-			state = BEATDETECTOR_STATE_FOLLOWING_SLOPE;
-		}
-		break;
-
-	case BEATDETECTOR_STATE_MASKING:
-		if (millis - tsLastBeat > BEATDETECTOR_MASKING_HOLDOFF) {
-			state = BEATDETECTOR_STATE_WAITING;
-		}
-		decreaseThreshold();
-		break;
-	}
-
-	return beatDetected;
-}
-
-void BeatDetector::decreaseThreshold()
-{
-	// When a valid beat rate readout is present, target the
-	if (lastMaxValue > 0 && beatPeriod > 0) {
-		threshold -= lastMaxValue * (1 - BEATDETECTOR_THRESHOLD_FALLOFF_TARGET) /
-			(beatPeriod / BEATDETECTOR_SAMPLES_PERIOD);
-	}
-	else {
-		// Asymptotic decay
-		threshold *= BEATDETECTOR_THRESHOLD_DECAY_FACTOR;
-	}
 
-	if (threshold < BEATDETECTOR_MIN_THRESHOLD) {
-		threshold = BEATDETECTOR_MIN_THRESHOLD;
-	}
-}
\ No newline at end of file
+// the default tuning is compiled once, other tunings are instantiated where they are used
+template class BasicBeatDetector<BeatDetectorConfig>;
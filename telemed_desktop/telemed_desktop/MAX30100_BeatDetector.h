@@ -20,17 +20,27 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #define MAX30100_BEATDETECTOR_H
 
 #include <stdint.h>
+#include <stddef.h>
+#include <algorithm>
+#include <vector>
 
-#define BEATDETECTOR_INIT_HOLDOFF                2000    // in ms, how long to wait before counting
-#define BEATDETECTOR_MASKING_HOLDOFF             200     // in ms, non-retriggerable window after beat detection
-#define BEATDETECTOR_BPFILTER_ALPHA              0.6     // EMA factor for the beat period value
-#define BEATDETECTOR_MIN_THRESHOLD               20      // minimum threshold (filtered) value
-#define BEATDETECTOR_MAX_THRESHOLD               800     // maximum threshold (filtered) value
-#define BEATDETECTOR_STEP_RESILIENCY             30      // maximum negative jump that triggers the beat edge
-#define BEATDETECTOR_THRESHOLD_FALLOFF_TARGET    0.3     // thr chasing factor of the max value when beat
-#define BEATDETECTOR_THRESHOLD_DECAY_FACTOR      0.99    // thr chasing factor when no beat
-#define BEATDETECTOR_INVALID_READOUT_DELAY       2000    // in ms, no-beat time to cause a reset
-#define BEATDETECTOR_SAMPLES_PERIOD              10      // in ms, 1/Fs
+/**
+ * Domyślne strojenie detektora uderzeń serca, dla próbkowania 100 Hz.
+ * Inne strojenie definiuje się strukturą dziedziczącą i przesłaniającą wybrane stałe, np.
+ *	struct BeatDetectorConfig50Hz : BeatDetectorConfig { static constexpr int SAMPLES_PERIOD = 20; };
+ */
+struct BeatDetectorConfig {
+	static constexpr long long INIT_HOLDOFF = 2000;				// in ms, how long to wait before counting
+	static constexpr long long MASKING_HOLDOFF = 200;			// in ms, non-retriggerable window after beat detection
+	static constexpr double BPFILTER_ALPHA = 0.6;				// EMA factor for the beat period value
+	static constexpr int MIN_THRESHOLD = 20;					// minimum threshold (filtered) value
+	static constexpr int MAX_THRESHOLD = 800;					// maximum threshold (filtered) value
+	static constexpr int STEP_RESILIENCY = 30;					// maximum negative jump that triggers the beat edge
+	static constexpr double THRESHOLD_FALLOFF_TARGET = 0.3;		// thr chasing factor of the max value when beat
+	static constexpr double THRESHOLD_DECAY_FACTOR = 0.99;		// thr chasing factor when no beat
+	static constexpr long long INVALID_READOUT_DELAY = 2000;	// in ms, no-beat time to cause a reset
+	static constexpr int SAMPLES_PERIOD = 10;					// in ms, 1/Fs
+};
 
 
 typedef enum BeatDetectorState {
@@ -42,23 +52,166 @@ typedef enum BeatDetectorState {
 } BeatDetectorState;
 
 
-class BeatDetector
+/**
+ * Detektor uderzeń serca z biblioteki Arduino-MAX30100, sparametryzowany strojeniem Config (BeatDetectorConfig)
+ * znanym w czasie kompilacji. Stemple czasowe są 64-bitowe, więc mogą być milisekundami od początku epoki,
+ * a czas oczekiwania na start (INIT_HOLDOFF) liczony jest od pierwszej próbki.
+ */
+template<class Config>
+class BasicBeatDetector
 {
 public:
-	BeatDetector();
-	bool addSample(unsigned long long millis, float sample);
-	float getRate();
-	float getCurrentThreshold();
+	/**
+	 * Dodaje próbkę.
+	 * @param millis Stempel czasowy próbki w milisekundach.
+	 * @param sample Wartość próbki.
+	 * @return true jeżeli próbka kończy uderzenie serca.
+	 */
+	bool addSample(long long millis, float sample)
+	{
+		return checkForBeat(millis, sample);
+	}
+
+	/**
+	 * Dodaje serię próbek.
+	 * @param millis Stemple czasowe próbek w milisekundach.
+	 * @param samples Wartości próbek.
+	 * @param n Liczba próbek.
+	 * @param beats Wektor do którego dopisywane są indeksy próbek kończących uderzenia serca.
+	 * @return Liczba wykrytych uderzeń.
+	 */
+	size_t addSamples(const long long * millis, const float * samples, size_t n, std::vector<size_t> & beats)
+	{
+		auto before = beats.size();
+		for (size_t i = 0; i < n; ++i) {
+			if (checkForBeat(millis[i], samples[i]))
+				beats.push_back(i);
+		}
+		return beats.size() - before;
+	}
+
+	float getRate() const
+	{
+		if (beatPeriod != 0) {
+			return 1 / beatPeriod * 1000 * 60;
+		}
+		else {
+			return 0;
+		}
+	}
+
+	float getCurrentThreshold() const
+	{
+		return threshold;
+	}
 
 private:
-	bool checkForBeat(unsigned long long millis, float value);
+	bool checkForBeat(long long millis, float value);
 	void decreaseThreshold();
 
-	BeatDetectorState state;
-	float threshold;
-	float beatPeriod;
-	float lastMaxValue;
-	uint32_t tsLastBeat;
+	BeatDetectorState state = BEATDETECTOR_STATE_INIT;
+	float threshold = Config::MIN_THRESHOLD;
+	float beatPeriod = 0;
+	float lastMaxValue = 0;
+	long long tsFirstSample = -1;
+	long long tsLastBeat = -1;		// -1 until the first beat
 };
 
-#endif
\ No newline at end of file
+/**
+ * Detektor ze strojeniem domyślnym.
+ */
+using BeatDetector = BasicBeatDetector<BeatDetectorConfig>;
+
+template<class Config>
+inline bool BasicBeatDetector<Config>::checkForBeat(long long millis, float sample)
+{
+	bool beatDetected = false;
+
+	switch (state) {
+	case BEATDETECTOR_STATE_INIT:
+		if (tsFirstSample < 0) {
+			tsFirstSample = millis;
+		}
+		if (millis - tsFirstSample > Config::INIT_HOLDOFF) {
+			state = BEATDETECTOR_STATE_WAITING;
+		}
+		break;
+
+	case BEATDETECTOR_STATE_WAITING:
+		if (sample > threshold) {
+			threshold = std::min(sample, (float)Config::MAX_THRESHOLD);
+			state = BEATDETECTOR_STATE_FOLLOWING_SLOPE;
+		}
+
+		// Tracking lost, resetting
+		if (tsLastBeat < 0 || millis - tsLastBeat > Config::INVALID_READOUT_DELAY) {
+			beatPeriod = 0;
+			lastMaxValue = 0;
+		}
+
+		decreaseThreshold();
+		break;
+
+	case BEATDETECTOR_STATE_FOLLOWING_SLOPE:
+		if (sample < threshold) {
+			state = BEATDETECTOR_STATE_MAYBE_DETECTED;
+		}
+		else {
+			threshold = std::min(sample, (float)Config::MAX_THRESHOLD);
+		}
+		break;
+
+	case BEATDETECTOR_STATE_MAYBE_DETECTED:
+		if (sample + Config::STEP_RESILIENCY < threshold) {
+			// Found a beat
+			beatDetected = true;
+			lastMaxValue = sample;
+			state = BEATDETECTOR_STATE_MASKING;
+			// the first beat has no period yet
+			if (tsLastBeat >= 0) {
+				float delta = millis - tsLastBeat;
+				if (delta) {
+					beatPeriod = Config::BPFILTER_ALPHA * delta +
+						(1 - Config::BPFILTER_ALPHA) * beatPeriod;
+				}
+			}
+
+			tsLastBeat = millis;
+		}
+		else {
+			state = BEATDETECTOR_STATE_FOLLOWING_SLOPE;
+		}
+		break;
+
+	case BEATDETECTOR_STATE_MASKING:
+		if (millis - tsLastBeat > Config::MASKING_HOLDOFF) {
+			state = BEATDETECTOR_STATE_WAITING;
+		}
+		decreaseThreshold();
+		break;
+	}
+
+	return beatDetected;
+}
+
+template<class Config>
+inline void BasicBeatDetector<Config>::decreaseThreshold()
+{
+	// When a valid beat rate readout is present, target the
+	if (lastMaxValue > 0 && beatPeriod > 0) {
+		threshold -= lastMaxValue * (1 - Config::THRESHOLD_FALLOFF_TARGET) /
+			(beatPeriod / Config::SAMPLES_PERIOD);
+	}
+	else {
+		// Asymptotic decay
+		threshold *= Config::THRESHOLD_DECAY_FACTOR;
+	}
+
+	if (threshold < Config::MIN_THRESHOLD) {
+		threshold = Config::MIN_THRESHOLD;
+	}
+}
+
+extern template class BasicBeatDetector<BeatDetectorConfig>;
+
+#endif
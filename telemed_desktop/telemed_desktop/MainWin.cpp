@@ -1,11 +1,19 @@
 #include "MainWin.h"
 #include <QCloseEvent>
+#include <QDir>
 #include <QFileDialog>
+#include <QGuiApplication>
+#include <QProgressDialog>
+#include <QScreen>
 #include <QStandardPaths>
+#include <QTimer>
 #include <QCustomPlot.h>
 #include "Data.h"
 #include "ObjectFactory.h"
 #include "DeviceApi.h"
+#include "HeartRateTableModel.h"
+#include "RenderScheduler.h"
+#include "XlsxExporter.h"
 
 MainWin::MainWin(QWidget *parent)
 	: QMainWindow(parent)
@@ -13,14 +21,28 @@ MainWin::MainWin(QWidget *parent)
 	ui.setupUi(this);
 
 	ObjectFactory::createInstance(new DeviceApi(this));
-	data = new Data(this);
-	plot = new QCustomPlot(this);
 	auto devApi = ObjectFactory::getInstance<DeviceApi>();
+	data = new Data(devApi, this);
+	hrModel = new HeartRateTableModel(data, this);
+	plot = new QCustomPlot(this);
+	renderer = new RenderScheduler([this](int dirty) { render(dirty); }, RENDER_FRAME_INTERVAL, this);
+	if (auto screen = QGuiApplication::primaryScreen())
+		renderer->setFrameInterval(qRound(1000.0 / std::max(1.0, screen->refreshRate())));
+	exporter = new XlsxExporter(this);
+	exportProgress = new QProgressDialog(tr("Saving..."), tr("Cancel"), 0, 100, this);
+	exportProgress->setWindowModality(Qt::NonModal);
+	exportProgress->setMinimumDuration(500);
+	exportProgress->reset();
+	latencyLbl = new QLabel(this);
+	latencyTimer = new QTimer(this);
+	latencyTimer->setInterval(LATENCY_REFRESH_INTERVAL);
+	this->statusBar()->addWidget(latencyLbl);
 	this->statusBar()->setVisible(false);
 	this->showMaximized();
 
 	titleSaved();
 	ui.tableDockWgt->setVisible(false);
+	ui.HRTab->setModel(hrModel);
 	ui.propDockWgt->setVisible(false);
 	ui.plotLayout->addWidget(plot);
 	setupPlot();
@@ -37,8 +59,15 @@ MainWin::MainWin(QWidget *parent)
 
 	connect(ui.actionStartStop, &QAction::toggled, this, &MainWin::startStop);
 	connect(ui.actionSaveAs, &QAction::triggered, this, &MainWin::saveToFile);
+	connect(exporter, &XlsxExporter::progressChanged, exportProgress, &QProgressDialog::setValue);
+	connect(exporter, &XlsxExporter::finished, this, &MainWin::exportFinished);
+	connect(exportProgress, &QProgressDialog::canceled, exporter, &XlsxExporter::cancel);
 	connect(ui.actionClear, &QAction::triggered, this, &MainWin::clear);
+	connect(ui.actionLatency, &QAction::toggled, this, &MainWin::setLatencyVisible);
+	connect(ui.actionSaveLatency, &QAction::triggered, this, &MainWin::saveLatencyReport);
+	connect(latencyTimer, &QTimer::timeout, this, &MainWin::updateLatency);
 	connect(data, &Data::receivedNewData, this, &MainWin::receivedNewData);
+	connect(data, &Data::journalFailed, this, &MainWin::journalFailed);
 	connect(ui.ipEdt, &QLineEdit::textChanged, devApi, &DeviceApi::setDeviceIp);
 	connect(ui.irLedCurrBox, qOverload<int>(&QComboBox::currentIndexChanged), 
 		devApi, &DeviceApi::setIrLedCurrent);
@@ -47,7 +76,12 @@ MainWin::MainWin(QWidget *parent)
 	connect(ui.redChckBox, &QCheckBox::toggled, this, &MainWin::setRedLedGraphVisible);
 	connect(ui.irChckBox, &QCheckBox::toggled, this, &MainWin::setIrLedGraphVisible);
 	connect(ui.hrChckBox, &QCheckBox::toggled, this, &MainWin::setHRGraphVisible);
+	connect(ui.spo2ChckBox, &QCheckBox::toggled, this, &MainWin::setSpO2GraphVisible);
+	connect(ui.streamChckBox, &QCheckBox::toggled, data, &Data::setStreamingEnabled);
 	connect(ui.rangeLn, &QLineEdit::editingFinished, this, &MainWin::updateRange);
+	connect(plot->xAxis, qOverload<const QCPRange &>(&QCPAxis::rangeChanged), this, &MainWin::updatePlotData);
+
+	openJournal();
 }
 
 void MainWin::startStop(bool toggled) {
@@ -69,6 +103,7 @@ void MainWin::setupPlot() {
 	ui.irChckBox->setText(data->getYIrSensorDataName());
 	ui.redChckBox->setText(data->getYRedSensorDataName());
 	ui.hrChckBox->setText(data->getHeartRateDataName());
+	ui.spo2ChckBox->setText(data->getSpO2DataName());
 
 	plot->addGraph();
 	plot->graph(Graph::IR)->setPen(QPen(Qt::blue));
@@ -86,6 +121,14 @@ void MainWin::setupPlot() {
 	plot->graph(Graph::HR)->setScatterStyle(QCPScatterStyle(QCPScatterStyle::ssCircle, 10));
 	plot->graph(Graph::HR)->setName(data->getHeartRateDataName());
 
+	plot->addGraph();
+	QPen spo2Pen;
+	spo2Pen.setColor(QColor(Qt::magenta));
+	spo2Pen.setWidth(3);
+	plot->graph(Graph::SPO2)->setPen(spo2Pen);
+	plot->graph(Graph::SPO2)->setScatterStyle(QCPScatterStyle(QCPScatterStyle::ssDiamond, 10));
+	plot->graph(Graph::SPO2)->setName(data->getSpO2DataName());
+
 	plot->legend->setVisible(true);
 	plot->legend->setBrush(QColor(255, 255, 255, 150));
 	QSharedPointer<QCPAxisTickerDateTime> dateTicker(new QCPAxisTickerDateTime);
@@ -95,9 +138,35 @@ void MainWin::setupPlot() {
 	setIrLedGraphVisible(ui.irChckBox->isChecked());
 	setRedLedGraphVisible(ui.redChckBox->isChecked());
 	setHRGraphVisible(ui.hrChckBox->isChecked());
+	setSpO2GraphVisible(ui.spo2ChckBox->isChecked());
 	updateRange();
 }
 
+void MainWin::openJournal() {
+	auto dir = QStandardPaths::writableLocation(QStandardPaths::AppLocalDataLocation);
+	QDir().mkpath(dir);
+	auto path = QDir(dir).filePath(JOURNAL_FILE_NAME);
+	// the journal is removed on exit, so a leftover one means the previous session crashed
+	if (QFile::exists(path)) {
+		auto ans = QMessageBox::question(this, APP_NAME,
+			"The previous session was not closed properly. Recover its data?",
+			QMessageBox::Yes | QMessageBox::No,
+			QMessageBox::Yes);
+		if (ans == QMessageBox::Yes) {
+			auto recovered = data->recoverJournal(path);
+			if (!data->isDataSaved())
+				receivedNewData();
+			if (recovered)
+				return;
+		}
+	}
+	data->startJournal(path);
+}
+
+void MainWin::journalFailed() {
+	QMessageBox::warning(this, APP_NAME, "Cannot write the session journal, data will not be recovered after a crash.");
+}
+
 void MainWin::titleUnsaved() {
 	this->setWindowTitle(APP_NAME + "*");
 }
@@ -120,9 +189,57 @@ void MainWin::setGraphVisible(Graph graph, bool visible) {
 void MainWin::saveToFile() {
 	QString fileName = QFileDialog::getSaveFileName(this, tr("Save as"),
 		QStandardPaths::writableLocation(QStandardPaths::DesktopLocation),
-		tr("Excel file (*.xlsx)"));
-	data->saveAs(fileName);
-	titleSaved();
+		tr("Excel file (*.xlsx);;CSV file (*.csv);;NDJSON file (*.ndjson)"));
+	if (fileName.isEmpty())
+		return;
+
+	// acquisition keeps running, the file contains the data received until now
+	if (!exporter->start(data->snapshot(), fileName))
+		return;
+	ui.actionSaveAs->setEnabled(false);
+	exportProgress->setValue(0);
+}
+
+void MainWin::setLatencyVisible(bool visible) {
+	this->statusBar()->setVisible(visible);
+	if (visible) {
+		updateLatency();
+		latencyTimer->start();
+	}
+	else {
+		latencyTimer->stop();
+	}
+}
+
+void MainWin::updateLatency() {
+	latencyLbl->setText(tr("%1 | frames rendered %2, skipped %3")
+		.arg(data->getLatency().summary())
+		.arg(renderer->framesRendered())
+		.arg(renderer->framesSkipped()));
+}
+
+void MainWin::saveLatencyReport() {
+	QString fileName = QFileDialog::getSaveFileName(this, tr("Save latency report"),
+		QStandardPaths::writableLocation(QStandardPaths::DesktopLocation),
+		tr("HdrHistogram percentile distribution (*.hgrm);;Text file (*.txt)"));
+	if (fileName.isEmpty())
+		return;
+	if (!data->getLatency().writeReport(fileName))
+		QMessageBox::warning(this, APP_NAME, "Cannot save the latency report.");
+}
+
+void MainWin::exportFinished(bool ok, quint64 revision) {
+	auto cancelled = exportProgress->wasCanceled();
+	exportProgress->reset();
+	ui.actionSaveAs->setEnabled(true);
+	if (ok) {
+		data->markSaved(revision);
+		if (data->isDataSaved())
+			titleSaved();
+	}
+	else if (!cancelled) {
+		QMessageBox::warning(this, APP_NAME, "Cannot save the file.");
+	}
 }
 
 void MainWin::clear() {
@@ -140,48 +257,54 @@ void MainWin::clear() {
 	setupPlot();
 	data->clear();
 	lastCustomPlotMsMainData = -1.0;
-	plot->replot();
+	hrPlotCount = 0;
+	spo2PlotCount = 0;
+	renderer->request(RenderScheduler::REPLOT);
 	ui.HRLbl->setText("");
-	ui.HRTab->clearContents();
-	ui.HRTab->setRowCount(0);
+	ui.SpO2Lbl->setText("");
+	hrModel->update();
 }
 
 void MainWin::receivedNewData() {
 	titleUnsaved();
-	auto tmp = data->getYIrSensorData(lastCustomPlotMsMainData);
-	plot->graph(Graph::IR)->addData(
-		data->getXSensorData(lastCustomPlotMsMainData),
-		tmp
-	);
-	plot->graph(Graph::RED)->addData(
-		data->getXSensorData(lastCustomPlotMsMainData),
-		data->getYRedSensorData(lastCustomPlotMsMainData)
+	// samples of the visible range are set by updatePlotData when the range moves
+	// heart rate values are only appended, the graph gets the new ones
+	auto hrCount = data->getHeartRateCount();
+	if (hrCount < hrPlotCount) {
+		plot->graph(Graph::HR)->data()->clear();
+		hrPlotCount = 0;
+	}
+	plot->graph(Graph::HR)->addData(
+		data->getXHRData(hrPlotCount),
+		data->getYHRData(hrPlotCount),
+		true
 	);
-	plot->graph(Graph::HR)->setData(
-		data->getXHRData(),
-		data->getYHRData()
+	hrPlotCount = hrCount;
+	auto spo2Count = data->getSpO2Count();
+	if (spo2Count < spo2PlotCount) {
+		plot->graph(Graph::SPO2)->data()->clear();
+		spo2PlotCount = 0;
+	}
+	plot->graph(Graph::SPO2)->addData(
+		data->getXSpO2Data(spo2PlotCount),
+		data->getYSpO2Data(spo2PlotCount),
+		true
 	);
+	spo2PlotCount = spo2Count;
 	lastCustomPlotMsMainData = data->getLastSensorDataCustomPlotMs();
 	
-	auto hrs = data->getQuantileMeanHeartRate(lastHRMs);
-	for (auto hr : hrs) {
-		QTableWidgetItem * endIt = new QTableWidgetItem(
-			hr.getEndTimeStr());
-		QTableWidgetItem * hrIt = new QTableWidgetItem(
-			hr.getHRStr());
-		auto row = ui.HRTab->rowCount();
-		ui.HRTab->setRowCount(row + 1);
-		ui.HRTab->setItem(row, 0, endIt);
-		ui.HRTab->setItem(row, 1, hrIt);
-	}
-	if (!hrs.isEmpty()) {
-		ui.HRLbl->setText(QString::number(int(hrs.back().getHR() + 0.5)));
-		lastHRMs = hrs.back().getEndMs();
+	// the table formats only the rows in view
+	hrModel->update();
+	if (hrCount > 0) {
+		auto & hr = data->getQuantileMeanHeartRateAt(hrCount - 1);
+		ui.HRLbl->setText(QString::number(int(hr.getHR() + 0.5)));
+		lastHRMs = hr.getEndMs();
 	}
+	if (spo2Count > 0)
+		ui.SpO2Lbl->setText(QString::number(int(data->getSpO2At(spo2Count - 1).getSpO2() + 0.5)));
 
 	updateRange();
-	QScrollBar *sb = ui.HRTab->verticalScrollBar();
-	sb->setValue(sb->maximum());
+	ui.HRTab->scrollToBottom();
 }
 
 void MainWin::setRedLedGraphVisible(bool visible) {
@@ -199,7 +322,24 @@ void MainWin::setHRGraphVisible(bool visible) {
 	setGraphVisible(Graph::HR, visible);
 }
 
+void MainWin::setSpO2GraphVisible(bool visible) {
+	data->setSpO2Enabled(visible);
+	setGraphVisible(Graph::SPO2, visible);
+}
+
 void MainWin::updateRange() {
+	// data batches, checkbox toggles and range edits in one frame end in a single replot
+	renderer->request(RenderScheduler::RANGE);
+}
+
+void MainWin::render(int dirty) {
+	if (dirty & RenderScheduler::RANGE)
+		applyRange();
+	plot->replot();
+	data->markRendered();
+}
+
+void MainWin::applyRange() {
 	int range = ui.rangeLn->text().toInt();
 	auto yMinMax = data->getDataMinMax(range);
 	double div = std::pow(10, std::floor(std::log10(yMinMax.second - yMinMax.first)));
@@ -215,11 +355,28 @@ void MainWin::updateRange() {
 		lastCustomPlotMsMainData - range,
 		lastCustomPlotMsMainData
 	);
-	plot->replot();
+}
+
+void MainWin::updatePlotData(const QCPRange & range) {
+	auto plotData = data->getSensorPlotData(range.lower, range.upper,
+		PLOT_POINTS_PER_PIXEL * plot->axisRect()->width());
+	plot->graph(Graph::IR)->setData(plotData.x, plotData.ir, true);
+	plot->graph(Graph::RED)->setData(plotData.x, plotData.red, true);
 }
 
 void MainWin::closeEvent(QCloseEvent *event) {
-	if (!data->isDataSaved()) {
+	// destroying the exporter cancels the export, so the file being saved would not be written
+	if (exporter->isRunning()) {
+		auto ans = QMessageBox::question(this, APP_NAME,
+			"Saving is still in progress. Exit program and cancel saving?",
+			QMessageBox::Cancel,
+			QMessageBox::Yes);
+		if (ans != QMessageBox::Yes) {
+			event->ignore();
+			return;
+		}
+	}
+	else if (!data->isDataSaved()) {
 		auto ans = QMessageBox::question(this, APP_NAME,
 			"Exit program without saving?",
 			QMessageBox::Cancel ,
@@ -232,5 +389,6 @@ void MainWin::closeEvent(QCloseEvent *event) {
 	auto devApi = ObjectFactory::getInstance<DeviceApi>();
 	devApi->setIrLedCurrent(0);
 	devApi->setRedLedCurrent(0);
+	data->discardJournal();
 	event->accept();
 }
\ No newline at end of file
@@ -4,7 +4,13 @@
 #include "ui_MainWin.h"
 
 class QCustomPlot;
+class QCPRange;
+class QProgressDialog;
+class QTimer;
 class Data;
+class HeartRateTableModel;
+class RenderScheduler;
+class XlsxExporter;
 
 /**
  * Klasa główna programu.
@@ -24,31 +30,53 @@ private:
 	enum Graph {
 		IR,
 		RED,
-		HR
+		HR,
+		SPO2
 	};
 
 	Ui::MainWinClass ui;
 	Data * data;
+	HeartRateTableModel * hrModel;
 	QCustomPlot * plot;
+	RenderScheduler * renderer;
+	XlsxExporter * exporter;
+	QProgressDialog * exportProgress;
 	double lastCustomPlotMsMainData = -1.0;
 	qint64 lastHRMs = -1;
+	size_t hrPlotCount = 0;		// heart rate values already added to the plot
+	size_t spo2PlotCount = 0;	// SpO2 estimates already added to the plot
+	QLabel * latencyLbl;
+	QTimer * latencyTimer;
 
 	const QString APP_NAME = "Heart rate analyzer";
+	const QString JOURNAL_FILE_NAME = "session.tmjrnl";
+	const int PLOT_POINTS_PER_PIXEL = 2;
+	const int LATENCY_REFRESH_INTERVAL = 1000;
 
 	void closeEvent(QCloseEvent *event) override;
 
 	void setupPlot();
+	void openJournal();
 	void titleUnsaved();
 	void titleSaved();
 	void setGraphVisible(Graph graph, bool visible);
+	void updatePlotData(const QCPRange & range);
+	void applyRange();
+	void render(int dirty);
 
 private slots:
 	void startStop(bool toggled);
 	void saveToFile();
+	void exportFinished(bool ok, quint64 revision);
+	void journalFailed();
 	void clear();
 	void receivedNewData();
 	void setRedLedGraphVisible(bool visible);
 	void setIrLedGraphVisible(bool visible);
 	void setHRGraphVisible(bool visible);
+	void setSpO2GraphVisible(bool visible);
+	void setLatencyVisible(bool visible);
+	void updateLatency();
+	void saveLatencyReport();
 	void updateRange();
 };
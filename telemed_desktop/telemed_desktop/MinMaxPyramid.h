@@ -0,0 +1,201 @@
+#pragma once
+#include <QtGlobal>
+#include <algorithm>
+#include <deque>
+#include <vector>
+
+auto constexpr MIN_MAX_PYRAMID_FANOUT = 4;	/**< Liczba przedziałów poziomu niższego składających się na przedział poziomu wyższego. */
+
+/**
+ * Wielorozdzielcza piramida minimów i maksimów serii wartości, np. do decymacji danych wykresu.
+ * Poziom 0 przechowuje minimum i maksimum każdych kolejnych MIN_MAX_PYRAMID_FANOUT wartości,
+ * każdy kolejny poziom - minimum i maksimum MIN_MAX_PYRAMID_FANOUT przedziałów poziomu niższego.
+ * Ostatni przedział każdego poziomu może być niepełny i jest uzupełniany przy dopisywaniu wartości.
+ * Najwyższy poziom składa się z jednego przedziału.
+ * Piramida zajmuje ok. 2 * sizeof(T) * 4 / 3 / MIN_MAX_PYRAMID_FANOUT bajtów na wartość,
+ * najstarsze przedziały niższych poziomów mogą zostać zwolnione przez MinMaxPyramid::release.
+ */
+template<class T>
+class MinMaxPyramid {
+	struct Level {
+		std::deque<T> min;
+		std::deque<T> max;
+		size_t first = 0;		// index of the first bucket kept
+
+		size_t end() const {
+			return first + min.size();
+		}
+	};
+
+	std::vector<Level> levels;
+	size_t count = 0;
+	size_t dirtyBucket = 0;		// first bucket of level 0 not propagated yet
+
+public:
+	/**
+	 * Dopisuje wartość do poziomu 0.
+	 * Przed odczytem wyższych poziomów należy wywołać MinMaxPyramid::propagate.
+	 * @param value Wartość.
+	 */
+	void push(T value) {
+		if (levels.empty())
+			levels.emplace_back();
+		auto & level = levels.front();
+		if (count % MIN_MAX_PYRAMID_FANOUT == 0) {
+			level.min.push_back(value);
+			level.max.push_back(value);
+		}
+		else {
+			level.min.back() = std::min(level.min.back(), value);
+			level.max.back() = std::max(level.max.back(), value);
+		}
+		++count;
+	}
+
+	/**
+	 * Uzupełnia wyższe poziomy o przedziały zmienione od ostatniego wywołania.
+	 * Koszt jest proporcjonalny do liczby dopisanych wartości, a nie do rozmiaru piramidy.
+	 */
+	void propagate() {
+		auto dirty = dirtyBucket;
+		for (size_t l = 1; !levels.empty() && levels[l - 1].end() > 1; ++l) {
+			if (l == levels.size())
+				levels.emplace_back();
+			auto & child = levels[l - 1];
+			auto & parent = levels[l];
+			dirty = std::max(dirty / MIN_MAX_PYRAMID_FANOUT, parent.first);
+			for (auto bucket = dirty; bucket * MIN_MAX_PYRAMID_FANOUT < child.end(); ++bucket) {
+				// some children of the bucket may be released already
+				auto begin = std::max(bucket * MIN_MAX_PYRAMID_FANOUT, child.first) - child.first;
+				auto end = std::min((bucket + 1) * MIN_MAX_PYRAMID_FANOUT, child.end()) - child.first;
+				if (begin >= end)
+					continue;
+				auto min = *std::min_element(child.min.begin() + begin, child.min.begin() + end);
+				auto max = *std::max_element(child.max.begin() + begin, child.max.begin() + end);
+				if (bucket < parent.end()) {
+					// values are only appended, so an existing bucket may only widen
+					auto i = bucket - parent.first;
+					parent.min[i] = std::min(parent.min[i], min);
+					parent.max[i] = std::max(parent.max[i], max);
+				}
+				else {
+					parent.min.push_back(min);
+					parent.max.push_back(max);
+				}
+			}
+		}
+		// the last bucket may still grow
+		dirtyBucket = levels.empty() ? 0 : levels.front().end() - 1;
+	}
+
+	/**
+	 * Zwalnia przedziały poziomów niższych niż level, obejmujące wyłącznie wartości o indeksach mniejszych niż values.
+	 * Nie wolno zwalniać przedziałów, które mogą się jeszcze zmienić, czyli zawierających ostatnią wartość.
+	 * @param values Liczba początkowych wartości.
+	 * @param level Najniższy poziom, który pozostaje kompletny.
+	 */
+	void release(size_t values, int level) {
+		for (int l = 0; l < std::min(level, levelCount()); ++l) {
+			auto & current = levels[l];
+			auto end = std::min(values / bucketSize(l), current.end());
+			while (current.first < end) {
+				current.min.pop_front();
+				current.max.pop_front();
+				++current.first;
+			}
+		}
+	}
+
+	/**
+	 * Usuwa wszystkie wartości.
+	 */
+	void clear() {
+		levels.clear();
+		count = 0;
+		dirtyBucket = 0;
+	}
+
+	/**
+	 * Getter.
+	 * @return Liczba dopisanych wartości.
+	 */
+	size_t size() const {
+		return count;
+	}
+
+	/**
+	 * Getter.
+	 * @return Liczba poziomów piramidy.
+	 */
+	int levelCount() const {
+		return int(levels.size());
+	}
+
+	/**
+	 * Getter.
+	 * @param level Poziom piramidy.
+	 * @return Liczba wartości w jednym przedziale poziomu.
+	 */
+	static size_t bucketSize(int level) {
+		size_t size = MIN_MAX_PYRAMID_FANOUT;
+		for (int l = 0; l < level; ++l)
+			size *= MIN_MAX_PYRAMID_FANOUT;
+		return size;
+	}
+
+	/**
+	 * Getter.
+	 * @param level Poziom piramidy.
+	 * @return Liczba przedziałów poziomu, łącznie ze zwolnionymi.
+	 */
+	size_t bucketCount(int level) const {
+		return levels[level].end();
+	}
+
+	/**
+	 * Getter.
+	 * @param level Poziom piramidy.
+	 * @return Indeks pierwszego przedziału poziomu, który nie został zwolniony.
+	 */
+	size_t firstBucket(int level) const {
+		return levels[level].first;
+	}
+
+	/**
+	 * Getter.
+	 * @param level Poziom piramidy.
+	 * @param bucket Indeks przedziału, obejmującego wartości [bucket * bucketSize(level), (bucket + 1) * bucketSize(level)),
+	 * nie mniejszy niż MinMaxPyramid::firstBucket.
+	 * @return Minimum przedziału.
+	 */
+	T min(int level, size_t bucket) const {
+		return levels[level].min[bucket - levels[level].first];
+	}
+
+	/**
+	 * Getter.
+	 * @param level Poziom piramidy.
+	 * @param bucket Indeks przedziału.
+	 * @return Maksimum przedziału.
+	 */
+	T max(int level, size_t bucket) const {
+		return levels[level].max[bucket - levels[level].first];
+	}
+
+	/**
+	 * Wyznacza najniższy poziom, na którym zakres wartości składa się z co najwyżej maxBuckets przedziałów.
+	 * @param values Liczba wartości w zakresie.
+	 * @param maxBuckets Maksymalna liczba przedziałów.
+	 * @return Poziom piramidy lub -1 jeżeli zakres mieści się w maxBuckets wartościach i decymacja nie jest potrzebna.
+	 */
+	int levelFor(size_t values, size_t maxBuckets) const {
+		if (values <= maxBuckets)
+			return -1;
+		maxBuckets = std::max<size_t>(maxBuckets, 2);
+		int level = 0;
+		// a range not aligned to buckets touches one more bucket
+		while (level + 1 < levelCount() && values / bucketSize(level) + 2 > maxBuckets)
+			++level;
+		return level;
+	}
+};
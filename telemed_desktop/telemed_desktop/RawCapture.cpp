@@ -0,0 +1,73 @@
+#include "RawCapture.h"
+
+#include <QDebug>
+#include <QtEndian>
+
+namespace {
+	const char MAGIC[] = { 'T', 'M', 'C', 'A', 'P' };
+	auto constexpr RECORD_HEADER_SIZE = 12;
+
+	QByteArray fileHeader() {
+		QByteArray header(MAGIC, sizeof(MAGIC));
+		header.append(char(RawCaptureWriter::VERSION));
+		return header;
+	}
+}
+
+bool RawCaptureWriter::open(const QString & path) {
+	close();
+	file.setFileName(path);
+	if (file.exists() && file.size() > 0) {
+		if (!file.open(QIODevice::ReadOnly))
+			return false;
+		auto header = file.read(HEADER_SIZE);
+		file.close();
+		if (header != fileHeader()) {
+			qDebug() << "Not a raw capture file" << path;
+			return false;
+		}
+		return file.open(QIODevice::WriteOnly | QIODevice::Append);
+	}
+
+	if (!file.open(QIODevice::WriteOnly | QIODevice::Append))
+		return false;
+	return file.write(fileHeader()) == HEADER_SIZE && file.flush();
+}
+
+bool RawCaptureWriter::write(const SensorFrame & frame, qint64 receivedMs) {
+	auto bytes = frame.toBinary();
+	QByteArray record(RECORD_HEADER_SIZE, '\0');
+	qToLittleEndian<qint64>(receivedMs, record.data());
+	qToLittleEndian<quint32>(quint32(bytes.size()), record.data() + 8);
+	record.append(bytes);
+	return file.write(record) == record.size() && file.flush();
+}
+
+void RawCaptureWriter::close() {
+	if (file.isOpen())
+		file.close();
+}
+
+bool RawCaptureReader::open(const QString & path) {
+	file.setFileName(path);
+	if (!file.open(QIODevice::ReadOnly))
+		return false;
+	if (file.read(RawCaptureWriter::HEADER_SIZE) != fileHeader()) {
+		qDebug() << "Not a raw capture file" << path;
+		file.close();
+		return false;
+	}
+	return true;
+}
+
+bool RawCaptureReader::next(qint64 & receivedMs, SensorFrame & frame) {
+	auto header = file.read(RECORD_HEADER_SIZE);
+	if (header.size() < RECORD_HEADER_SIZE)
+		return false;
+	receivedMs = qFromLittleEndian<qint64>(header.constData());
+	auto size = qFromLittleEndian<quint32>(header.constData() + 8);
+	auto bytes = file.read(size);
+	if (bytes.size() < qint64(size))
+		return false;
+	return SensorFrame::fromBinary(bytes, frame);
+}
@@ -0,0 +1,72 @@
+#pragma once
+#include <QFile>
+#include <QString>
+#include "SensorFrame.h"
+
+/**
+ * Zapis surowych paczek próbek odebranych z modułu WiFi, przed filtracją.
+ *
+ * Format pliku (little-endian):
+ *	- nagłówek: 'T', 'M', 'C', 'A', 'P', wersja (uint8_t),
+ *	- rekordy: czas odebrania paczki w milisekundach od początku epoki (int64_t),
+ *	  rozmiar ramki w bajtach (uint32_t), ramka binarna (format opisany w SensorFrame).
+ */
+class RawCaptureWriter {
+	QFile file;
+
+public:
+	static constexpr quint8 VERSION = 1;		/**< Wersja formatu pliku. */
+	static constexpr int HEADER_SIZE = 6;		/**< Rozmiar nagłówka pliku w bajtach. */
+
+	/**
+	 * Otwiera plik do dopisywania, nowy plik otrzymuje nagłówek.
+	 * @param path Ścieżka do pliku.
+	 * @return false jeżeli pliku nie można otworzyć lub nie jest plikiem w tym formacie.
+	 */
+	bool open(const QString & path);
+
+	/**
+	 * Dopisuje paczkę do pliku.
+	 * Dane przekazywane są do systemu operacyjnego po każdej paczce.
+	 * @param frame Paczka próbek ze stemplami czasowymi zegara modułu.
+	 * @param receivedMs Czas odebrania paczki w milisekundach od początku epoki.
+	 * @return false jeżeli zapis się nie powiódł.
+	 */
+	bool write(const SensorFrame & frame, qint64 receivedMs);
+
+	/**
+	 * Zamyka plik.
+	 */
+	void close();
+
+	/**
+	 * Metoda sprawdzająca czy plik jest otwarty.
+	 */
+	bool isOpen() const {
+		return file.isOpen();
+	}
+};
+
+/**
+ * Odczyt pliku zapisanego przez RawCaptureWriter.
+ */
+class RawCaptureReader {
+	QFile file;
+
+public:
+	/**
+	 * Otwiera plik do odczytu.
+	 * @param path Ścieżka do pliku.
+	 * @return false jeżeli pliku nie można otworzyć lub nie jest plikiem w tym formacie.
+	 */
+	bool open(const QString & path);
+
+	/**
+	 * Odczytuje kolejną paczkę.
+	 * Niekompletny ostatni rekord (np. po przerwaniu zapisu) traktowany jest jak koniec pliku.
+	 * @param receivedMs Czas odebrania paczki w milisekundach od początku epoki.
+	 * @param frame Paczka próbek ze stemplami czasowymi zegara modułu.
+	 * @return false jeżeli osiągnięto koniec pliku lub rekord jest uszkodzony.
+	 */
+	bool next(qint64 & receivedMs, SensorFrame & frame);
+};
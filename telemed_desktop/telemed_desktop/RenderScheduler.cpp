@@ -0,0 +1,38 @@
+#include "RenderScheduler.h"
+#include <algorithm>
+
+RenderScheduler::RenderScheduler(std::function<void(int)> render_, int frameInterval_, QObject * parent)
+	: QObject(parent), render(std::move(render_)), frameInterval(std::max(1, frameInterval_))
+{
+	timer.setSingleShot(true);
+	timer.setTimerType(Qt::PreciseTimer);
+	connect(&timer, &QTimer::timeout, this, &RenderScheduler::renderFrame);
+}
+
+void RenderScheduler::request(int flags) {
+	if (dirty != 0) {
+		dirty |= flags;
+		++skipped;
+		return;
+	}
+	dirty = flags;
+	// a slow frame delays the next one by its own duration, which leaves time for the incoming data
+	auto interval = std::max(frameInterval, lastRenderMs);
+	auto elapsed = sinceRender.isValid() ? sinceRender.elapsed() : qint64(interval);
+	timer.start(int(std::max<qint64>(0, interval - elapsed)));
+}
+
+void RenderScheduler::setFrameInterval(int ms) {
+	frameInterval = std::max(1, ms);
+}
+
+void RenderScheduler::renderFrame() {
+	auto flags = dirty;
+	dirty = 0;
+	if (flags == 0)
+		return;
+	sinceRender.start();
+	render(flags);
+	lastRenderMs = int(sinceRender.elapsed());
+	++rendered;
+}
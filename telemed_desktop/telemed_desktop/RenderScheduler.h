@@ -0,0 +1,79 @@
+#pragma once
+#include <QElapsedTimer>
+#include <QObject>
+#include <QTimer>
+#include <functional>
+
+auto constexpr RENDER_FRAME_INTERVAL = 16;	/**< Domyślny okres ramki w milisekundach (ok. 60 Hz). */
+
+/**
+ * Klasa łącząca żądania odświeżenia wykresu w co najwyżej jedno odświeżenie na ramkę wyświetlacza.
+ * Żądania oznaczają zmienione elementy flagami (RenderScheduler::Dirty), które są sumowane do chwili
+ * odświeżenia, a następnie przekazywane razem do funkcji rysującej.
+ *
+ * Jeżeli rysowanie trwa dłużej niż ramka, kolejna ramka rysowana jest dopiero po upływie czasu
+ * ostatniego rysowania, dzięki czemu pętla zdarzeń ma czas na odbiór i przetwarzanie danych.
+ * Pomijane jest wyłącznie rysowanie, nigdy dopisywanie danych.
+ */
+class RenderScheduler : public QObject
+{
+	Q_OBJECT
+public:
+	/**
+	 * Flagi zmienionych elementów.
+	 */
+	enum Dirty {
+		REPLOT = 1,		/**< Ponowne narysowanie wykresu. */
+		RANGE = 2		/**< Wyznaczenie zakresu osi i danych widocznego zakresu, a następnie narysowanie. */
+	};
+
+private:
+	std::function<void(int)> render;
+	QTimer timer;
+	QElapsedTimer sinceRender;
+	int frameInterval;
+	int lastRenderMs = 0;
+	int dirty = 0;
+	quint64 rendered = 0;
+	quint64 skipped = 0;
+
+	void renderFrame();
+
+public:
+	/**
+	 * Konstruktor inicjalizujący.
+	 * @param render_ Funkcja rysująca, wywoływana w wątku obiektu z sumą flag zgłoszonych od ostatniej ramki.
+	 * @param frameInterval_ Okres ramki w milisekundach.
+	 * @param parent Przodek obiektu.
+	 */
+	RenderScheduler(std::function<void(int)> render_, int frameInterval_ = RENDER_FRAME_INTERVAL,
+		QObject * parent = nullptr);
+
+	/**
+	 * Zgłasza żądanie odświeżenia. Jeżeli odświeżenie jest już zaplanowane, flagi są do niego dołączane.
+	 * @param flags Suma flag RenderScheduler::Dirty.
+	 */
+	void request(int flags);
+
+	/**
+	 * Setter.
+	 * @param ms Okres ramki w milisekundach, np. wynikający z częstotliwości odświeżania ekranu.
+	 */
+	void setFrameInterval(int ms);
+
+	/**
+	 * Getter.
+	 * @return Liczba narysowanych ramek.
+	 */
+	quint64 framesRendered() const {
+		return rendered;
+	}
+
+	/**
+	 * Getter.
+	 * @return Liczba żądań dołączonych do już zaplanowanej ramki, czyli odświeżeń pominiętych.
+	 */
+	quint64 framesSkipped() const {
+		return skipped;
+	}
+};
@@ -0,0 +1,98 @@
+#include "ReplayEngine.h"
+
+#include <QElapsedTimer>
+#include <QThread>
+#include <cmath>
+
+namespace {
+	auto constexpr HR_TOLERANCE = 1e-3;	// bpm
+}
+
+ReplayEngine::ReplayEngine(unsigned int quantileMeanN)
+	: timeBase(&clock),
+	pipeline(quantileMeanN)
+{
+}
+
+ReplayReport ReplayEngine::run(const SessionRecording & recording,
+	const std::function<void(const ProcessedBatch &)> & onBatch)
+{
+	ReplayReport report;
+	std::vector<HeartRate> heartRate;
+	std::vector<HeartRate> quantileMeanHeartRate;
+	auto & frames = recording.getFrames();
+	pipeline.setFilteringEnabled(!recording.isFiltered());
+
+	QElapsedTimer wallClock;
+	wallClock.start();
+	qint64 busyNs = 0;
+	qint64 lastDeviceMs = -1;
+	for (auto & recorded : frames) {
+		if (speed > 0.0) {
+			auto dueMs = qint64((recorded.receivedMs - frames.front().receivedMs) / speed);
+			auto waitMs = dueMs - wallClock.elapsed();
+			if (waitMs > 0)
+				QThread::msleep(waitMs);
+		}
+		auto & frame = recorded.frame;
+		if (frame.empty())
+			continue;
+
+		QElapsedTimer busy;
+		busy.start();
+		// the clock of the module went backwards, so it was restarted
+		if (frame.getSamples().back().getMs() < lastDeviceMs)
+			timeBase.reset();
+		lastDeviceMs = frame.getSamples().back().getMs();
+		clock.set(recorded.receivedMs);
+
+		ProcessedBatch batch;
+		pipeline.process(frame, timeBase.anchor(frame), batch);
+		busyNs += busy.nsecsElapsed();
+
+		++report.frames;
+		report.samples += batch.samples.size();
+		heartRate.insert(heartRate.end(), batch.heartRatesRaw.begin(), batch.heartRatesRaw.end());
+		quantileMeanHeartRate.insert(quantileMeanHeartRate.end(), batch.heartRates.begin(), batch.heartRates.end());
+		if (onBatch)
+			onBatch(batch);
+	}
+	report.elapsedNs = busyNs;
+	report.heartRates = heartRate.size();
+
+	if (recording.hasReference())
+		compare(recording, heartRate, quantileMeanHeartRate, report);
+	return report;
+}
+
+void ReplayEngine::compare(const SessionRecording & recording,
+	const std::vector<HeartRate> & heartRate,
+	const std::vector<HeartRate> & quantileMeanHeartRate,
+	ReplayReport & report) const
+{
+	auto & reference = recording.getReferenceHeartRate();
+	auto & referenceMean = recording.getReferenceQuantileMeanHeartRate();
+	report.referenceHeartRates = reference.size();
+	if (heartRate.empty())
+		return;
+
+	// the recording may have started before the replayed samples, align on the first period
+	size_t offset = 0;
+	while (offset < reference.size()
+		&& std::abs(reference[offset].getEndMs() - heartRate.front().getEndMs()) > timeToleranceMs)
+		++offset;
+	if (offset == reference.size()) {
+		report.mismatches = heartRate.size();
+		return;
+	}
+	report.referenceHeartRates -= offset;
+
+	for (size_t i = 0; i < heartRate.size() && i + offset < reference.size(); ++i) {
+		++report.compared;
+		auto & ref = reference[i + offset];
+		if (std::abs(ref.getEndMs() - heartRate[i].getEndMs()) > timeToleranceMs
+			|| std::abs(ref.getHR() - heartRate[i].getHR()) > HR_TOLERANCE
+			|| std::abs(referenceMean[i + offset].getHR() - quantileMeanHeartRate[i].getHR()) > HR_TOLERANCE)
+			++report.mismatches;
+	}
+}
@@ -0,0 +1,90 @@
+#pragma once
+#include <functional>
+#include <vector>
+#include "Clock.h"
+#include "HeartRate.h"
+#include "SessionRecording.h"
+#include "SignalPipeline.h"
+
+/**
+ * Wynik odtworzenia sesji.
+ */
+struct ReplayReport {
+	size_t frames = 0;					/**< Liczba odtworzonych paczek. */
+	size_t samples = 0;					/**< Liczba przetworzonych próbek. */
+	qint64 elapsedNs = 0;				/**< Czas przetwarzania w nanosekundach. */
+	size_t heartRates = 0;				/**< Liczba wyznaczonych wartości pulsu. */
+	size_t referenceHeartRates = 0;		/**< Liczba wartości pulsu w wyniku odniesienia. */
+	size_t compared = 0;				/**< Liczba porównanych wartości pulsu. */
+	size_t mismatches = 0;				/**< Liczba wartości pulsu różniących się od wyniku odniesienia. */
+
+	/**
+	 * Getter.
+	 * @return Liczba próbek przetwarzanych na sekundę.
+	 */
+	double samplesPerSecond() const {
+		return elapsedNs > 0 ? samples * 1e9 / elapsedNs : 0.0;
+	}
+
+	/**
+	 * Metoda sprawdzająca czy wynik jest zgodny z wynikiem odniesienia.
+	 * Wszystkie wartości pulsu muszą zostać porównane i nie mogą się różnić.
+	 */
+	bool matches() const {
+		return referenceHeartRates > 0 && mismatches == 0
+			&& compared == heartRates && compared == referenceHeartRates;
+	}
+};
+
+/**
+ * Klasa odtwarzająca nagraną sesję przez ten sam potok przetwarzania co podczas pomiaru
+ * (filtracja, detekcja uderzeń, średnia obcięta pulsu).
+ * Czas odebrania paczek pochodzi z zegara wirtualnego, dlatego wynik nie zależy od chwili odtworzenia.
+ * Sesja może być odtwarzana w tempie rzeczywistym (lub jego wielokrotności) albo z maksymalną prędkością.
+ */
+class ReplayEngine {
+	VirtualClock clock;
+	TimeBase timeBase;
+	SignalPipeline pipeline;
+	double speed = 0.0;
+	qint64 timeToleranceMs = 2;
+
+	void compare(const SessionRecording & recording,
+		const std::vector<HeartRate> & heartRate,
+		const std::vector<HeartRate> & quantileMeanHeartRate,
+		ReplayReport & report) const;
+
+public:
+	/**
+	 * Konstruktor inicjalizujący.
+	 * @param quantileMeanN Liczba wartości pulsu uwzględnianych w średniej obciętej, taka jak podczas nagrania.
+	 */
+	ReplayEngine(unsigned int quantileMeanN);
+
+	/**
+	 * Setter.
+	 * @param speed_ Krotność tempa rzeczywistego, 1 - tempo rzeczywiste, 0 - maksymalna prędkość.
+	 */
+	void setSpeed(double speed_) {
+		speed = speed_;
+	}
+
+	/**
+	 * Setter.
+	 * Stemple czasowe pulsu z surowego zapisu mogą różnić się od zapisanych przez Data o kilka milisekund,
+	 * ponieważ czas odebrania paczki odczytywany jest w obu miejscach osobno.
+	 * @param ms Dopuszczalna różnica stempli czasowych przy porównaniu z wynikiem odniesienia.
+	 */
+	void setTimeTolerance(qint64 ms) {
+		timeToleranceMs = ms;
+	}
+
+	/**
+	 * Odtwarza sesję.
+	 * @param recording Nagrana sesja.
+	 * @param onBatch Funkcja wywoływana dla każdej przetworzonej paczki, może być pusta.
+	 * @return Statystyki odtworzenia i wynik porównania z wynikiem odniesienia, o ile sesja go posiada.
+	 */
+	ReplayReport run(const SessionRecording & recording,
+		const std::function<void(const ProcessedBatch &)> & onBatch = nullptr);
+};
@@ -0,0 +1,211 @@
+#include "SensorDataStore.h"
+
+#include <QDebug>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QTemporaryFile>
+#include <algorithm>
+#include <atomic>
+#include <list>
+
+/**
+ * Plik tymczasowy z blokami przeniesionymi z pamięci, współdzielony przez kopie magazynu.
+ * Bloki zapisywane są w natywnej postaci, jeden za drugim.
+ */
+class SensorDataStore::Spill {
+	QMutex mutex;
+	QTemporaryFile file;
+	std::list<std::pair<qint64, std::shared_ptr<const Chunk>>> cache;	// most recently used first
+
+	static quint64 nextId() {
+		static std::atomic<quint64> id{ 0 };
+		return ++id;
+	}
+
+public:
+	const quint64 id = nextId();	/**< Identyfikator pliku, unikalny w obrębie procesu. */
+
+	/**
+	 * Tworzy plik tymczasowy.
+	 * @param dir Katalog pliku.
+	 * @return false jeżeli pliku nie można utworzyć.
+	 */
+	bool open(const QString & dir) {
+		file.setFileTemplate(QDir(dir).filePath("telemed_spill_XXXXXX.tmp"));
+		if (!file.open()) {
+			qDebug() << "Cannot create spill file in" << dir << file.errorString();
+			return false;
+		}
+		return true;
+	}
+
+	/**
+	 * Dopisuje blok.
+	 * @return Położenie bloku w pliku lub -1 jeżeli zapis się nie powiódł.
+	 */
+	qint64 write(const Chunk & chunk) {
+		QMutexLocker lock(&mutex);
+		auto offset = file.size();
+		if (!file.seek(offset)
+			|| file.write(reinterpret_cast<const char *>(&chunk), sizeof(Chunk)) != qint64(sizeof(Chunk))
+			|| !file.flush())
+		{
+			qDebug() << "Cannot write spill file" << file.fileName() << file.errorString();
+			return -1;
+		}
+		return offset;
+	}
+
+	/**
+	 * Odczytuje blok, korzystając z pamięci podręcznej ostatnio używanych bloków.
+	 * Blok, którego nie można odczytać, zwracany jest wypełniony zerami.
+	 */
+	std::shared_ptr<const Chunk> read(qint64 offset) {
+		QMutexLocker lock(&mutex);
+		for (auto it = cache.begin(); it != cache.end(); ++it) {
+			if (it->first == offset) {
+				cache.splice(cache.begin(), cache, it);
+				return it->second;
+			}
+		}
+
+		auto chunk = std::make_shared<Chunk>();
+		if (!file.seek(offset)
+			|| file.read(reinterpret_cast<char *>(chunk.get()), sizeof(Chunk)) != qint64(sizeof(Chunk)))
+		{
+			qDebug() << "Cannot read spill file" << file.fileName() << file.errorString();
+			*chunk = Chunk();
+		}
+		cache.emplace_front(offset, chunk);
+		if (cache.size() > SENSOR_DATA_PAGE_CACHE)
+			cache.pop_back();
+		return chunk;
+	}
+};
+
+SensorDataStore::Chunk & SensorDataStore::appendChunk(qint64 ms) {
+	auto pos = count % SENSOR_DATA_CHUNK_SIZE;
+	if (pos == 0) {
+		chunks.push_back(std::make_shared<Chunk>());
+		firstMs.push_back(ms);
+		spillOffsets.push_back(-1);
+	}
+	else if (chunks.back().use_count() > 1) {
+		chunks.back() = std::make_shared<Chunk>(*chunks.back());
+	}
+	return *chunks.back();
+}
+
+bool SensorDataStore::append(qint64 ms, int ir, int red) {
+	if (count != 0 && ms <= getMs(count - 1))
+		return false;
+
+	auto pos = count % SENSOR_DATA_CHUNK_SIZE;
+	Chunk & c = appendChunk(ms);
+	c.ms[pos] = ms;
+	c.ir[pos] = ir;
+	c.red[pos] = red;
+	++count;
+	return true;
+}
+
+size_t SensorDataStore::append(const qint64 * ms, const int * ir, const int * red, size_t n) {
+	bool increasing = n == 0 || count == 0 || ms[0] > getMs(count - 1);
+	for (size_t i = 1; increasing && i < n; ++i)
+		increasing = ms[i - 1] < ms[i];
+	if (!increasing) {
+		size_t appended = 0;
+		for (size_t i = 0; i < n; ++i)
+			appended += append(ms[i], ir[i], red[i]) ? 1 : 0;
+		return appended;
+	}
+
+	size_t done = 0;
+	while (done < n) {
+		auto pos = count % SENSOR_DATA_CHUNK_SIZE;
+		Chunk & c = appendChunk(ms[done]);
+		auto len = std::min<size_t>(SENSOR_DATA_CHUNK_SIZE - pos, n - done);
+		std::copy_n(ms + done, len, c.ms.begin() + pos);
+		std::copy_n(ir + done, len, c.ir.begin() + pos);
+		std::copy_n(red + done, len, c.red.begin() + pos);
+		count += len;
+		done += len;
+	}
+	return n;
+}
+
+void SensorDataStore::clear() {
+	chunks.clear();
+	firstMs.clear();
+	spillOffsets.clear();
+	// copies may still read the file, it is removed with the last of them
+	spillFile.reset();
+	firstResident = 0;
+	count = 0;
+}
+
+size_t SensorDataStore::spill(size_t maxResidentChunks, const QString & dir) {
+	size_t spilled = 0;
+	while (residentChunks() > std::max<size_t>(maxResidentChunks, 1) && firstResident + 1 < chunks.size()) {
+		if (!spillFile) {
+			auto file = std::make_shared<Spill>();
+			if (!file->open(dir))
+				break;
+			spillFile = file;
+		}
+		auto offset = spillFile->write(*chunks[firstResident]);
+		if (offset < 0)
+			break;
+		// copies sharing the chunk keep it in memory until they are destroyed
+		spillOffsets[firstResident] = offset;
+		chunks[firstResident].reset();
+		++firstResident;
+		++spilled;
+	}
+	return spilled;
+}
+
+size_t SensorDataStore::chunkBytes() {
+	return sizeof(Chunk);
+}
+
+std::shared_ptr<const SensorDataStore::Chunk> SensorDataStore::page(size_t chunkIndex) const {
+	if (chunks[chunkIndex])
+		return chunks[chunkIndex];
+	return spillFile->read(spillOffsets[chunkIndex]);
+}
+
+const SensorDataStore::Chunk & SensorDataStore::pagedIn(size_t chunkIndex) const {
+	// sequential reads of a spilled chunk take neither the lock nor the cache
+	thread_local struct {
+		quint64 spillId = 0;
+		qint64 offset = -1;
+		std::shared_ptr<const Chunk> chunk;
+	} last;
+	auto offset = spillOffsets[chunkIndex];
+	if (last.spillId != spillFile->id || last.offset != offset) {
+		last.chunk = spillFile->read(offset);
+		last.spillId = spillFile->id;
+		last.offset = offset;
+	}
+	return *last.chunk;
+}
+
+size_t SensorDataStore::upperBound(qint64 ms) const {
+	if (count == 0 || getMs(count - 1) <= ms)
+		return count;
+
+	// first chunk which begins later than ms, the answer lies in the preceding one
+	auto chunkIt = std::upper_bound(firstMs.begin(), firstMs.end(), ms);
+	if (chunkIt == firstMs.begin())
+		return 0;
+	--chunkIt;
+
+	size_t chunkIdx = std::distance(firstMs.begin(), chunkIt);
+	size_t chunkBeg = chunkIdx * SENSOR_DATA_CHUNK_SIZE;
+	size_t chunkLen = std::min<size_t>(SENSOR_DATA_CHUNK_SIZE, count - chunkBeg);
+	auto held = page(chunkIdx);
+	auto & msCol = held->ms;
+	auto it = std::upper_bound(msCol.begin(), msCol.begin() + chunkLen, ms);
+	return chunkBeg + std::distance(msCol.begin(), it);
+}
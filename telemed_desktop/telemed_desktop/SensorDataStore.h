@@ -0,0 +1,208 @@
+#pragma once
+#include <QDir>
+#include <QtGlobal>
+#include <algorithm>
+#include <array>
+#include <memory>
+#include <vector>
+#include "SensorData.h"
+
+auto constexpr SENSOR_DATA_CHUNK_SIZE = 4096;	/**< Liczba próbek w pojedynczym bloku magazynu. */
+auto constexpr SENSOR_DATA_PAGE_CACHE = 16;		/**< Liczba bloków odczytanych z dysku przechowywanych w pamięci podręcznej. */
+
+/**
+ * Kolumnowy magazyn próbek odebranych z modułu WiFi.
+ * Próbki przechowywane są w blokach o stałym rozmiarze, osobno dla każdej kolumny
+ * (stempel czasowy, dioda podczerwona, dioda czerwona).
+ * Próbki dopisywane są wyłącznie na końcu, w kolejności rosnących stempli czasowych,
+ * dzięki czemu wyszukiwanie zakresu czasu odbywa się wyszukiwaniem binarnym.
+ * Kopia magazynu współdzieli bloki z oryginałem i widzi wyłącznie próbki istniejące w chwili kopiowania,
+ * dlatego może posłużyć za migawkę czytaną w innym wątku, podczas gdy do oryginału dopisywane są próbki.
+ * Dopisanie do współdzielonego, niepełnego bloku powoduje jego skopiowanie.
+ *
+ * Najstarsze pełne bloki mogą zostać przeniesione do pliku tymczasowego (SensorDataStore::spill),
+ * w pamięci pozostaje wtedy tylko stempel czasowy pierwszej próbki bloku. Bloki z pliku wczytywane są
+ * przy odczycie, z pamięcią podręczną ostatnio używanych bloków, również w kopiach magazynu czytanych
+ * w innych wątkach. Plik usuwany jest, gdy nie korzysta z niego żaden magazyn.
+ */
+class SensorDataStore {
+	struct Chunk {
+		std::array<qint64, SENSOR_DATA_CHUNK_SIZE> ms;
+		std::array<int, SENSOR_DATA_CHUNK_SIZE> ir;
+		std::array<int, SENSOR_DATA_CHUNK_SIZE> red;
+	};
+
+	class Spill;
+
+	std::vector<std::shared_ptr<Chunk>> chunks;		// nullptr for chunks moved to the spill file
+	std::vector<qint64> firstMs;
+	std::vector<qint64> spillOffsets;
+	std::shared_ptr<Spill> spillFile;
+	size_t firstResident = 0;
+	size_t count = 0;
+
+	const Chunk & pagedIn(size_t chunkIndex) const;
+	std::shared_ptr<const Chunk> page(size_t chunkIndex) const;
+	Chunk & appendChunk(qint64 ms);
+
+	/**
+	 * Referencja do bloku wczytanego z dysku pozostaje ważna do wczytania kolejnego bloku w tym samym wątku,
+	 * więc może być używana wyłącznie w obrębie jednego wyrażenia.
+	 */
+	const Chunk & chunk(size_t i) const {
+		auto & c = chunks[i / SENSOR_DATA_CHUNK_SIZE];
+		return c ? *c : pagedIn(i / SENSOR_DATA_CHUNK_SIZE);
+	}
+
+public:
+	/**
+	 * Dopisuje próbkę na końcu magazynu.
+	 * @param ms Stempel czasowy próbki, musi być większy od stempla ostatniej próbki.
+	 * @param ir Wartość odczytana z diody podczerwonej.
+	 * @param red Wartość odczytana z diody czerwonej.
+	 * @return true jeżeli próbka została dopisana.
+	 * @return false jeżeli stempel czasowy nie jest większy od ostatniego.
+	 */
+	bool append(qint64 ms, int ir, int red);
+
+	/**
+	 * Dopisuje serię próbek na końcu magazynu, kopiując kolumny blok po bloku.
+	 * Jeżeli stemple czasowe serii nie są rosnące, próbki dopisywane są pojedynczo, z pominięciem
+	 * próbek o stemplu nie większym od poprzedniego.
+	 * @param ms Stemple czasowe próbek.
+	 * @param ir Wartości odczytane z diody podczerwonej.
+	 * @param red Wartości odczytane z diody czerwonej.
+	 * @param n Liczba próbek.
+	 * @return Liczba dopisanych próbek.
+	 */
+	size_t append(const qint64 * ms, const int * ir, const int * red, size_t n);
+
+	/**
+	 * Usuwa wszystkie próbki.
+	 */
+	void clear();
+
+	/**
+	 * Przenosi najstarsze bloki do pliku tymczasowego tak, aby w pamięci pozostało co najwyżej maxResidentChunks bloków.
+	 * Ostatni, niepełny blok zawsze pozostaje w pamięci. Jeżeli zapis się nie powiedzie, bloki pozostają w pamięci.
+	 * @param maxResidentChunks Maksymalna liczba bloków w pamięci.
+	 * @param dir Katalog pliku tymczasowego, używany przy pierwszym przeniesieniu bloku.
+	 * @return Liczba przeniesionych bloków.
+	 */
+	size_t spill(size_t maxResidentChunks, const QString & dir = QDir::tempPath());
+
+	/**
+	 * Getter.
+	 * @return Liczba początkowych próbek przeniesionych do pliku tymczasowego, wielokrotność SENSOR_DATA_CHUNK_SIZE.
+	 */
+	size_t spilledSize() const {
+		return firstResident * SENSOR_DATA_CHUNK_SIZE;
+	}
+
+	/**
+	 * Getter.
+	 * @return Liczba bloków w pamięci.
+	 */
+	size_t residentChunks() const {
+		return chunks.size() - firstResident;
+	}
+
+	/**
+	 * Getter.
+	 * @return Rozmiar jednego bloku w pamięci w bajtach.
+	 */
+	static size_t chunkBytes();
+
+	/**
+	 * Getter.
+	 * @return Liczba próbek w magazynie.
+	 */
+	size_t size() const {
+		return count;
+	}
+
+	/**
+	 * Metoda sprawdzająca czy magazyn jest pusty.
+	 */
+	bool empty() const {
+		return count == 0;
+	}
+
+	/**
+	 * Getter.
+	 * @param i Indeks próbki.
+	 * @return Stempel czasowy próbki w milisekundach.
+	 */
+	qint64 getMs(size_t i) const {
+		// the first stamp of a spilled chunk stays in memory, e.g. for the decimated plot
+		if (i % SENSOR_DATA_CHUNK_SIZE == 0)
+			return firstMs[i / SENSOR_DATA_CHUNK_SIZE];
+		return chunk(i).ms[i % SENSOR_DATA_CHUNK_SIZE];
+	}
+
+	/**
+	 * Getter.
+	 * @param i Indeks próbki.
+	 * @return Wartość odczytana z diody podczerwonej.
+	 */
+	int getIrLed(size_t i) const {
+		return chunk(i).ir[i % SENSOR_DATA_CHUNK_SIZE];
+	}
+
+	/**
+	 * Getter.
+	 * @param i Indeks próbki.
+	 * @return Wartość odczytana z diody czerwonej.
+	 */
+	int getRedLed(size_t i) const {
+		return chunk(i).red[i % SENSOR_DATA_CHUNK_SIZE];
+	}
+
+	/**
+	 * Getter.
+	 * @param i Indeks próbki.
+	 * @return Próbka o podanym indeksie.
+	 */
+	SensorData at(size_t i) const {
+		return SensorData(getMs(i), getIrLed(i), getRedLed(i));
+	}
+
+	/**
+	 * Getter.
+	 * @return Ostatnia próbka w magazynie, magazyn nie może być pusty.
+	 */
+	SensorData back() const {
+		return at(count - 1);
+	}
+
+	/**
+	 * Wyszukuje binarnie pierwszą próbkę późniejszą niż podany stempel czasowy.
+	 * @param ms Stempel czasowy w milisekundach.
+	 * @return Indeks pierwszej próbki o stemplu większym od ms lub size() jeżeli brak takiej próbki.
+	 */
+	size_t upperBound(qint64 ms) const;
+
+	/**
+	 * Wywołuje funktor dla każdej próbki z zakresu [begin, end), blok po bloku.
+	 * Funktor może odczytywać inne magazyny, bloki z dysku przytrzymywane są na czas ich przeglądania.
+	 * @param begin Indeks pierwszej próbki.
+	 * @param end Indeks za ostatnią próbką.
+	 * @param f Funktor o sygnaturze f(qint64 ms, int ir, int red).
+	 */
+	template<class Functor>
+	void forEach(size_t begin, size_t end, Functor f) const;
+};
+
+template<class Functor>
+inline void SensorDataStore::forEach(size_t begin, size_t end, Functor f) const
+{
+	while (begin < end) {
+		auto held = page(begin / SENSOR_DATA_CHUNK_SIZE);
+		const Chunk & c = *held;
+		size_t from = begin % SENSOR_DATA_CHUNK_SIZE;
+		size_t to = std::min<size_t>(SENSOR_DATA_CHUNK_SIZE, from + (end - begin));
+		for (size_t i = from; i < to; ++i)
+			f(c.ms[i], c.ir[i], c.red[i]);
+		begin += to - from;
+	}
+}
@@ -0,0 +1,135 @@
+#include "SensorFrame.h"
+
+#include <nlohmann/json.h>
+#include <QDebug>
+#include <algorithm>
+
+namespace {
+	quint16 readU16(const uchar * p) {
+		return quint16(p[0] | (p[1] << 8));
+	}
+
+	quint32 readU32(const uchar * p) {
+		return quint32(readU16(p)) | (quint32(readU16(p + 2)) << 16);
+	}
+
+	void putU16(char * p, quint16 value) {
+		p[0] = char(value & 0xff);
+		p[1] = char(value >> 8);
+	}
+
+	void putU32(char * p, quint32 value) {
+		putU16(p, quint16(value & 0xffff));
+		putU16(p + 2, quint16(value >> 16));
+	}
+
+	quint16 clampU16(int value) {
+		return quint16(std::min(std::max(value, 0), 0xffff));
+	}
+}
+
+bool SensorFrame::fromBinary(const QByteArray & bytes, SensorFrame & frame) {
+	auto p = reinterpret_cast<const uchar *>(bytes.constData());
+	if (bytes.size() < HEADER_SIZE || p[0] != 'T' || p[1] != 'M') {
+		qDebug() << "Invalid sensor frame";
+		return false;
+	}
+	if (p[2] != VERSION) {
+		qDebug() << "Unsupported sensor frame version" << p[2];
+		return false;
+	}
+	auto count = readU16(p + 4);
+	if (bytes.size() < HEADER_SIZE + count * SAMPLE_SIZE) {
+		qDebug() << "Truncated sensor frame";
+		return false;
+	}
+
+	frame.seq = readU32(p + 6);
+	frame.sequenced = true;
+	qint64 ms = readU32(p + 10);
+	frame.samples.clear();
+	frame.samples.reserve(count);
+	for (p += HEADER_SIZE; count--; p += SAMPLE_SIZE) {
+		ms += readU16(p);
+		frame.samples.emplace_back(ms, readU16(p + 2), readU16(p + 4));
+	}
+	return true;
+}
+
+QByteArray SensorFrame::toBinary() const {
+	QByteArray bytes(HEADER_SIZE + int(samples.size()) * SAMPLE_SIZE, '\0');
+	auto p = bytes.data();
+	p[0] = 'T';
+	p[1] = 'M';
+	p[2] = char(VERSION);
+	putU16(p + 4, quint16(samples.size()));
+	putU32(p + 6, seq);
+	qint64 ms = samples.empty() ? 0 : samples.front().getMs();
+	putU32(p + 10, quint32(ms));
+	p += HEADER_SIZE;
+	for (auto & sample : samples) {
+		putU16(p, quint16(sample.getMs() - ms));
+		putU16(p + 2, clampU16(sample.getIrLed()));
+		putU16(p + 4, clampU16(sample.getRedLed()));
+		ms = sample.getMs();
+		p += SAMPLE_SIZE;
+	}
+	return bytes;
+}
+
+bool SensorFrame::fromJson(const std::string & json, SensorFrame & frame) {
+	nlohmann::json data;
+	try {
+		data = nlohmann::json::parse(json);
+	}
+	catch (const std::exception & ex) {
+		qDebug() << ex.what();
+		return false;
+	}
+	if (data.is_object()) {
+		qDebug() << data.value("status", std::string()).c_str();
+		return false;
+	}
+
+	frame.seq = 0;
+	frame.sequenced = false;
+	frame.samples.resize(data.size());
+	try {
+		for (auto & row : data) {
+			if (!row.contains("seq"))
+				break;
+			auto seq = row["seq"].get<quint32>();
+			frame.seq = frame.sequenced ? std::min(frame.seq, seq) : seq;
+			frame.sequenced = true;
+		}
+		std::transform(data.begin(), data.end(), frame.samples.begin(),
+			[](const nlohmann::json::value_type & row)->SensorData {
+				return SensorData(
+					row["ms"].get<unsigned long long>(),
+					row["ir"].get<int>(),
+					row["red"].get<int>()
+				);
+		});
+	}
+	catch (const std::exception & ex) {
+		qDebug() << ex.what();
+		return false;
+	}
+	// ring buffer of the device is not ordered by time
+	std::sort(frame.samples.begin(), frame.samples.end());
+	return true;
+}
+
+void SensorFrame::trimBefore(quint32 firstSeq) {
+	if (firstSeq <= seq)
+		return;
+	auto n = std::min<size_t>(firstSeq - seq, samples.size());
+	samples.erase(samples.begin(), samples.begin() + n);
+	seq += quint32(n);
+}
+
+void SensorFrame::trimNotLaterThan(qint64 ms) {
+	auto it = std::upper_bound(samples.begin(), samples.end(), SensorData(ms));
+	seq += quint32(std::distance(samples.begin(), it));
+	samples.erase(samples.begin(), it);
+}
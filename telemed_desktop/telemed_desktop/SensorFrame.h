@@ -0,0 +1,139 @@
+#pragma once
+#include <QByteArray>
+#include <QMetaType>
+#include <string>
+#include <vector>
+#include "SensorData.h"
+
+/**
+ * Klasa reprezentująca paczkę próbek odebraną z modułu WiFi.
+ * Stemple czasowe próbek wyrażone są w milisekundach zegara modułu, próbki są uporządkowane rosnąco.
+ *
+ * Format ramki binarnej (little-endian), wersja 1:
+ *	- 'T', 'M', wersja (uint8_t), zarezerwowany (uint8_t),
+ *	- liczba próbek (uint16_t),
+ *	- numer sekwencyjny pierwszej próbki (uint32_t),
+ *	- stempel czasowy pierwszej próbki w milisekundach (uint32_t),
+ *	- próbki: przyrost czasu względem poprzedniej próbki w ms (uint16_t), ir (uint16_t), red (uint16_t).
+ */
+class SensorFrame {
+	quint32 seq = 0;
+	bool sequenced = false;
+	std::vector<SensorData> samples;
+	qint64 receivedNs = 0;
+
+public:
+	static constexpr quint8 VERSION = 1;			/**< Obsługiwana wersja ramki binarnej. */
+	static constexpr int HEADER_SIZE = 14;			/**< Rozmiar nagłówka ramki binarnej w bajtach. */
+	static constexpr int SAMPLE_SIZE = 6;			/**< Rozmiar próbki w ramce binarnej w bajtach. */
+
+	/**
+	 * Domyślny konstruktor.
+	 */
+	SensorFrame() {}
+
+	/**
+	 * Konstruktor inicjalizujący paczkę z numerami sekwencyjnymi.
+	 * @param seq_ Numer sekwencyjny pierwszej próbki.
+	 * @param samples_ Próbki uporządkowane rosnąco według stempli czasowych.
+	 */
+	SensorFrame(quint32 seq_, std::vector<SensorData> samples_) :
+		seq(seq_), sequenced(true), samples(std::move(samples_))
+	{}
+
+	/**
+	 * Dekoduje ramkę binarną.
+	 * @param bytes Odebrane bajty.
+	 * @param frame Obiekt do którego zapisywany jest wynik.
+	 * @return true jeżeli ramka jest poprawna.
+	 * @return false jeżeli ramka jest uszkodzona lub w nieobsługiwanej wersji.
+	 */
+	static bool fromBinary(const QByteArray & bytes, SensorFrame & frame);
+
+	/**
+	 * Koduje paczkę do postaci ramki binarnej.
+	 * Wartości próbek obcinane są do zakresu uint16_t, paczka nie może zawierać więcej niż 65535 próbek,
+	 * a odstęp pomiędzy kolejnymi próbkami nie może przekraczać 65535 ms.
+	 * @return Ramka binarna.
+	 */
+	QByteArray toBinary() const;
+
+	/**
+	 * Dekoduje paczkę w formacie JSON (tablica obiektów z polami seq, ms, ir, red).
+	 * Pole seq jest opcjonalne, starsze oprogramowanie modułu go nie wysyła.
+	 * Próbki sortowane są według stempli czasowych, ponieważ bufor modułu jest cykliczny.
+	 * @param json Odebrany tekst.
+	 * @param frame Obiekt do którego zapisywany jest wynik.
+	 * @return true jeżeli paczka zawiera dane pomiarowe.
+	 * @return false jeżeli tekst nie jest poprawnym JSONem lub jest odpowiedzią statusową.
+	 */
+	static bool fromJson(const std::string & json, SensorFrame & frame);
+
+	/**
+	 * Getter.
+	 * @return Numer sekwencyjny pierwszej próbki.
+	 */
+	quint32 getSeq() const {
+		return seq;
+	}
+
+	/**
+	 * Metoda sprawdzająca czy próbki posiadają numery sekwencyjne.
+	 */
+	bool isSequenced() const {
+		return sequenced;
+	}
+
+	/**
+	 * Usuwa z początku paczki próbki o numerach sekwencyjnych mniejszych od podanego.
+	 * @param firstSeq Numer sekwencyjny pierwszej pozostawionej próbki.
+	 */
+	void trimBefore(quint32 firstSeq);
+
+	/**
+	 * Usuwa z początku paczki próbki o stemplach czasowych nie późniejszych od podanego.
+	 * @param ms Stempel czasowy w milisekundach zegara modułu.
+	 */
+	void trimNotLaterThan(qint64 ms);
+
+	/**
+	 * Getter.
+	 * @return Liczba próbek w paczce.
+	 */
+	size_t size() const {
+		return samples.size();
+	}
+
+	/**
+	 * Getter.
+	 * @return Próbki uporządkowane według stempli czasowych.
+	 */
+	const std::vector<SensorData> & getSamples() const {
+		return samples;
+	}
+
+	/**
+	 * Getter.
+	 * @return Chwila odebrania paczki (LatencyMonitor::nowNs), 0 jeżeli paczka nie pochodzi z modułu.
+	 */
+	qint64 getReceivedNs() const {
+		return receivedNs;
+	}
+
+	/**
+	 * Setter.
+	 * @param ns Chwila odebrania paczki, LatencyMonitor::nowNs.
+	 */
+	void setReceivedNs(qint64 ns) {
+		receivedNs = ns;
+	}
+
+	/**
+	 * Metoda sprawdzająca czy paczka jest pusta.
+	 */
+	bool empty() const {
+		return samples.empty();
+	}
+};
+
+Q_DECLARE_METATYPE(SensorFrame)
@@ -0,0 +1,483 @@
+#include "SessionArchive.h"
+
+#include <QDebug>
+#include <QtEndian>
+#include <algorithm>
+#include <cstring>
+
+using namespace SessionArchive;
+
+namespace {
+	const char MAGIC[] = { 'T', 'M', 'A', 'R', 'C' };
+	const char INDEX_MAGIC[] = { 'T', 'M', 'A', 'I' };
+	auto constexpr INDEX_ENTRY_SIZE = 40;
+	auto constexpr FOOTER_SIZE = 16;
+	auto constexpr MAX_BLOCK_SIZE = 64 * 1024 * 1024;
+
+	QByteArray fileHeader() {
+		QByteArray header(MAGIC, sizeof(MAGIC));
+		header.append(char(VERSION));
+		header.append(QByteArray(2, '\0'));
+		return header;
+	}
+
+	bool checkHeader(const QByteArray & header) {
+		if (header.size() != HEADER_SIZE || std::memcmp(header.constData(), MAGIC, sizeof(MAGIC)) != 0)
+			return false;
+		auto version = quint8(header[int(sizeof(MAGIC))]);
+		return version >= 1 && version <= VERSION;
+	}
+
+	void putVarint(QByteArray & out, quint64 value) {
+		while (value >= 0x80) {
+			out.append(char(value | 0x80));
+			value >>= 7;
+		}
+		out.append(char(value));
+	}
+
+	void putZigzag(QByteArray & out, qint64 value) {
+		putVarint(out, (quint64(value) << 1) ^ quint64(value >> 63));
+	}
+
+	void putDouble(QByteArray & out, double value) {
+		quint64 bits;
+		std::memcpy(&bits, &value, sizeof(bits));
+		char bytes[8];
+		qToLittleEndian<quint64>(bits, bytes);
+		out.append(bytes, 8);
+	}
+
+	/**
+	 * Dekoder zawartości bloku, po błędzie kolejne odczyty zwracają 0.
+	 */
+	class BlockDecoder {
+		const char * in;
+		const char * end;
+		bool failed = false;
+
+	public:
+		BlockDecoder(const QByteArray & payload) :
+			in(payload.constData()), end(payload.constData() + payload.size())
+		{}
+
+		quint64 varint() {
+			quint64 value = 0;
+			for (int shift = 0; shift < 64 && in < end; shift += 7) {
+				auto byte = quint8(*in++);
+				value |= quint64(byte & 0x7F) << shift;
+				if ((byte & 0x80) == 0)
+					return value;
+			}
+			failed = true;
+			in = end;
+			return 0;
+		}
+
+		qint64 zigzag() {
+			auto value = varint();
+			return qint64(value >> 1) ^ -qint64(value & 1);
+		}
+
+		double real() {
+			if (end - in < 8) {
+				failed = true;
+				in = end;
+				return 0.0;
+			}
+			auto bits = qFromLittleEndian<quint64>(in);
+			in += 8;
+			double value;
+			std::memcpy(&value, &bits, sizeof(value));
+			return value;
+		}
+
+		bool ok() const {
+			return !failed;
+		}
+	};
+
+	bool overlaps(const BlockInfo & block, Series series, qint64 fromMs, qint64 toMs) {
+		return block.series == series && block.lastMs >= fromMs && block.firstMs <= toMs;
+	}
+}
+
+bool SessionArchiveWriter::open(const QString & path) {
+	index.clear();
+	samples.clear();
+	beats.clear();
+	heartRatesRaw.clear();
+	heartRates.clear();
+	spo2.clear();
+	failed = false;
+	file.setFileName(path);
+	if (!file.open(QIODevice::WriteOnly)) {
+		qDebug() << "Cannot create" << path << file.errorString();
+		return false;
+	}
+	failed = file.write(fileHeader()) != HEADER_SIZE;
+	return !failed;
+}
+
+void SessionArchiveWriter::append(const SensorData & sample) {
+	samples.push_back(sample);
+	if (samples.size() == ARCHIVE_SAMPLES_PER_BLOCK)
+		flushSamples();
+}
+
+void SessionArchiveWriter::appendBeat(qint64 ms) {
+	beats.push_back(ms);
+	if (beats.size() == ARCHIVE_EVENTS_PER_BLOCK)
+		flushBeats();
+}
+
+void SessionArchiveWriter::appendHeartRate(const HeartRate & raw, const HeartRate & mean) {
+	heartRatesRaw.push_back(raw);
+	heartRates.push_back(mean);
+	if (heartRates.size() == ARCHIVE_EVENTS_PER_BLOCK)
+		flushHeartRates();
+}
+
+void SessionArchiveWriter::appendSpO2(const SpO2 & value) {
+	spo2.push_back(value);
+	if (spo2.size() == ARCHIVE_EVENTS_PER_BLOCK)
+		flushSpO2();
+}
+
+void SessionArchiveWriter::writeBlock(Series series, quint32 count, qint64 firstMs, qint64 lastMs,
+	const QByteArray & payload)
+{
+	auto compressed = qCompress(payload);
+	BlockInfo block = { series, count, firstMs, lastMs, file.pos(), quint32(compressed.size()) };
+	index.push_back(block);
+	if (!failed && file.write(compressed) != compressed.size())
+		failed = true;
+}
+
+void SessionArchiveWriter::flushSamples() {
+	if (samples.empty())
+		return;
+	// the columns are encoded one after another, so similar bytes end up next to each other
+	QByteArray payload;
+	payload.reserve(int(samples.size()) * 4);
+	auto prevMs = samples.front().getMs();
+	for (auto & sample : samples) {
+		putVarint(payload, quint64(sample.getMs() - prevMs));
+		prevMs = sample.getMs();
+	}
+	qint64 prev = 0;
+	for (auto & sample : samples) {
+		putZigzag(payload, sample.getIrLed() - prev);
+		prev = sample.getIrLed();
+	}
+	prev = 0;
+	for (auto & sample : samples) {
+		putZigzag(payload, sample.getRedLed() - prev);
+		prev = sample.getRedLed();
+	}
+	writeBlock(SAMPLES, quint32(samples.size()), samples.front().getMs(), samples.back().getMs(), payload);
+	samples.clear();
+}
+
+void SessionArchiveWriter::flushBeats() {
+	if (beats.empty())
+		return;
+	QByteArray payload;
+	auto prevMs = beats.front();
+	for (auto ms : beats) {
+		putVarint(payload, quint64(ms - prevMs));
+		prevMs = ms;
+	}
+	writeBlock(BEATS, quint32(beats.size()), beats.front(), beats.back(), payload);
+	beats.clear();
+}
+
+void SessionArchiveWriter::flushHeartRates() {
+	if (heartRates.empty())
+		return;
+	QByteArray payload;
+	auto prevMs = heartRatesRaw.front().getBeginMs();
+	for (auto & hr : heartRatesRaw) {
+		putVarint(payload, quint64(hr.getBeginMs() - prevMs));
+		prevMs = hr.getBeginMs();
+	}
+	for (auto & hr : heartRatesRaw)
+		putVarint(payload, quint64(hr.getEndMs() - hr.getBeginMs()));
+	for (auto & hr : heartRatesRaw)
+		putDouble(payload, hr.getHR());
+	for (auto & hr : heartRates)
+		putDouble(payload, hr.getHR());
+	writeBlock(HEART_RATES, quint32(heartRates.size()),
+		heartRatesRaw.front().getBeginMs(), heartRatesRaw.back().getBeginMs(), payload);
+	heartRatesRaw.clear();
+	heartRates.clear();
+}
+
+void SessionArchiveWriter::flushSpO2() {
+	if (spo2.empty())
+		return;
+	QByteArray payload;
+	auto prevMs = spo2.front().getMs();
+	for (auto & value : spo2) {
+		putVarint(payload, quint64(value.getMs() - prevMs));
+		prevMs = value.getMs();
+	}
+	for (auto & value : spo2)
+		putDouble(payload, value.getSpO2());
+	for (auto & value : spo2)
+		putDouble(payload, value.getRatio());
+	writeBlock(SPO2, quint32(spo2.size()), spo2.front().getMs(), spo2.back().getMs(), payload);
+	spo2.clear();
+}
+
+bool SessionArchiveWriter::commit() {
+	flushSamples();
+	flushBeats();
+	flushHeartRates();
+	flushSpO2();
+
+	auto indexOffset = file.pos();
+	QByteArray out(int(index.size()) * INDEX_ENTRY_SIZE + FOOTER_SIZE, '\0');
+	auto entry = out.data();
+	for (auto & block : index) {
+		qToLittleEndian<quint32>(block.series, entry);
+		qToLittleEndian<quint32>(block.count, entry + 4);
+		qToLittleEndian<qint64>(block.firstMs, entry + 8);
+		qToLittleEndian<qint64>(block.lastMs, entry + 16);
+		qToLittleEndian<qint64>(block.offset, entry + 24);
+		qToLittleEndian<quint32>(block.size, entry + 32);
+		entry += INDEX_ENTRY_SIZE;
+	}
+	qToLittleEndian<qint64>(indexOffset, entry);
+	qToLittleEndian<quint32>(quint32(index.size()), entry + 8);
+	std::memcpy(entry + 12, INDEX_MAGIC, sizeof(INDEX_MAGIC));
+	if (!failed && file.write(out) != out.size())
+		failed = true;
+
+	if (failed) {
+		qDebug() << "Cannot write" << file.fileName() << file.errorString();
+		cancel();
+		return false;
+	}
+	return file.commit();
+}
+
+void SessionArchiveWriter::cancel() {
+	file.cancelWriting();
+	file.commit();
+}
+
+bool SessionArchiveWriter::write(const DataSnapshot & snapshot, const QString & path) {
+	SessionArchiveWriter writer;
+	if (!writer.open(path))
+		return false;
+	snapshot.sensorData.forEach(0, snapshot.sensorData.size(), [&writer](qint64 ms, int ir, int red) {
+		writer.append(SensorData(ms, ir, red));
+	});
+	for (auto ms : snapshot.beats)
+		writer.appendBeat(ms);
+	auto count = std::min(snapshot.heartRateRaw.size(), snapshot.heartRate.size());
+	for (size_t i = 0; i < count; ++i)
+		writer.appendHeartRate(snapshot.heartRateRaw[i], snapshot.heartRate[i]);
+	for (auto & value : snapshot.spo2)
+		writer.appendSpO2(value);
+	return writer.commit();
+}
+
+bool SessionArchiveReader::open(const QString & path) {
+	index.clear();
+	if (file.isOpen())
+		file.close();
+	file.setFileName(path);
+	if (!file.open(QIODevice::ReadOnly))
+		return false;
+
+	auto size = file.size();
+	if (size < HEADER_SIZE + FOOTER_SIZE || !checkHeader(file.read(HEADER_SIZE))) {
+		qDebug() << "Not a session archive" << path;
+		file.close();
+		return false;
+	}
+	file.seek(size - FOOTER_SIZE);
+	auto footer = file.read(FOOTER_SIZE);
+	auto indexOffset = qFromLittleEndian<qint64>(footer.constData());
+	auto count = qFromLittleEndian<quint32>(footer.constData() + 8);
+	if (footer.size() != FOOTER_SIZE || std::memcmp(footer.constData() + 12, INDEX_MAGIC, sizeof(INDEX_MAGIC)) != 0
+		|| indexOffset < HEADER_SIZE || indexOffset + qint64(count) * INDEX_ENTRY_SIZE != size - FOOTER_SIZE)
+	{
+		qDebug() << "Session archive without a valid index" << path;
+		file.close();
+		return false;
+	}
+
+	file.seek(indexOffset);
+	auto entries = file.read(qint64(count) * INDEX_ENTRY_SIZE);
+	if (entries.size() != qint64(count) * INDEX_ENTRY_SIZE) {
+		file.close();
+		return false;
+	}
+	index.reserve(count);
+	for (auto entry = entries.constData(); entry != entries.constData() + entries.size(); entry += INDEX_ENTRY_SIZE) {
+		BlockInfo block;
+		block.series = Series(qFromLittleEndian<quint32>(entry));
+		block.count = qFromLittleEndian<quint32>(entry + 4);
+		block.firstMs = qFromLittleEndian<qint64>(entry + 8);
+		block.lastMs = qFromLittleEndian<qint64>(entry + 16);
+		block.offset = qFromLittleEndian<qint64>(entry + 24);
+		block.size = qFromLittleEndian<quint32>(entry + 32);
+		index.push_back(block);
+	}
+	return true;
+}
+
+quint64 SessionArchiveReader::count(Series series) const {
+	quint64 sum = 0;
+	for (auto & block : index) {
+		if (block.series == series)
+			sum += block.count;
+	}
+	return sum;
+}
+
+bool SessionArchiveReader::readBlock(const BlockInfo & block, QByteArray & payload) {
+	if (block.size > MAX_BLOCK_SIZE || !file.seek(block.offset))
+		return false;
+	payload = qUncompress(file.read(block.size));
+	if (payload.isEmpty()) {
+		qDebug() << "Corrupted block at" << block.offset << "in" << file.fileName();
+		return false;
+	}
+	return true;
+}
+
+bool SessionArchiveReader::readSamples(SensorDataStore & out, qint64 fromMs, qint64 toMs) {
+	QByteArray payload;
+	std::vector<qint64> ms;
+	std::vector<int> ir;
+	std::vector<int> red;
+	for (auto & block : index) {
+		if (!overlaps(block, SAMPLES, fromMs, toMs))
+			continue;
+		if (!readBlock(block, payload))
+			return false;
+
+		BlockDecoder in(payload);
+		ms.resize(block.count);
+		ir.resize(block.count);
+		red.resize(block.count);
+		auto prevMs = block.firstMs;
+		for (auto & value : ms)
+			value = prevMs += qint64(in.varint());
+		qint64 prev = 0;
+		for (auto & value : ir)
+			value = int(prev += in.zigzag());
+		prev = 0;
+		for (auto & value : red)
+			value = int(prev += in.zigzag());
+		if (!in.ok())
+			return false;
+
+		auto begin = std::lower_bound(ms.begin(), ms.end(), fromMs) - ms.begin();
+		auto end = std::upper_bound(ms.begin(), ms.end(), toMs) - ms.begin();
+		out.append(ms.data() + begin, ir.data() + begin, red.data() + begin, size_t(end - begin));
+	}
+	return true;
+}
+
+bool SessionArchiveReader::readBeats(std::vector<qint64> & out, qint64 fromMs, qint64 toMs) {
+	QByteArray payload;
+	for (auto & block : index) {
+		if (!overlaps(block, BEATS, fromMs, toMs))
+			continue;
+		if (!readBlock(block, payload))
+			return false;
+
+		BlockDecoder in(payload);
+		auto ms = block.firstMs;
+		for (quint32 i = 0; i < block.count; ++i) {
+			ms += qint64(in.varint());
+			if (ms >= fromMs && ms <= toMs)
+				out.push_back(ms);
+		}
+		if (!in.ok())
+			return false;
+	}
+	return true;
+}
+
+bool SessionArchiveReader::readHeartRates(std::vector<HeartRate> & raw, std::vector<HeartRate> & mean,
+	qint64 fromMs, qint64 toMs)
+{
+	QByteArray payload;
+	std::vector<qint64> begins;
+	std::vector<qint64> ends;
+	for (auto & block : index) {
+		if (!overlaps(block, HEART_RATES, fromMs, toMs))
+			continue;
+		if (!readBlock(block, payload))
+			return false;
+
+		BlockDecoder in(payload);
+		begins.resize(block.count);
+		ends.resize(block.count);
+		auto ms = block.firstMs;
+		for (auto & begin : begins)
+			begin = ms += qint64(in.varint());
+		for (quint32 i = 0; i < block.count; ++i)
+			ends[i] = begins[i] + qint64(in.varint());
+		for (quint32 i = 0; i < block.count; ++i) {
+			auto hr = in.real();
+			if (begins[i] >= fromMs && begins[i] <= toMs)
+				raw.emplace_back(begins[i], ends[i], hr);
+		}
+		for (quint32 i = 0; i < block.count; ++i) {
+			auto hr = in.real();
+			if (begins[i] >= fromMs && begins[i] <= toMs)
+				mean.emplace_back(begins[i], ends[i], hr);
+		}
+		if (!in.ok())
+			return false;
+	}
+	return true;
+}
+
+bool SessionArchiveReader::readSpO2(std::vector<SpO2> & out, qint64 fromMs, qint64 toMs) {
+	QByteArray payload;
+	std::vector<qint64> ms;
+	std::vector<double> values;
+	for (auto & block : index) {
+		if (!overlaps(block, SPO2, fromMs, toMs))
+			continue;
+		if (!readBlock(block, payload))
+			return false;
+
+		BlockDecoder in(payload);
+		ms.resize(block.count);
+		values.resize(block.count);
+		auto prevMs = block.firstMs;
+		for (auto & value : ms)
+			value = prevMs += qint64(in.varint());
+		for (auto & value : values)
+			value = in.real();
+		for (quint32 i = 0; i < block.count; ++i) {
+			auto ratio = in.real();
+			if (ms[i] >= fromMs && ms[i] <= toMs)
+				out.emplace_back(ms[i], ratio, values[i]);
+		}
+		if (!in.ok())
+			return false;
+	}
+	return true;
+}
+
+bool SessionArchiveReader::read(DataSnapshot & snapshot) {
+	snapshot = DataSnapshot();
+	snapshot.beats.reserve(count(BEATS));
+	snapshot.heartRateRaw.reserve(count(HEART_RATES));
+	snapshot.heartRate.reserve(count(HEART_RATES));
+	snapshot.spo2.reserve(count(SPO2));
+	return readSamples(snapshot.sensorData)
+		&& readBeats(snapshot.beats)
+		&& readHeartRates(snapshot.heartRateRaw, snapshot.heartRate)
+		&& readSpO2(snapshot.spo2);
+}
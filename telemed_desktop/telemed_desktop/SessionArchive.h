@@ -0,0 +1,226 @@
+#pragma once
+#include <QFile>
+#include <QSaveFile>
+#include <QString>
+#include <limits>
+#include <vector>
+#include "DataSnapshot.h"
+#include "HeartRate.h"
+#include "SensorData.h"
+#include "SensorDataStore.h"
+#include "SpO2.h"
+
+auto constexpr ARCHIVE_SAMPLES_PER_BLOCK = 4096;	/**< Liczba próbek w bloku archiwum. */
+auto constexpr ARCHIVE_EVENTS_PER_BLOCK = 1024;		/**< Liczba uderzeń serca, wartości pulsu lub saturacji w bloku archiwum. */
+
+/**
+ * Archiwum sesji pomiarowej do długotrwałego przechowywania.
+ *
+ * Serie (próbki, uderzenia serca, wartości pulsu, saturacja) zapisywane są kolumnowo w blokach kompresowanych
+ * przez qCompress. Przed kompresją stemple czasowe kodowane są jako różnice względem poprzedniego
+ * stempla, a wartości diod jako różnice względem poprzedniej wartości w kodowaniu zigzag,
+ * wszystkie jako liczby o zmiennej długości (varint, 7 bitów na bajt).
+ *
+ * Format pliku (little-endian):
+ *	- nagłówek: 'T', 'M', 'A', 'R', 'C', wersja (uint8_t), 2 zarezerwowane bajty,
+ *	- bloki, zawartość przed kompresją:
+ *	  próbki: różnice stempli (varint[n]), różnice diody podczerwonej (zigzag varint[n]),
+ *	  różnice diody czerwonej (zigzag varint[n]),
+ *	  uderzenia: różnice stempli (varint[n]),
+ *	  puls: różnice początków okresów (varint[n]), długości okresów (varint[n]),
+ *	  puls nieuśredniony (double[n]), średnia obcięta (double[n]),
+ *	  saturacja (od wersji 2): różnice stempli (varint[n]), saturacja (double[n]), stosunek R (double[n]),
+ *	  pierwsza różnica w bloku liczona jest względem stempla firstMs z indeksu,
+ *	- indeks bloków: dla każdego bloku seria (uint32_t), liczba elementów (uint32_t), stempel
+ *	  pierwszego i ostatniego elementu (int64_t), położenie bloku w pliku (int64_t), rozmiar bloku (uint32_t),
+ *	  zarezerwowane pole (uint32_t),
+ *	- stopka: położenie indeksu (int64_t), liczba bloków (uint32_t), 'T', 'M', 'A', 'I'.
+ *
+ * Indeks pozwala odczytać wybrany zakres czasu bez dekompresji pozostałych bloków.
+ */
+namespace SessionArchive {
+	/**
+	 * Serie danych zapisywane w archiwum.
+	 */
+	enum Series : quint32 {
+		SAMPLES = 1,
+		BEATS = 2,
+		HEART_RATES = 3,
+		SPO2 = 4
+	};
+
+	/**
+	 * Pozycja indeksu bloków.
+	 */
+	struct BlockInfo {
+		Series series;		/**< Seria zapisana w bloku. */
+		quint32 count;		/**< Liczba elementów w bloku. */
+		qint64 firstMs;		/**< Stempel czasowy pierwszego elementu. */
+		qint64 lastMs;		/**< Stempel czasowy ostatniego elementu. */
+		qint64 offset;		/**< Położenie bloku w pliku. */
+		quint32 size;		/**< Rozmiar skompresowanego bloku w bajtach. */
+	};
+
+	auto constexpr VERSION = quint8(2);		/**< Wersja formatu pliku, odczytywane są również wcześniejsze wersje. */
+	auto constexpr HEADER_SIZE = 8;			/**< Rozmiar nagłówka pliku w bajtach. */
+}
+
+/**
+ * Zapis archiwum sesji.
+ * Elementy każdej serii dopisywane są w kolejności rosnących stempli czasowych, pełne bloki
+ * zapisywane są od razu, więc w pamięci przechowywany jest co najwyżej jeden blok każdej serii.
+ * Archiwum zapisywane jest przez QSaveFile, więc przerwany zapis nie pozostawia niepełnego pliku.
+ */
+class SessionArchiveWriter {
+	QSaveFile file;
+	std::vector<SessionArchive::BlockInfo> index;
+	std::vector<SensorData> samples;
+	std::vector<qint64> beats;
+	std::vector<HeartRate> heartRatesRaw;
+	std::vector<HeartRate> heartRates;
+	std::vector<SpO2> spo2;
+	bool failed = false;
+
+	void writeBlock(SessionArchive::Series series, quint32 count, qint64 firstMs, qint64 lastMs,
+		const QByteArray & payload);
+	void flushSamples();
+	void flushBeats();
+	void flushHeartRates();
+	void flushSpO2();
+
+public:
+	/**
+	 * Tworzy archiwum.
+	 * @param path Ścieżka do pliku.
+	 * @return false jeżeli pliku nie można utworzyć.
+	 */
+	bool open(const QString & path);
+
+	/**
+	 * Dopisuje próbkę.
+	 * @param sample Próbka, stempel czasowy w milisekundach od początku epoki.
+	 */
+	void append(const SensorData & sample);
+
+	/**
+	 * Dopisuje uderzenie serca.
+	 * @param ms Stempel czasowy uderzenia w milisekundach od początku epoki.
+	 */
+	void appendBeat(qint64 ms);
+
+	/**
+	 * Dopisuje wartość pulsu.
+	 * @param raw Puls nieuśredniony.
+	 * @param mean Średnia obcięta pulsu dla tego samego okresu.
+	 */
+	void appendHeartRate(const HeartRate & raw, const HeartRate & mean);
+
+	/**
+	 * Dopisuje oszacowanie saturacji.
+	 * @param value Oszacowanie saturacji.
+	 */
+	void appendSpO2(const SpO2 & value);
+
+	/**
+	 * Zapisuje niepełne bloki oraz indeks i zastępuje nimi plik docelowy.
+	 * @return false jeżeli którykolwiek zapis się nie powiódł.
+	 */
+	bool commit();
+
+	/**
+	 * Porzuca archiwum, plik docelowy pozostaje niezmieniony.
+	 */
+	void cancel();
+
+	/**
+	 * Zapisuje migawkę danych do archiwum.
+	 * @param snapshot Migawka danych.
+	 * @param path Ścieżka do pliku.
+	 * @return false jeżeli zapis się nie powiódł.
+	 */
+	static bool write(const DataSnapshot & snapshot, const QString & path);
+};
+
+/**
+ * Odczyt archiwum zapisanego przez SessionArchiveWriter.
+ * Po otwarciu w pamięci przechowywany jest wyłącznie indeks bloków, dekompresowane są tylko bloki
+ * z żądanego zakresu czasu.
+ */
+class SessionArchiveReader {
+	QFile file;
+	std::vector<SessionArchive::BlockInfo> index;
+
+	bool readBlock(const SessionArchive::BlockInfo & block, QByteArray & payload);
+
+public:
+	/**
+	 * Otwiera archiwum i odczytuje indeks bloków.
+	 * @param path Ścieżka do pliku.
+	 * @return false jeżeli pliku nie można otworzyć lub nie jest plikiem w tym formacie.
+	 */
+	bool open(const QString & path);
+
+	/**
+	 * Getter.
+	 * @return Indeks bloków uporządkowany według położenia w pliku.
+	 */
+	const std::vector<SessionArchive::BlockInfo> & blocks() const {
+		return index;
+	}
+
+	/**
+	 * Getter.
+	 * @param series Seria danych.
+	 * @return Liczba elementów serii w archiwum.
+	 */
+	quint64 count(SessionArchive::Series series) const;
+
+	/**
+	 * Odczytuje próbki z zakresu czasu [fromMs, toMs].
+	 * @param out Magazyn, do którego dopisywane są próbki.
+	 * @param fromMs Początek zakresu w milisekundach od początku epoki.
+	 * @param toMs Koniec zakresu w milisekundach od początku epoki.
+	 * @return false jeżeli blok jest uszkodzony.
+	 */
+	bool readSamples(SensorDataStore & out,
+		qint64 fromMs = std::numeric_limits<qint64>::min(), qint64 toMs = std::numeric_limits<qint64>::max());
+
+	/**
+	 * Odczytuje uderzenia serca z zakresu czasu [fromMs, toMs].
+	 * @param out Wektor, do którego dopisywane są stemple czasowe uderzeń.
+	 * @param fromMs Początek zakresu w milisekundach od początku epoki.
+	 * @param toMs Koniec zakresu w milisekundach od początku epoki.
+	 * @return false jeżeli blok jest uszkodzony.
+	 */
+	bool readBeats(std::vector<qint64> & out,
+		qint64 fromMs = std::numeric_limits<qint64>::min(), qint64 toMs = std::numeric_limits<qint64>::max());
+
+	/**
+	 * Odczytuje wartości pulsu, których okres rozpoczyna się w zakresie czasu [fromMs, toMs].
+	 * @param raw Wektor, do którego dopisywane są nieuśrednione wartości pulsu.
+	 * @param mean Wektor, do którego dopisywane są średnie obcięte pulsu.
+	 * @param fromMs Początek zakresu w milisekundach od początku epoki.
+	 * @param toMs Koniec zakresu w milisekundach od początku epoki.
+	 * @return false jeżeli blok jest uszkodzony.
+	 */
+	bool readHeartRates(std::vector<HeartRate> & raw, std::vector<HeartRate> & mean,
+		qint64 fromMs = std::numeric_limits<qint64>::min(), qint64 toMs = std::numeric_limits<qint64>::max());
+
+	/**
+	 * Odczytuje oszacowania saturacji z zakresu czasu [fromMs, toMs].
+	 * Archiwa w wersji 1 nie zawierają saturacji.
+	 * @param out Wektor, do którego dopisywane są oszacowania saturacji.
+	 * @param fromMs Początek zakresu w milisekundach od początku epoki.
+	 * @param toMs Koniec zakresu w milisekundach od początku epoki.
+	 * @return false jeżeli blok jest uszkodzony.
+	 */
+	bool readSpO2(std::vector<SpO2> & out,
+		qint64 fromMs = std::numeric_limits<qint64>::min(), qint64 toMs = std::numeric_limits<qint64>::max());
+
+	/**
+	 * Odczytuje całe archiwum.
+	 * @param snapshot Migawka, do której odczytywane są dane.
+	 * @return false jeżeli blok jest uszkodzony.
+	 */
+	bool read(DataSnapshot & snapshot);
+};
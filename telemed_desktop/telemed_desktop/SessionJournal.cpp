@@ -0,0 +1,329 @@
+#include "SessionJournal.h"
+
+#include <QDebug>
+#include <QSaveFile>
+#include <QtEndian>
+#include <cstring>
+#include "Crc32.h"
+
+#ifdef Q_OS_WIN
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+namespace {
+	const char MAGIC[] = { 'T', 'M', 'J', 'R', 'N', 'L' };
+	const char BLOCK_MAGIC[] = { 'T', 'M', 'J', 'B' };
+	const char INDEX_MAGIC[] = { 'T', 'M', 'J', 'I', 'D', 'X' };
+	auto constexpr BLOCK_HEADER_SIZE = 24;
+	auto constexpr SAMPLE_SIZE = 16;		// ms, ir, red
+	auto constexpr BEAT_SIZE = 8;
+	auto constexpr HEART_RATE_SIZE = 24;	// begin, end, trimmed mean
+	auto constexpr SPO2_SIZE = 24;			// ms, ratio, SpO2
+	auto constexpr INDEX_SIZE = 56;
+
+	QByteArray fileHeader(const char (&magic)[6]) {
+		QByteArray header(magic, sizeof(magic));
+		header.append(char(SessionJournalWriter::VERSION));
+		header.append('\0');
+		return header;
+	}
+
+	/**
+	 * Sprawdza nagłówek pliku, akceptując również starsze wersje formatu.
+	 */
+	bool checkHeader(const char * data, const char (&magic)[6]) {
+		auto version = quint8(data[sizeof(magic)]);
+		return std::memcmp(data, magic, sizeof(magic)) == 0 && version >= 1 && version <= SessionJournalWriter::VERSION;
+	}
+
+	qint64 payloadSize(quint32 samples, quint32 beats, quint32 heartRates, quint32 spo2) {
+		return qint64(samples) * SAMPLE_SIZE + qint64(beats) * BEAT_SIZE + qint64(heartRates) * HEART_RATE_SIZE
+			+ qint64(spo2) * SPO2_SIZE;
+	}
+
+	void putDouble(double value, char * out) {
+		quint64 bits;
+		std::memcpy(&bits, &value, sizeof(bits));
+		qToLittleEndian<quint64>(bits, out);
+	}
+
+	double getDouble(const char * in) {
+		auto bits = qFromLittleEndian<quint64>(in);
+		double value;
+		std::memcpy(&value, &bits, sizeof(value));
+		return value;
+	}
+
+	bool syncToDisk(QFile & file) {
+		if (!file.flush())
+			return false;
+#ifdef Q_OS_WIN
+		return _commit(file.handle()) == 0;
+#else
+		return ::fsync(file.handle()) == 0;
+#endif
+	}
+
+	/**
+	 * Odczytuje indeks dziennika.
+	 * @return Rozmiar utrwalonej części dziennika lub HEADER_SIZE, jeżeli indeksu brak lub jest niepoprawny.
+	 */
+	qint64 readIndex(const QString & path, qint64 journalSize, SessionJournalContents & contents) {
+		QFile file(SessionJournalWriter::indexPath(path));
+		if (!file.open(QIODevice::ReadOnly))
+			return SessionJournalWriter::HEADER_SIZE;
+		auto index = file.read(INDEX_SIZE);
+		if (index.size() != INDEX_SIZE || index.left(SessionJournalWriter::HEADER_SIZE) != fileHeader(INDEX_MAGIC))
+			return SessionJournalWriter::HEADER_SIZE;
+
+		auto in = index.constData() + SessionJournalWriter::HEADER_SIZE;
+		auto syncedSize = qFromLittleEndian<qint64>(in);
+		if (syncedSize < SessionJournalWriter::HEADER_SIZE || syncedSize > journalSize)
+			return SessionJournalWriter::HEADER_SIZE;
+		// the counts let the vectors allocate once
+		auto beats = qFromLittleEndian<quint64>(in + 24);
+		auto heartRates = qFromLittleEndian<quint64>(in + 32);
+		auto spo2 = qFromLittleEndian<quint64>(in + 40);
+		if (beats > quint64(journalSize) || heartRates > quint64(journalSize) || spo2 > quint64(journalSize))
+			return SessionJournalWriter::HEADER_SIZE;
+		contents.beats.reserve(beats);
+		contents.heartRateRaw.reserve(heartRates);
+		contents.heartRate.reserve(heartRates);
+		contents.spo2.reserve(spo2);
+		return syncedSize;
+	}
+}
+
+SessionJournalWriter::~SessionJournalWriter() {
+	close();
+}
+
+bool SessionJournalWriter::create(const QString & path) {
+	close();
+	failed = false;
+	blockCount = sampleCount = beatCount = heartRateCount = spo2Count = 0;
+	file.setFileName(path);
+	if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+		qDebug() << "Cannot create journal" << path << file.errorString();
+		return false;
+	}
+	if (file.write(fileHeader(MAGIC)) != HEADER_SIZE) {
+		file.close();
+		return false;
+	}
+	return sync();
+}
+
+bool SessionJournalWriter::resume(const QString & path, const SessionJournalContents & contents) {
+	close();
+	failed = false;
+	blockCount = 0;
+	sampleCount = contents.sensorData.size();
+	beatCount = contents.beats.size();
+	heartRateCount = contents.heartRate.size();
+	spo2Count = contents.spo2.size();
+	file.setFileName(path);
+	if (contents.validSize < HEADER_SIZE || !file.open(QIODevice::ReadWrite)) {
+		qDebug() << "Cannot open journal" << path << file.errorString();
+		return false;
+	}
+	// drops a block torn by the crash, new blocks must follow the last valid one
+	if (!file.resize(contents.validSize) || !file.seek(contents.validSize)) {
+		file.close();
+		return false;
+	}
+	return sync();
+}
+
+bool SessionJournalWriter::append(const ProcessedBatch & batch) {
+	if (!file.isOpen() || failed)
+		return false;
+
+	auto samples = quint32(batch.samples.size());
+	auto beats = quint32(batch.beats.size());
+	auto heartRates = quint32(batch.heartRates.size());
+	auto spo2 = quint32(batch.spo2.size());
+	if (samples == 0 && beats == 0 && heartRates == 0 && spo2 == 0)
+		return true;
+
+	QByteArray block(BLOCK_HEADER_SIZE + payloadSize(samples, beats, heartRates, spo2), '\0');
+	auto payload = block.data() + BLOCK_HEADER_SIZE;
+	auto out = payload;
+	for (auto & row : batch.samples) {
+		qToLittleEndian<qint64>(row.getMs(), out);
+		out += 8;
+	}
+	for (auto & row : batch.samples) {
+		qToLittleEndian<qint32>(row.getIrLed(), out);
+		out += 4;
+	}
+	for (auto & row : batch.samples) {
+		qToLittleEndian<qint32>(row.getRedLed(), out);
+		out += 4;
+	}
+	for (auto ms : batch.beats) {
+		qToLittleEndian<qint64>(ms, out);
+		out += 8;
+	}
+	for (auto & hr : batch.heartRates) {
+		qToLittleEndian<qint64>(hr.getBeginMs(), out);
+		qToLittleEndian<qint64>(hr.getEndMs(), out + 8);
+		putDouble(hr.getHR(), out + 16);
+		out += HEART_RATE_SIZE;
+	}
+	for (auto & value : batch.spo2) {
+		qToLittleEndian<qint64>(value.getMs(), out);
+		putDouble(value.getRatio(), out + 8);
+		putDouble(value.getSpO2(), out + 16);
+		out += SPO2_SIZE;
+	}
+
+	auto header = block.data();
+	std::memcpy(header, BLOCK_MAGIC, sizeof(BLOCK_MAGIC));
+	qToLittleEndian<quint32>(samples, header + 4);
+	qToLittleEndian<quint32>(beats, header + 8);
+	qToLittleEndian<quint32>(heartRates, header + 12);
+	qToLittleEndian<quint32>(crc32(0, payload, size_t(out - payload)), header + 16);
+	qToLittleEndian<quint32>(spo2, header + 20);
+
+	// handed to the OS after every block, so only a power loss may cost the data since the last sync
+	if (file.write(block) != block.size() || !file.flush()) {
+		qDebug() << "Cannot write journal" << file.fileName() << file.errorString();
+		failed = true;
+		return false;
+	}
+	++blockCount;
+	sampleCount += samples;
+	beatCount += beats;
+	heartRateCount += heartRates;
+	spo2Count += spo2;
+
+	if (sinceSync.elapsed() >= syncInterval)
+		return sync();
+	return true;
+}
+
+bool SessionJournalWriter::sync() {
+	if (!file.isOpen() || failed)
+		return false;
+	sinceSync.start();
+	// the index may only point at data which is already on the disk
+	if (!syncToDisk(file) || !writeIndex()) {
+		qDebug() << "Cannot sync journal" << file.fileName() << file.errorString();
+		failed = true;
+		return false;
+	}
+	return true;
+}
+
+bool SessionJournalWriter::writeIndex() {
+	QByteArray index(INDEX_SIZE, '\0');
+	auto header = fileHeader(INDEX_MAGIC);
+	std::memcpy(index.data(), header.constData(), HEADER_SIZE);
+	auto out = index.data() + HEADER_SIZE;
+	qToLittleEndian<qint64>(file.pos(), out);
+	qToLittleEndian<quint64>(blockCount, out + 8);
+	qToLittleEndian<quint64>(sampleCount, out + 16);
+	qToLittleEndian<quint64>(beatCount, out + 24);
+	qToLittleEndian<quint64>(heartRateCount, out + 32);
+	qToLittleEndian<quint64>(spo2Count, out + 40);
+
+	QSaveFile indexFile(indexPath(file.fileName()));
+	if (!indexFile.open(QIODevice::WriteOnly))
+		return false;
+	if (indexFile.write(index) != index.size()) {
+		indexFile.cancelWriting();
+		indexFile.commit();
+		return false;
+	}
+	return indexFile.commit();
+}
+
+void SessionJournalWriter::close() {
+	if (!file.isOpen())
+		return;
+	if (!failed)
+		sync();
+	file.close();
+}
+
+QString SessionJournalWriter::indexPath(const QString & path) {
+	return path + ".idx";
+}
+
+bool SessionJournalReader::read(const QString & path, SessionJournalContents & contents) {
+	contents = SessionJournalContents();
+	QFile file(path);
+	if (!file.open(QIODevice::ReadOnly))
+		return false;
+	auto size = file.size();
+	if (size < SessionJournalWriter::HEADER_SIZE)
+		return false;
+
+	// the mapping is released when the file is closed
+	QByteArray buffer;
+	auto data = reinterpret_cast<const char *>(file.map(0, size));
+	if (data == nullptr) {
+		buffer = file.readAll();
+		data = buffer.constData();
+		size = buffer.size();
+	}
+	if (!checkHeader(data, MAGIC)) {
+		qDebug() << "Not a session journal" << path;
+		return false;
+	}
+
+	auto synced = readIndex(path, size, contents);
+	qint64 offset = SessionJournalWriter::HEADER_SIZE;
+	while (offset + BLOCK_HEADER_SIZE <= size) {
+		auto header = data + offset;
+		if (std::memcmp(header, BLOCK_MAGIC, sizeof(BLOCK_MAGIC)) != 0)
+			break;
+		auto samples = qFromLittleEndian<quint32>(header + 4);
+		auto beats = qFromLittleEndian<quint32>(header + 8);
+		auto heartRates = qFromLittleEndian<quint32>(header + 12);
+		auto crc = qFromLittleEndian<quint32>(header + 16);
+		auto spo2 = qFromLittleEndian<quint32>(header + 20);
+		auto payload = payloadSize(samples, beats, heartRates, spo2);
+		auto end = offset + BLOCK_HEADER_SIZE + payload;
+		if (end > size)
+			break;
+		auto in = header + BLOCK_HEADER_SIZE;
+		if (end > synced && crc32(0, in, size_t(payload)) != crc)
+			break;
+
+		auto ms = in;
+		auto ir = ms + qint64(samples) * 8;
+		auto red = ir + qint64(samples) * 4;
+#if Q_BYTE_ORDER == Q_LITTLE_ENDIAN
+		// every column starts at a multiple of its element size, so the mapped file is read in place
+		contents.sensorData.append(reinterpret_cast<const qint64 *>(ms),
+			reinterpret_cast<const qint32 *>(ir), reinterpret_cast<const qint32 *>(red), samples);
+#else
+		for (quint32 i = 0; i < samples; ++i) {
+			contents.sensorData.append(
+				qFromLittleEndian<qint64>(ms + qint64(i) * 8),
+				qFromLittleEndian<qint32>(ir + qint64(i) * 4),
+				qFromLittleEndian<qint32>(red + qint64(i) * 4));
+		}
+#endif
+		in = red + qint64(samples) * 4;
+		for (quint32 i = 0; i < beats; ++i, in += BEAT_SIZE)
+			contents.beats.push_back(qFromLittleEndian<qint64>(in));
+		for (quint32 i = 0; i < heartRates; ++i, in += HEART_RATE_SIZE) {
+			auto begin = qFromLittleEndian<qint64>(in);
+			auto hrEnd = qFromLittleEndian<qint64>(in + 8);
+			contents.heartRateRaw.emplace_back(begin, hrEnd);
+			contents.heartRate.emplace_back(begin, hrEnd, getDouble(in + 16));
+		}
+		for (quint32 i = 0; i < spo2; ++i, in += SPO2_SIZE)
+			contents.spo2.emplace_back(qFromLittleEndian<qint64>(in), getDouble(in + 8), getDouble(in + 16));
+		offset = end;
+	}
+	contents.validSize = offset;
+	if (offset < size)
+		qDebug() << "Journal" << path << "truncated at" << offset << "of" << size << "bytes";
+	return true;
+}
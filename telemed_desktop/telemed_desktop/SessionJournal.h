@@ -0,0 +1,148 @@
+#pragma once
+#include <QElapsedTimer>
+#include <QFile>
+#include <QString>
+#include <vector>
+#include "HeartRate.h"
+#include "SensorDataStore.h"
+#include "SignalPipeline.h"
+#include "SpO2.h"
+
+auto constexpr JOURNAL_SYNC_INTERVAL = 5000;	/**< Domyślny okres utrwalania dziennika na dysku w milisekundach. */
+
+/**
+ * Dane sesji odczytane z dziennika.
+ */
+struct SessionJournalContents {
+	SensorDataStore sensorData;				/**< Próbki. */
+	std::vector<qint64> beats;				/**< Stemple czasowe uderzeń serca. */
+	std::vector<HeartRate> heartRateRaw;	/**< Nieuśrednione wartości pulsu. */
+	std::vector<HeartRate> heartRate;		/**< Uśrednione wartości pulsu. */
+	std::vector<SpO2> spo2;					/**< Oszacowania saturacji. */
+	qint64 validSize = 0;					/**< Rozmiar poprawnej części pliku w bajtach. */
+};
+
+/**
+ * Dziennik sesji pomiarowej dopisywany na bieżąco, chroniący dane przed utratą przy awarii programu.
+ *
+ * Format pliku (little-endian):
+ *	- nagłówek: 'T', 'M', 'J', 'R', 'N', 'L', wersja (uint8_t), zarezerwowany bajt,
+ *	- bloki, po jednym na przetworzoną paczkę:
+ *	  nagłówek bloku: 'T', 'M', 'J', 'B', liczba próbek n, liczba uderzeń b, liczba wartości pulsu h,
+ *	  suma kontrolna CRC-32 zawartości, liczba oszacowań saturacji s (uint32_t każde),
+ *	  zawartość: stemple czasowe próbek (int64_t[n]), wartości diody podczerwonej (int32_t[n]),
+ *	  wartości diody czerwonej (int32_t[n]), stemple uderzeń (int64_t[b]),
+ *	  wartości pulsu (int64_t początek, int64_t koniec, double średnia obcięta)[h],
+ *	  oszacowania saturacji (int64_t stempel czasowy, double stosunek R, double SpO2)[s].
+ *	  Nieuśredniony puls wyznaczany jest z początku i końca okresu.
+ *	  W wersji 1 liczba oszacowań saturacji była zarezerwowanym polem równym zero.
+ *
+ * Po każdym bloku dane przekazywane są do systemu operacyjnego, co JOURNAL_SYNC_INTERVAL
+ * plik utrwalany jest na dysku (fsync) i zapisywany jest indeks w pliku <dziennik>.idx.
+ * Indeks zawiera rozmiar utrwalonej części dziennika i liczby zapisanych elementów.
+ */
+class SessionJournalWriter {
+	QFile file;
+	QElapsedTimer sinceSync;
+	int syncInterval = JOURNAL_SYNC_INTERVAL;
+	bool failed = false;
+	quint64 blockCount = 0;
+	quint64 sampleCount = 0;
+	quint64 beatCount = 0;
+	quint64 heartRateCount = 0;
+	quint64 spo2Count = 0;
+
+	bool writeIndex();
+
+public:
+	static constexpr quint8 VERSION = 2;		/**< Wersja formatu pliku. */
+	static constexpr int HEADER_SIZE = 8;		/**< Rozmiar nagłówka pliku w bajtach. */
+
+	/**
+	 * Destruktor, utrwala i zamyka plik.
+	 */
+	~SessionJournalWriter();
+
+	/**
+	 * Tworzy nowy, pusty dziennik. Istniejący plik jest nadpisywany.
+	 * @param path Ścieżka do pliku.
+	 * @return false jeżeli pliku nie można utworzyć.
+	 */
+	bool create(const QString & path);
+
+	/**
+	 * Otwiera istniejący dziennik do dopisywania, np. po odczytaniu go przez SessionJournalReader.
+	 * Niepoprawna końcówka pliku (np. niepełny blok zapisany przed awarią) jest usuwana.
+	 * @param path Ścieżka do pliku.
+	 * @param contents Dane odczytane z dziennika.
+	 * @return false jeżeli pliku nie można otworzyć.
+	 */
+	bool resume(const QString & path, const SessionJournalContents & contents);
+
+	/**
+	 * Dopisuje blok z przetworzoną paczką, utrwalając plik, jeżeli od ostatniego utrwalenia
+	 * minął okres utrwalania.
+	 * @param batch Próbki, uderzenia serca, wartości pulsu i saturacji dopisane do magazynów sesji.
+	 * @return false jeżeli zapis się nie powiódł.
+	 */
+	bool append(const ProcessedBatch & batch);
+
+	/**
+	 * Utrwala plik na dysku i zapisuje indeks.
+	 * @return false jeżeli zapis się nie powiódł.
+	 */
+	bool sync();
+
+	/**
+	 * Utrwala i zamyka plik.
+	 */
+	void close();
+
+	/**
+	 * Setter.
+	 * @param ms Okres utrwalania dziennika na dysku w milisekundach.
+	 */
+	void setSyncInterval(int ms) {
+		syncInterval = ms;
+	}
+
+	/**
+	 * Metoda sprawdzająca czy plik jest otwarty.
+	 */
+	bool isOpen() const {
+		return file.isOpen();
+	}
+
+	/**
+	 * Getter.
+	 * @return Ścieżka do pliku dziennika.
+	 */
+	QString fileName() const {
+		return file.fileName();
+	}
+
+	/**
+	 * Getter.
+	 * @param path Ścieżka do pliku dziennika.
+	 * @return Ścieżka do pliku indeksu.
+	 */
+	static QString indexPath(const QString & path);
+};
+
+/**
+ * Odczyt dziennika zapisanego przez SessionJournalWriter.
+ * Plik odwzorowywany jest w pamięci, a część utrwalona według indeksu nie jest ponownie weryfikowana,
+ * dzięki czemu odczyt wielogodzinnej sesji trwa milisekundy.
+ * Sumy kontrolne sprawdzane są wyłącznie dla bloków zapisanych po ostatnim utrwaleniu,
+ * odczyt kończy się na pierwszym niepełnym lub uszkodzonym bloku.
+ */
+class SessionJournalReader {
+public:
+	/**
+	 * Odczytuje dziennik.
+	 * @param path Ścieżka do pliku.
+	 * @param contents Odczytane dane.
+	 * @return false jeżeli pliku nie można otworzyć lub nie jest plikiem w tym formacie.
+	 */
+	static bool read(const QString & path, SessionJournalContents & contents);
+};
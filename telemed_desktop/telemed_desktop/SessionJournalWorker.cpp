@@ -0,0 +1,73 @@
+#include "SessionJournalWorker.h"
+
+#include <QFile>
+
+SessionJournalWorker::SessionJournalWorker(QObject * parent)
+	: QObject(parent),
+	strand(&pool)
+{
+	pool.setMaxThreadCount(1);
+}
+
+SessionJournalWorker::~SessionJournalWorker() {
+	strand.drain();
+	strand.close();
+}
+
+void SessionJournalWorker::check(bool ok) {
+	if (ok || reported)
+		return;
+	reported = true;
+	emit failed();
+}
+
+void SessionJournalWorker::create(const QString & path_, ProcessedBatch initial) {
+	path = path_;
+	strand.post([this, path_, initial] {
+		reported = false;
+		auto ok = writer.create(path_);
+		if (ok && !(initial.samples.empty() && initial.beats.empty() && initial.heartRates.empty() && initial.spo2.empty()))
+			ok = writer.append(initial) && writer.sync();
+		check(ok);
+	});
+}
+
+bool SessionJournalWorker::resume(const QString & path_, const SessionJournalContents & contents) {
+	bool ok = false;
+	// contents is only borrowed, so the call waits for the task
+	strand.post([this, &path_, &contents, &ok] {
+		reported = false;
+		ok = writer.resume(path_, contents);
+	});
+	strand.drain();
+	path = ok ? path_ : QString();
+	return ok;
+}
+
+void SessionJournalWorker::append(ProcessedBatch batch) {
+	if (path.isEmpty())
+		return;
+	strand.post([this, batch] {
+		check(writer.append(batch));
+	});
+}
+
+void SessionJournalWorker::close() {
+	path.clear();
+	strand.post([this] {
+		writer.close();
+	});
+}
+
+void SessionJournalWorker::discard() {
+	if (path.isEmpty())
+		return;
+	auto discarded = path;
+	path.clear();
+	strand.post([this, discarded] {
+		writer.close();
+		QFile::remove(discarded);
+		QFile::remove(SessionJournalWriter::indexPath(discarded));
+	});
+	strand.drain();
+}
@@ -0,0 +1,89 @@
+#pragma once
+#include <QObject>
+#include <QString>
+#include <QThreadPool>
+#include "SessionJournal.h"
+#include "SessionStrand.h"
+
+/**
+ * Klasa zapisująca dziennik sesji (SessionJournalWriter) we własnym wątku, aby zapis bloków, utrwalanie pliku
+ * na dysku i zapis indeksu nie wstrzymywały wątku GUI.
+ * Operacje wykonywane są po kolei, w kolejności wywołań, o niepowodzeniu zapisu informuje sygnał failed.
+ * Metody wywoływane są z wątku, w którym utworzono obiekt.
+ */
+class SessionJournalWorker : public QObject
+{
+	Q_OBJECT
+private:
+	QThreadPool pool;
+	SessionJournalWriter writer;
+	SessionStrand strand;
+	QString path;
+	bool reported = false;
+
+	void check(bool ok);
+
+public:
+	/**
+	 * Konstruktor inicjalizujący.
+	 * @param parent Przodek obiektu.
+	 */
+	SessionJournalWorker(QObject * parent = nullptr);
+
+	/**
+	 * Destruktor, czeka na zapis zleconych bloków i zamyka dziennik.
+	 */
+	~SessionJournalWorker();
+
+	/**
+	 * Zleca utworzenie nowego dziennika. Istniejący plik jest nadpisywany.
+	 * @param path_ Ścieżka do pliku.
+	 * @param initial Dane zapisywane w pierwszym bloku, np. zebrane przed utworzeniem dziennika.
+	 */
+	void create(const QString & path_, ProcessedBatch initial);
+
+	/**
+	 * Otwiera istniejący dziennik do dopisywania, czekając na wynik.
+	 * @see SessionJournalWriter::resume
+	 * @return false jeżeli pliku nie można otworzyć.
+	 */
+	bool resume(const QString & path_, const SessionJournalContents & contents);
+
+	/**
+	 * Zleca dopisanie bloku.
+	 * @see SessionJournalWriter::append
+	 */
+	void append(ProcessedBatch batch);
+
+	/**
+	 * Zleca zamknięcie dziennika, pliki pozostają na dysku.
+	 */
+	void close();
+
+	/**
+	 * Zamyka dziennik i usuwa jego pliki, czekając na zakończenie zleconych operacji.
+	 */
+	void discard();
+
+	/**
+	 * Metoda sprawdzająca czy dziennik jest zapisywany.
+	 */
+	bool isOpen() const {
+		return !path.isEmpty();
+	}
+
+	/**
+	 * Getter.
+	 * @return Ścieżka do pliku dziennika, pusta jeżeli dziennik nie jest zapisywany.
+	 */
+	QString fileName() const {
+		return path;
+	}
+
+signals:
+	/**
+	 * Sygnał emitowany przy pierwszym niepowodzeniu zapisu dziennika.
+	 * Emitowany z wątku zapisu.
+	 */
+	void failed();
+};
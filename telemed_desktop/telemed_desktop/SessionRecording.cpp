@@ -0,0 +1,184 @@
+#include "SessionRecording.h"
+
+#include <OpenXLSX/OpenXLSX.h>
+#include <QDateTime>
+#include <QDebug>
+#include <algorithm>
+#include <numeric>
+#include "RawCapture.h"
+#include "SessionArchive.h"
+
+namespace {
+	const QString TIMESTAMP_FORMAT = "yyyy-MM-dd hh:mm:ss.zzz";
+
+	qint64 timestampValue(OpenXLSX::XLCellValue & value) {
+		return QDateTime::fromString(QString::fromStdString(value.Get<std::string>()), TIMESTAMP_FORMAT)
+			.toMSecsSinceEpoch();
+	}
+
+	double numericValue(OpenXLSX::XLCellValue & value) {
+		if (value.ValueType() == OpenXLSX::XLValueType::Integer)
+			return double(value.Get<int64_t>());
+		return value.Get<double>();
+	}
+
+	/**
+	 * Wywołuje read dla każdego wiersza danych arkusza oraz jego kontynuacji ("nazwa 2", "nazwa 3"...).
+	 */
+	template<typename Read>
+	void readSheets(OpenXLSX::XLDocument & doc, const std::string & name, Read read) {
+		for (int part = 1; ; ++part) {
+			auto sheetName = part == 1 ? name : name + ' ' + std::to_string(part);
+			if (!doc.Workbook().SheetExists(sheetName))
+				break;
+			auto wks = doc.Workbook().Worksheet(sheetName);
+			auto rowCount = wks.RowCount();
+			for (unsigned long row = 2; row <= rowCount; ++row)
+				read(wks, row);
+		}
+	}
+
+	void readHeartRateSheet(OpenXLSX::XLDocument & doc, std::vector<HeartRate> & raw, std::vector<HeartRate> & mean) {
+		readSheets(doc, "Heart rate", [&raw, &mean](OpenXLSX::XLWorksheet & wks, unsigned long row) {
+			auto endMs = timestampValue(wks.Cell(row, 1).Value());
+			auto hr = numericValue(wks.Cell(row, 2).Value());
+			auto meanHr = numericValue(wks.Cell(row, 3).Value());
+			// only the end of the period is saved, the begin follows from the raw heart rate
+			auto beginMs = endMs - qint64(60000.0 / hr + 0.5);
+			raw.emplace_back(beginMs, endMs, hr);
+			mean.emplace_back(beginMs, endMs, meanHr);
+		});
+	}
+
+	void readSpO2Sheet(OpenXLSX::XLDocument & doc, std::vector<SpO2> & spo2) {
+		readSheets(doc, "SpO2", [&spo2](OpenXLSX::XLWorksheet & wks, unsigned long row) {
+			auto ms = timestampValue(wks.Cell(row, 1).Value());
+			auto value = numericValue(wks.Cell(row, 2).Value());
+			auto ratio = numericValue(wks.Cell(row, 3).Value());
+			spo2.emplace_back(ms, ratio, value);
+		});
+	}
+}
+
+bool SessionRecording::load(const QString & path) {
+	if (path.endsWith(".xlsx", Qt::CaseInsensitive))
+		return loadXlsx(path);
+	if (path.endsWith(".tmarc", Qt::CaseInsensitive))
+		return loadArchive(path);
+	return loadCapture(path);
+}
+
+bool SessionRecording::loadCapture(const QString & path) {
+	RawCaptureReader reader;
+	if (!reader.open(path))
+		return false;
+	frames.clear();
+	filtered = false;
+	RecordedFrame recorded;
+	while (reader.next(recorded.receivedMs, recorded.frame))
+		frames.push_back(recorded);
+	return true;
+}
+
+bool SessionRecording::loadXlsx(const QString & path) {
+	DataSnapshot data;
+	if (!readXlsx(path, data) || data.sensorData.empty())
+		return false;
+	setFilteredSamples(data.sensorData);
+	referenceHeartRate = std::move(data.heartRateRaw);
+	referenceQuantileMeanHeartRate = std::move(data.heartRate);
+	referenceSpO2 = std::move(data.spo2);
+	return true;
+}
+
+bool SessionRecording::loadArchive(const QString & path) {
+	SessionArchiveReader reader;
+	DataSnapshot data;
+	if (!reader.open(path) || !reader.read(data) || data.sensorData.empty())
+		return false;
+	setFilteredSamples(data.sensorData);
+	referenceHeartRate = std::move(data.heartRateRaw);
+	referenceQuantileMeanHeartRate = std::move(data.heartRate);
+	referenceSpO2 = std::move(data.spo2);
+	return true;
+}
+
+bool SessionRecording::loadReference(const QString & path) {
+	referenceHeartRate.clear();
+	referenceQuantileMeanHeartRate.clear();
+	referenceSpO2.clear();
+	if (path.endsWith(".tmarc", Qt::CaseInsensitive)) {
+		SessionArchiveReader reader;
+		if (!reader.open(path) || !reader.readHeartRates(referenceHeartRate, referenceQuantileMeanHeartRate)
+			|| !reader.readSpO2(referenceSpO2))
+			return false;
+		return !referenceHeartRate.empty();
+	}
+
+	using namespace OpenXLSX;
+	XLDocument doc;
+	try {
+		doc.OpenDocument(path.toStdString());
+		readHeartRateSheet(doc, referenceHeartRate, referenceQuantileMeanHeartRate);
+		readSpO2Sheet(doc, referenceSpO2);
+	}
+	catch (const std::exception & ex) {
+		qDebug() << ex.what();
+		return false;
+	}
+	return !referenceHeartRate.empty();
+}
+
+bool SessionRecording::readXlsx(const QString & path, DataSnapshot & data) {
+	using namespace OpenXLSX;
+	data = DataSnapshot();
+	XLDocument doc;
+	try {
+		doc.OpenDocument(path.toStdString());
+		if (!doc.Workbook().SheetExists("Raw data"))
+			return false;
+
+		// long sessions continue in "Raw data 2", "Raw data 3"...
+		readSheets(doc, "Raw data", [&data](OpenXLSX::XLWorksheet & wks, unsigned long row) {
+			data.sensorData.append(
+				timestampValue(wks.Cell(row, 1).Value()),
+				int(numericValue(wks.Cell(row, 2).Value())),
+				int(numericValue(wks.Cell(row, 3).Value()))
+			);
+		});
+		readHeartRateSheet(doc, data.heartRateRaw, data.heartRate);
+		readSpO2Sheet(doc, data.spo2);
+	}
+	catch (const std::exception & ex) {
+		qDebug() << ex.what();
+		return false;
+	}
+	return true;
+}
+
+void SessionRecording::setFilteredSamples(const SensorDataStore & samples) {
+	frames.clear();
+	filtered = true;
+	// timestamps become relative, like the clock of the module, and the last sample of each
+	// frame is "received" at its original timestamp
+	auto firstMs = samples.empty() ? 0 : samples.getMs(0) - 1;
+	quint32 seq = 0;
+	for (size_t begin = 0; begin < samples.size(); begin += XLSX_FRAME_SIZE) {
+		auto end = std::min(samples.size(), begin + XLSX_FRAME_SIZE);
+		std::vector<SensorData> frameSamples;
+		frameSamples.reserve(end - begin);
+		samples.forEach(begin, end, [&frameSamples, firstMs](qint64 ms, int ir, int red) {
+			frameSamples.emplace_back(ms - firstMs, ir, red);
+		});
+		auto receivedMs = frameSamples.back().getMs() + firstMs;
+		frames.push_back({ receivedMs, SensorFrame(seq, std::move(frameSamples)) });
+		seq += XLSX_FRAME_SIZE;
+	}
+}
+
+size_t SessionRecording::sampleCount() const {
+	return std::accumulate(frames.begin(), frames.end(), size_t(0),
+		[](size_t sum, const RecordedFrame & recorded)->size_t {
+		return sum + recorded.frame.size();
+	});
+}
@@ -0,0 +1,133 @@
+#pragma once
+#include <QString>
+#include <vector>
+#include "DataSnapshot.h"
+#include "HeartRate.h"
+#include "SensorFrame.h"
+#include "SpO2.h"
+
+/**
+ * Paczka próbek wraz z czasem jej odebrania.
+ */
+struct RecordedFrame {
+	qint64 receivedMs;		/**< Czas odebrania paczki w milisekundach od początku epoki. */
+	SensorFrame frame;		/**< Paczka próbek ze stemplami czasowymi zegara modułu. */
+};
+
+/**
+ * Klasa reprezentująca nagraną sesję pomiarową, wczytaną w całości do pamięci.
+ * Źródłem może być surowy zapis paczek (.tmcap), arkusz "Raw data" pliku zapisanego przez Data::saveAs
+ * lub archiwum sesji (.tmarc). Próbki z pliku .xlsx i archiwum są już przefiltrowane, a zapisany w nich
+ * puls może posłużyć jako wynik odniesienia. Zapisana saturacja jest tylko przechowywana, bo dla przefiltrowanych
+ * próbek nie jest wyznaczana.
+ */
+class SessionRecording {
+	std::vector<RecordedFrame> frames;
+	bool filtered = false;
+	std::vector<HeartRate> referenceHeartRate;
+	std::vector<HeartRate> referenceQuantileMeanHeartRate;
+	std::vector<SpO2> referenceSpO2;
+
+	void setFilteredSamples(const SensorDataStore & samples);
+
+public:
+	static constexpr int XLSX_FRAME_SIZE = 100;	/**< Liczba przefiltrowanych próbek (.xlsx, .tmarc) łączonych w jedną paczkę. */
+
+	/**
+	 * Wczytuje sesję, format wybierany jest na podstawie rozszerzenia pliku.
+	 * @param path Ścieżka do pliku .tmcap, .xlsx lub .tmarc.
+	 * @return false jeżeli pliku nie udało się wczytać.
+	 */
+	bool load(const QString & path);
+
+	/**
+	 * Wczytuje surowy zapis paczek.
+	 * @param path Ścieżka do pliku .tmcap.
+	 * @return false jeżeli pliku nie udało się otworzyć.
+	 */
+	bool loadCapture(const QString & path);
+
+	/**
+	 * Wczytuje próbki z arkusza "Raw data" (i kolejnych "Raw data 2"...) oraz wynik odniesienia z arkusza "Heart rate"
+	 * (i jego kontynuacji).
+	 * @param path Ścieżka do pliku .xlsx.
+	 * @return false jeżeli plik nie zawiera arkusza z próbkami.
+	 */
+	bool loadXlsx(const QString & path);
+
+	/**
+	 * Wczytuje próbki i wynik odniesienia z archiwum sesji.
+	 * @param path Ścieżka do pliku .tmarc.
+	 * @return false jeżeli archiwum nie zawiera próbek lub jest uszkodzone.
+	 * @see SessionArchiveReader
+	 */
+	bool loadArchive(const QString & path);
+
+	/**
+	 * Wczytuje wynik odniesienia (oraz saturację) z arkusza "Heart rate" lub z archiwum, np. gdy próbki pochodzą z pliku .tmcap.
+	 * @param path Ścieżka do pliku .xlsx lub .tmarc.
+	 * @return false jeżeli plik nie zawiera pulsu.
+	 */
+	bool loadReference(const QString & path);
+
+	/**
+	 * Odczytuje plik zapisany przez Data::saveAs, np. w celu konwersji do archiwum sesji.
+	 * Stemple czasowe pozostają bezwzględne, początek okresu pulsu wyznaczany jest z jego wartości.
+	 * @param path Ścieżka do pliku .xlsx.
+	 * @param data Odczytane próbki, wartości pulsu i saturacji, plik nie zawiera stempli uderzeń serca.
+	 * @return false jeżeli pliku nie udało się otworzyć lub nie zawiera arkusza z próbkami.
+	 */
+	static bool readXlsx(const QString & path, DataSnapshot & data);
+
+	/**
+	 * Getter.
+	 * @return Paczki uporządkowane według czasu odebrania.
+	 */
+	const std::vector<RecordedFrame> & getFrames() const {
+		return frames;
+	}
+
+	/**
+	 * Metoda sprawdzająca czy próbki zostały już przefiltrowane.
+	 */
+	bool isFiltered() const {
+		return filtered;
+	}
+
+	/**
+	 * Metoda sprawdzająca czy sesja posiada wynik odniesienia.
+	 */
+	bool hasReference() const {
+		return !referenceHeartRate.empty();
+	}
+
+	/**
+	 * Getter.
+	 * @return Nieuśrednione wartości pulsu wyznaczone podczas nagrania.
+	 */
+	const std::vector<HeartRate> & getReferenceHeartRate() const {
+		return referenceHeartRate;
+	}
+
+	/**
+	 * Getter.
+	 * @return Uśrednione wartości pulsu wyznaczone podczas nagrania.
+	 */
+	const std::vector<HeartRate> & getReferenceQuantileMeanHeartRate() const {
+		return referenceQuantileMeanHeartRate;
+	}
+
+	/**
+	 * Getter.
+	 * @return Oszacowania saturacji zapisane w pliku .xlsx lub archiwum.
+	 */
+	const std::vector<SpO2> & getReferenceSpO2() const {
+		return referenceSpO2;
+	}
+
+	/**
+	 * Getter.
+	 * @return Liczba próbek we wszystkich paczkach.
+	 */
+	size_t sampleCount() const;
+};
@@ -0,0 +1,88 @@
+#include "SessionStrand.h"
+
+#include <QMutexLocker>
+#include <QRunnable>
+#include <QThreadPool>
+
+/**
+ * Zadanie puli wątków wykonujące kolejne zadania sesji, usuwane przez pulę po zakończeniu.
+ */
+class SessionStrand::Runner : public QRunnable {
+	SessionStrand * strand;
+
+public:
+	Runner(SessionStrand * strand_)
+		: strand(strand_)
+	{
+		setAutoDelete(true);
+	}
+
+	void run() override {
+		strand->run();
+	}
+};
+
+SessionStrand::SessionStrand(QThreadPool * pool_)
+	: pool(pool_)
+{
+}
+
+SessionStrand::~SessionStrand() {
+	close();
+}
+
+void SessionStrand::post(std::function<void()> task) {
+	QMutexLocker lock(&mutex);
+	if (closed)
+		return;
+	tasks.push_back(std::move(task));
+	if (!scheduled) {
+		scheduled = true;
+		schedule();
+	}
+}
+
+void SessionStrand::schedule() {
+	pool->start(new Runner(this));
+}
+
+void SessionStrand::close() {
+	QMutexLocker lock(&mutex);
+	closed = true;
+	tasks.clear();
+	while (scheduled)
+		idle.wait(&mutex);
+}
+
+void SessionStrand::drain() {
+	QMutexLocker lock(&mutex);
+	while (scheduled)
+		idle.wait(&mutex);
+}
+
+void SessionStrand::run() {
+	for (int i = 0; i < STRAND_TASKS_PER_RUN; ++i) {
+		std::function<void()> task;
+		{
+			QMutexLocker lock(&mutex);
+			if (tasks.empty()) {
+				scheduled = false;
+				idle.wakeAll();
+				return;
+			}
+			task = std::move(tasks.front());
+			tasks.pop_front();
+		}
+		task();
+	}
+
+	// give other sessions a chance, the strand stays scheduled
+	QMutexLocker lock(&mutex);
+	if (tasks.empty()) {
+		scheduled = false;
+		idle.wakeAll();
+	}
+	else {
+		schedule();
+	}
+}
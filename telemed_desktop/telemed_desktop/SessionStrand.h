@@ -0,0 +1,68 @@
+#pragma once
+#include <QMutex>
+#include <QWaitCondition>
+#include <atomic>
+#include <deque>
+#include <functional>
+
+class QThreadPool;
+
+auto constexpr STRAND_TASKS_PER_RUN = 16;	/**< Liczba zadań wykonywanych przed oddaniem wątku innym sesjom. */
+
+/**
+ * Klasa szeregująca zadania jednej sesji pomiarowej w puli wątków.
+ * Zadania danej sesji wykonywane są po kolei i nigdy równolegle, w kolejności zgłoszenia,
+ * natomiast zadania różnych sesji mogą być wykonywane jednocześnie w różnych wątkach puli.
+ * Po wykonaniu STRAND_TASKS_PER_RUN zadań wątek oddawany jest puli, aby sesje nie zagładzały się nawzajem.
+ */
+class SessionStrand {
+	QThreadPool * pool;
+	QMutex mutex;
+	QWaitCondition idle;
+	std::deque<std::function<void()>> tasks;
+	bool scheduled = false;
+	std::atomic<bool> closed{ false };
+
+	class Runner;
+
+	void schedule();
+	void run();
+
+public:
+	/**
+	 * Konstruktor inicjalizujący.
+	 * @param pool_ Pula wątków wykonująca zadania.
+	 */
+	SessionStrand(QThreadPool * pool_);
+
+	/**
+	 * Destruktor, wywołuje SessionStrand::close.
+	 */
+	~SessionStrand();
+
+	/**
+	 * Zgłasza zadanie do wykonania. Metoda może być wywoływana z dowolnego wątku.
+	 * Po zamknięciu obiektu zadania są ignorowane.
+	 * @param task Zadanie.
+	 */
+	void post(std::function<void()> task);
+
+	/**
+	 * Porzuca oczekujące zadania i czeka na zakończenie aktualnie wykonywanego.
+	 */
+	void close();
+
+	/**
+	 * Czeka na wykonanie wszystkich zgłoszonych zadań, również zgłoszonych w trakcie oczekiwania.
+	 * Nie może być wywoływana z zadania wykonywanego przez ten obiekt.
+	 */
+	void drain();
+
+	/**
+	 * Metoda sprawdzająca czy obiekt został zamknięty.
+	 * Długie zadania powinny ją sprawdzać, aby nie blokować zamknięcia.
+	 */
+	bool isClosed() const {
+		return closed.load(std::memory_order_relaxed);
+	}
+};
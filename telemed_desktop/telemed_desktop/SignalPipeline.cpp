@@ -0,0 +1,89 @@
+#include "SignalPipeline.h"
+
+static_assert(BeatDetectorConfig::SAMPLES_PERIOD * SAMPLING_RATE == 1000,
+	"the beat detector tuning has to match the sampling rate");
+
+SignalPipeline::SignalPipeline(unsigned int quantileMeanN)
+	: hrTrimmedMean(quantileMeanN, QUANTILE_TRIM_FRACTION)
+{
+	// iir1 designs the filter, the cascade runs it for both channels
+	Iir::Butterworth::BandPass<FILTER_ORDER> bandPass;
+	bandPass.setup(
+		SAMPLING_RATE,
+		(LOW_CUT_FREQ + HIGH_CUT_FREQ) / 2,
+		(HIGH_CUT_FREQ - LOW_CUT_FREQ)
+	);
+	filter.setup(bandPass);
+}
+
+void SignalPipeline::process(const SensorFrame & frame, qint64 begMs, ProcessedBatch & batch) {
+	msBlock.clear();
+	irBlock.clear();
+	redBlock.clear();
+	for (auto & row : frame.getSamples()) {
+		auto ms = row.getMs() + begMs;
+		if (ms <= lastMs)
+			continue;
+		lastMs = ms;
+		msBlock.push_back(ms);
+		irBlock.push_back(row.getIrLed());
+		redBlock.push_back(row.getRedLed());
+	}
+	// raw values stay in irBlock/redBlock, the SpO2 estimator needs their DC
+	irAcBlock.resize(irBlock.size());
+	redAcBlock.resize(redBlock.size());
+	if (filteringEnabled)
+		filter.filter(irBlock.data(), redBlock.data(), irAcBlock.data(), redAcBlock.data(), irBlock.size());
+	else {
+		irAcBlock = irBlock;
+		redAcBlock = redBlock;
+	}
+
+	batch.samples.reserve(batch.samples.size() + msBlock.size());
+	detectorBlock.clear();
+	for (size_t i = 0; i < msBlock.size(); ++i) {
+		auto ir = int(irAcBlock[i]);
+		batch.samples.emplace_back(msBlock[i], ir, int(redAcBlock[i]));
+		detectorBlock.push_back(float(ir * -1));
+	}
+
+	beatIndices.clear();
+	beatDetector.addSamples(msBlock.data(), detectorBlock.data(), msBlock.size(), beatIndices);
+	// the estimator walks the block once, closing its periods at the detected beats
+	size_t next = 0;
+	for (auto i : beatIndices) {
+		for (; next <= i; ++next)
+			spo2Estimator.addSample(irBlock[next], redBlock[next], irAcBlock[next], redAcBlock[next]);
+		auto ms = msBlock[i];
+		batch.beats.push_back(ms);
+		if (lastBeatMs >= 0) {
+			batch.heartRatesRaw.emplace_back(lastBeatMs, ms);
+			auto hr = batch.heartRatesRaw.back().getHR();
+			hrHistory.push_back(hr);
+			hrTrimmedMean.push(hr);
+			batch.heartRates.emplace_back(lastBeatMs, ms, hrTrimmedMean.mean());
+		}
+		lastBeatMs = ms;
+		SpO2 spo2;
+		if (spo2Estimator.beat(ms, spo2))
+			batch.spo2.push_back(spo2);
+	}
+	for (; next < msBlock.size(); ++next)
+		spo2Estimator.addSample(irBlock[next], redBlock[next], irAcBlock[next], redAcBlock[next]);
+}
+
+void SignalPipeline::setHeartRateQuantileN(unsigned int n) {
+	hrTrimmedMean.clear();
+	hrTrimmedMean.setWindowSize(n);
+	auto begin = hrHistory.size() > n ? hrHistory.end() - n : hrHistory.begin();
+	for (; begin != hrHistory.end(); ++begin)
+		hrTrimmedMean.push(*begin);
+}
+
+void SignalPipeline::clearHistory() {
+	hrTrimmedMean.clear();
+	hrHistory.clear();
+	spo2Estimator.clear();
+	lastMs = -1;
+	lastBeatMs = -1;
+}
@@ -0,0 +1,95 @@
+#pragma once
+#include <QtGlobal>
+#include <vector>
+#include <iir/Butterworth.h>
+#include "DualBiquadCascade.h"
+#include "MAX30100_BeatDetector.h"
+#include "HeartRate.h"
+#include "SensorData.h"
+#include "SensorFrame.h"
+#include "SpO2Estimator.h"
+#include "StreamingTrimmedMean.h"
+
+auto constexpr FILTER_ORDER = 2;		/**< Rząd filtru. */
+
+auto constexpr SAMPLING_RATE = 100.0;	/**< Częstotliwość próbkowania czujnika w Hz. */
+auto constexpr LOW_CUT_FREQ = 1.4;		/**< Dolna częstotliwość odcięcia filtru w Hz. */// Hz
+auto constexpr HIGH_CUT_FREQ = 6;		/**< Górna częstotliwość odcięcia filtru w Hz. */// Hz
+
+auto constexpr QUANTILE_TRIM_FRACTION = 0.3;	/**< Część skrajnych wartości pulsu odrzucanych z każdej strony przy liczeniu średniej. */
+
+/**
+ * Wynik przetworzenia jednej paczki próbek.
+ */
+struct ProcessedBatch {
+	quint64 generation = 0;					/**< Numer generacji danych, zmieniany przy czyszczeniu danych. */
+	qint64 receivedNs = 0;					/**< Chwila odebrania paczki, SensorFrame::getReceivedNs. */
+	std::vector<SensorData> samples;		/**< Przefiltrowane próbki, stemple czasowe w milisekundach od początku epoki. */
+	std::vector<qint64> beats;				/**< Stemple czasowe wykrytych uderzeń serca. */
+	std::vector<HeartRate> heartRatesRaw;	/**< Puls wyznaczony z kolejnych uderzeń. */
+	std::vector<HeartRate> heartRates;		/**< Średnia obcięta pulsu odpowiadająca heartRatesRaw. */
+	std::vector<SpO2> spo2;					/**< Oszacowania saturacji krwi tlenem. */
+};
+
+/**
+ * Klasa realizująca przetwarzanie próbek: filtrację pasmowoprzepustową, detekcję uderzeń serca,
+ * wyznaczanie średniej obciętej pulsu oraz saturacji krwi tlenem (SpO2Estimator).
+ * Nie korzysta z pętli zdarzeń Qt, więc może pracować w dowolnym wątku.
+ * Obie diody filtrowane są razem, całą paczką (DualBiquadCascade), filtrem o współczynnikach wyznaczonych przez iir1.
+ */
+class SignalPipeline {
+	DualBiquadCascade filter;
+	BeatDetector beatDetector;
+	SpO2Estimator spo2Estimator;
+	std::vector<qint64> msBlock;
+	std::vector<double> irBlock;
+	std::vector<double> redBlock;
+	std::vector<double> irAcBlock;
+	std::vector<double> redAcBlock;
+	std::vector<float> detectorBlock;
+	std::vector<size_t> beatIndices;
+
+	StreamingTrimmedMean hrTrimmedMean;
+	std::vector<double> hrHistory;
+	qint64 lastMs = -1;
+	qint64 lastBeatMs = -1;
+	bool filteringEnabled = true;
+
+public:
+	/**
+	 * Domyślny konstruktor.
+	 * @param quantileMeanN Liczba ostatnich wartości pulsu uwzględnianych w średniej obciętej.
+	 */
+	SignalPipeline(unsigned int quantileMeanN = 10);
+
+	/**
+	 * Przetwarza paczkę próbek.
+	 * Próbki o stemplach czasowych nie późniejszych od ostatnio przetworzonej są pomijane.
+	 * @param frame Paczka próbek ze stemplami czasowymi zegara modułu.
+	 * @param begMs Przesunięcie zegara modułu względem początku epoki w milisekundach.
+	 * @param batch Obiekt do którego dopisywany jest wynik.
+	 */
+	void process(const SensorFrame & frame, qint64 begMs, ProcessedBatch & batch);
+
+	/**
+	 * Zmienia liczbę wartości pulsu uwzględnianych w średniej obciętej.
+	 * Okno wypełniane jest ponownie ostatnimi wyznaczonymi wartościami pulsu.
+	 * @param n Liczba wartości.
+	 */
+	void setHeartRateQuantileN(unsigned int n);
+
+	/**
+	 * Setter.
+	 * Wyłączenie filtracji pozwala przetwarzać próbki przefiltrowane wcześniej, np. odczytane z pliku .xlsx.
+	 * @param enabled true - próbki przechodzą przez filtr pasmowoprzepustowy, false - trafiają do detektora bez zmian.
+	 */
+	void setFilteringEnabled(bool enabled) {
+		filteringEnabled = enabled;
+	}
+
+	/**
+	 * Zapomina wykryte uderzenia i wartości pulsu.
+	 * Stan filtrów i detektora jest zachowywany, aby uniknąć stanu przejściowego.
+	 */
+	void clearHistory();
+};
@@ -0,0 +1,73 @@
+#pragma once
+#include <QtGlobal>
+#include <deque>
+#include <utility>
+
+/**
+ * Klasa wyznaczająca minimum i maksimum w przesuwnym oknie czasowym.
+ * Wykorzystuje dwie kolejki monotoniczne, dzięki czemu dodanie próbki ma zamortyzowany koszt O(1),
+ * a odczyt minimum i maksimum koszt O(1).
+ * Okno zawsze zawiera co najmniej ostatnią dodaną wartość.
+ */
+template<class T>
+class SlidingMinMax {
+	std::deque<std::pair<qint64, T>> minQueue;
+	std::deque<std::pair<qint64, T>> maxQueue;
+
+public:
+	/**
+	 * Dodaje wartość do okna.
+	 * @param ms Stempel czasowy wartości, niemalejący względem poprzednich.
+	 * @param value Wartość.
+	 */
+	void push(qint64 ms, T value) {
+		while (!minQueue.empty() && minQueue.back().second >= value)
+			minQueue.pop_back();
+		minQueue.emplace_back(ms, value);
+		while (!maxQueue.empty() && maxQueue.back().second <= value)
+			maxQueue.pop_back();
+		maxQueue.emplace_back(ms, value);
+	}
+
+	/**
+	 * Usuwa z okna wartości o stemplu czasowym nie późniejszym niż podany.
+	 * @param ms Stempel czasowy w milisekundach.
+	 */
+	void evictNotLaterThan(qint64 ms) {
+		while (minQueue.size() > 1 && minQueue.front().first <= ms)
+			minQueue.pop_front();
+		while (maxQueue.size() > 1 && maxQueue.front().first <= ms)
+			maxQueue.pop_front();
+	}
+
+	/**
+	 * Usuwa wszystkie wartości z okna.
+	 */
+	void clear() {
+		minQueue.clear();
+		maxQueue.clear();
+	}
+
+	/**
+	 * Metoda sprawdzająca czy okno jest puste.
+	 */
+	bool empty() const {
+		return maxQueue.empty();
+	}
+
+	/**
+	 * Getter.
+	 * @return Minimalna wartość w oknie, okno nie może być puste.
+	 */
+	T min() const {
+		return minQueue.front().second;
+	}
+
+	/**
+	 * Getter.
+	 * @return Maksymalna wartość w oknie, okno nie może być puste.
+	 */
+	T max() const {
+		return maxQueue.front().second;
+	}
+};
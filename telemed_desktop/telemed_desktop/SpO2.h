@@ -0,0 +1,59 @@
+#pragma once
+#include <QString>
+#include <QtGlobal>
+
+/**
+ * Klasa reprezentująca oszacowanie saturacji krwi tlenem (SpO2).
+ */
+class SpO2 {
+	qint64 ms = 0;
+	double ratio = 0.0;
+	double spo2 = 0.0;
+public:
+	/**
+	 * Konstruktor inicjalizujący.
+	 * @param ms_ Stempel czasowy uderzenia serca kończącego okres pomiaru w milisekundach.
+	 * @param ratio_ Stosunek (AC/DC) diody czerwonej do (AC/DC) diody podczerwonej.
+	 * @param spo2_ Saturacja w procentach.
+	 */
+	SpO2(qint64 ms_, double ratio_, double spo2_) :
+		ms(ms_), ratio(ratio_), spo2(spo2_)
+	{}
+
+	/**
+	 * Domyślny konstruktor.
+	 */
+	SpO2() {}
+
+	/**
+	 * Getter.
+	 * @return Stempel czasowy w milisekundach.
+	 */
+	qint64 getMs() const {
+		return ms;
+	}
+
+	/**
+	 * Getter.
+	 * @return Stosunek (AC/DC) diody czerwonej do (AC/DC) diody podczerwonej.
+	 */
+	double getRatio() const {
+		return ratio;
+	}
+
+	/**
+	 * Getter.
+	 * @return Saturacja w procentach.
+	 */
+	double getSpO2() const {
+		return spo2;
+	}
+
+	/**
+	 * Getter.
+	 * @return Saturacja w procentach jako tekst.
+	 */
+	QString getSpO2Str() const {
+		return QString::number(spo2);
+	}
+};
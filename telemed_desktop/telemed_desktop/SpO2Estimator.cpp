@@ -0,0 +1,38 @@
+#include "SpO2Estimator.h"
+#include <algorithm>
+#include <cmath>
+
+bool SpO2Estimator::beat(qint64 ms, SpO2 & spo2) {
+	if (beats < 0) {
+		// the first beat only opens the measurement period
+		beats = 0;
+		return false;
+	}
+	if (++beats < SPO2_BEATS_PER_ESTIMATE)
+		return false;
+	// beats may come without samples in between, e.g. from a replayed beat list
+	if (samples == 0) {
+		beats = 0;
+		return false;
+	}
+
+	auto irAc = std::sqrt(irAcSquares / samples);
+	auto redAc = std::sqrt(redAcSquares / samples);
+	beats = 0;
+	samples = 0;
+	irAcSquares = redAcSquares = 0.0;
+	// filtered input (e.g. replayed from .xlsx) has no DC, so there is nothing to estimate
+	if (irDc < SPO2_MIN_DC || redDc < SPO2_MIN_DC || irAc <= 0.0)
+		return false;
+
+	auto ratio = (redAc / redDc) / (irAc / irDc);
+	auto value = SPO2_CALIBRATION_A - SPO2_CALIBRATION_B * ratio;
+	if (value < SPO2_MIN_VALID)
+		return false;
+	spo2 = SpO2(ms, ratio, std::min(value, 100.0));
+	return true;
+}
+
+void SpO2Estimator::clear() {
+	*this = SpO2Estimator();
+}
@@ -0,0 +1,64 @@
+#pragma once
+#include <QtGlobal>
+#include "SpO2.h"
+
+auto constexpr SPO2_DC_ALPHA = 0.01;			/**< Współczynnik filtru dolnoprzepustowego składowej stałej (ok. 1 s przy 100 Hz). */
+auto constexpr SPO2_BEATS_PER_ESTIMATE = 3;		/**< Liczba okresów pulsu składających się na jedno oszacowanie. */
+auto constexpr SPO2_MIN_DC = 1000.0;			/**< Minimalna składowa stała, poniżej której sygnał nie pochodzi z czujnika. */
+auto constexpr SPO2_CALIBRATION_A = 110.0;		/**< Kalibracja SpO2 = A - B * R. */
+auto constexpr SPO2_CALIBRATION_B = 25.0;		/**< Kalibracja SpO2 = A - B * R. */
+auto constexpr SPO2_MIN_VALID = 50.0;			/**< Najmniejsza saturacja uznawana za wiarygodną w procentach. */
+
+/**
+ * Klasa szacująca strumieniowo saturację krwi tlenem na podstawie obu diod.
+ * Składowa stała (DC) każdej diody śledzona jest filtrem dolnoprzepustowym surowych próbek,
+ * a składowa zmienna (AC) jako wartość skuteczna (RMS) próbek po filtrze pasmowoprzepustowym.
+ * Sumy kwadratów zbierane są między uderzeniami serca, po każdych SPO2_BEATS_PER_ESTIMATE okresach
+ * wyznaczany jest stosunek R = (AC/DC) czerwonej / (AC/DC) podczerwonej i saturacja SPO2_CALIBRATION_A - SPO2_CALIBRATION_B * R.
+ * Koszt jednej próbki jest stały.
+ */
+class SpO2Estimator {
+	double irDc = 0.0;
+	double redDc = 0.0;
+	double irAcSquares = 0.0;
+	double redAcSquares = 0.0;
+	qint64 samples = 0;
+	int beats = -1;		// -1 until the first beat opens a period
+	bool primed = false;
+
+public:
+	/**
+	 * Dodaje próbkę obu diod.
+	 * @param irRaw Surowa wartość diody podczerwonej.
+	 * @param redRaw Surowa wartość diody czerwonej.
+	 * @param irAc Wartość diody podczerwonej po filtrze pasmowoprzepustowym.
+	 * @param redAc Wartość diody czerwonej po filtrze pasmowoprzepustowym.
+	 */
+	void addSample(double irRaw, double redRaw, double irAc, double redAc) {
+		if (!primed) {
+			irDc = irRaw;
+			redDc = redRaw;
+			primed = true;
+		}
+		irDc += (irRaw - irDc) * SPO2_DC_ALPHA;
+		redDc += (redRaw - redDc) * SPO2_DC_ALPHA;
+		if (beats < 0)
+			return;
+		irAcSquares += irAc * irAc;
+		redAcSquares += redAc * redAc;
+		++samples;
+	}
+
+	/**
+	 * Zaznacza uderzenie serca po ostatnio dodanej próbce.
+	 * @param ms Stempel czasowy uderzenia w milisekundach.
+	 * @param spo2 Oszacowanie, jeżeli zostało wyznaczone.
+	 * @return true jeżeli uderzenie zamyka okres pomiaru i oszacowanie jest wiarygodne.
+	 */
+	bool beat(qint64 ms, SpO2 & spo2);
+
+	/**
+	 * Zeruje stan estymatora.
+	 */
+	void clear();
+};
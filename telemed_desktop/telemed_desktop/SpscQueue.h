@@ -0,0 +1,51 @@
+#pragma once
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <utility>
+
+/**
+ * Bezblokadowa kolejka o stałej pojemności dla jednego producenta i jednego konsumenta.
+ * Producent zapisuje wyłącznie indeks tail, konsument wyłącznie indeks head,
+ * dzięki czemu do synchronizacji wystarczają operacje acquire/release.
+ * @tparam T Typ elementu, musi być domyślnie konstruowalny i przenoszalny.
+ * @tparam Capacity Pojemność kolejki, musi być potęgą dwójki.
+ */
+template<class T, size_t Capacity>
+class SpscQueue {
+	static_assert(Capacity && (Capacity & (Capacity - 1)) == 0, "Capacity must be a power of two");
+	static constexpr size_t MASK = Capacity - 1;
+
+	std::array<T, Capacity> items;
+	alignas(64) std::atomic<size_t> head{ 0 };
+	alignas(64) std::atomic<size_t> tail{ 0 };
+
+public:
+	/**
+	 * Dodaje element na koniec kolejki. Wywoływana wyłącznie przez producenta.
+	 * @param item Element, przenoszony tylko jeżeli zostanie dodany.
+	 * @return false jeżeli kolejka jest pełna.
+	 */
+	bool push(T && item) {
+		auto t = tail.load(std::memory_order_relaxed);
+		if (t - head.load(std::memory_order_acquire) == Capacity)
+			return false;
+		items[t & MASK] = std::move(item);
+		tail.store(t + 1, std::memory_order_release);
+		return true;
+	}
+
+	/**
+	 * Pobiera element z początku kolejki. Wywoływana wyłącznie przez konsumenta.
+	 * @param item Obiekt do którego przenoszony jest element.
+	 * @return false jeżeli kolejka jest pusta.
+	 */
+	bool pop(T & item) {
+		auto h = head.load(std::memory_order_relaxed);
+		if (h == tail.load(std::memory_order_acquire))
+			return false;
+		item = std::move(items[h & MASK]);
+		head.store(h + 1, std::memory_order_release);
+		return true;
+	}
+};
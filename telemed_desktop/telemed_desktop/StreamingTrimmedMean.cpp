@@ -0,0 +1,90 @@
+#include "StreamingTrimmedMean.h"
+
+#include <iterator>
+
+void StreamingTrimmedMean::push(double value) {
+	window.push_back(value);
+	insert(value);
+	while (window.size() > windowSize) {
+		erase(window.front());
+		window.pop_front();
+	}
+	rebalance();
+}
+
+void StreamingTrimmedMean::setWindowSize(unsigned int n) {
+	windowSize = n;
+	while (window.size() > windowSize) {
+		erase(window.front());
+		window.pop_front();
+	}
+	rebalance();
+}
+
+void StreamingTrimmedMean::clear() {
+	window.clear();
+	low.clear();
+	mid.clear();
+	high.clear();
+	midSum = 0.0;
+}
+
+double StreamingTrimmedMean::mean() const {
+	if (mid.empty())
+		return 0.0;
+	return midSum / mid.size();
+}
+
+void StreamingTrimmedMean::insert(double value) {
+	if (!low.empty() && value < *low.rbegin()) {
+		low.insert(value);
+	}
+	else if (!high.empty() && value > *high.begin()) {
+		high.insert(value);
+	}
+	else {
+		mid.insert(value);
+		midSum += value;
+	}
+}
+
+void StreamingTrimmedMean::erase(double value) {
+	if (!low.empty() && value <= *low.rbegin()) {
+		low.erase(low.find(value));
+	}
+	else if (!high.empty() && value >= *high.begin()) {
+		high.erase(high.find(value));
+	}
+	else {
+		mid.erase(mid.find(value));
+		midSum -= value;
+	}
+}
+
+void StreamingTrimmedMean::rebalance() {
+	size_t trim = size_t(window.size() * trimFraction);
+
+	while (low.size() > trim)
+		moveToMid(low, std::prev(low.end()));
+	while (high.size() > trim)
+		moveToMid(high, high.begin());
+	while (low.size() < trim && !mid.empty())
+		moveFromMid(low, mid.begin());
+	while (high.size() < trim && !mid.empty())
+		moveFromMid(high, std::prev(mid.end()));
+
+	if (mid.empty())
+		midSum = 0.0;
+}
+
+void StreamingTrimmedMean::moveToMid(std::multiset<double> & from, std::multiset<double>::iterator it) {
+	midSum += *it;
+	mid.insert(*it);
+	from.erase(it);
+}
+
+void StreamingTrimmedMean::moveFromMid(std::multiset<double> & to, std::multiset<double>::iterator it) {
+	midSum -= *it;
+	to.insert(*it);
+	mid.erase(it);
+}
@@ -0,0 +1,68 @@
+#pragma once
+#include <cstddef>
+#include <deque>
+#include <set>
+
+/**
+ * Klasa wyznaczająca średnią obciętą z ostatnich N wartości w sposób strumieniowy.
+ * Wartości okna podzielone są na trzy uporządkowane zbiory: dolny, środkowy i górny.
+ * Zbiory skrajne zawierają po floor(n * trimFraction) wartości odrzucanych przy liczeniu średniej,
+ * a suma zbioru środkowego aktualizowana jest przy każdym przesunięciu elementu.
+ * Dodanie i usunięcie wartości ma koszt O(log N), odczyt średniej koszt O(1).
+ */
+class StreamingTrimmedMean {
+	std::deque<double> window;
+	std::multiset<double> low;
+	std::multiset<double> mid;
+	std::multiset<double> high;
+	double midSum = 0.0;
+	unsigned int windowSize;
+	double trimFraction;
+
+	void insert(double value);
+	void erase(double value);
+	void rebalance();
+	void moveToMid(std::multiset<double> & from, std::multiset<double>::iterator it);
+	void moveFromMid(std::multiset<double> & to, std::multiset<double>::iterator it);
+
+public:
+	/**
+	 * Konstruktor inicjalizujący.
+	 * @param windowSize_ Liczba ostatnich wartości branych pod uwagę.
+	 * @param trimFraction_ Część wartości odrzucanych z każdej strony posortowanego okna.
+	 */
+	StreamingTrimmedMean(unsigned int windowSize_, double trimFraction_) :
+		windowSize(windowSize_), trimFraction(trimFraction_)
+	{}
+
+	/**
+	 * Dodaje nową wartość do okna, usuwając najstarszą jeżeli okno jest pełne.
+	 * @param value Nowa wartość.
+	 */
+	void push(double value);
+
+	/**
+	 * Zmienia rozmiar okna, nadmiarowe najstarsze wartości są usuwane.
+	 * @param n Nowy rozmiar okna.
+	 */
+	void setWindowSize(unsigned int n);
+
+	/**
+	 * Usuwa wszystkie wartości z okna.
+	 */
+	void clear();
+
+	/**
+	 * Getter.
+	 * @return Średnia obcięta wartości w oknie, 0 jeżeli okno jest puste.
+	 */
+	double mean() const;
+
+	/**
+	 * Getter.
+	 * @return Liczba wartości w oknie.
+	 */
+	size_t size() const {
+		return window.size();
+	}
+};
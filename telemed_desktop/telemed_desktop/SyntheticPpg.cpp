@@ -0,0 +1,72 @@
+#include "SyntheticPpg.h"
+
+#include <cmath>
+#include <QtMath>
+#include <vector>
+#include "SignalPipeline.h"
+
+namespace {
+	auto constexpr IR_DC = 48000.0;
+	auto constexpr IR_AC = 900.0;
+	auto constexpr RED_DC = 36000.0;
+	auto constexpr RED_AC = 600.0;
+	auto constexpr NOISE_LEVEL = 25.0;
+	auto constexpr HR_VARIABILITY = 3.0;	// bpm
+	auto constexpr ARTIFACT_MIN_LENGTH = 0.5;	// s
+	auto constexpr ARTIFACT_MAX_LENGTH = 2.0;	// s
+	auto constexpr ARTIFACT_TREMOR_FREQ = 2.0;	// Hz
+
+	double gauss(double x, double mean, double sigma) {
+		auto d = (x - mean) / sigma;
+		return std::exp(-0.5 * d * d);
+	}
+}
+
+SyntheticPpg::SyntheticPpg(double heartRate_, unsigned int seed)
+	: heartRate(heartRate_), beatHeartRate(heartRate_), rng(seed), noiseLevel(NOISE_LEVEL)
+{
+}
+
+double SyntheticPpg::pulseShape(double phase) const {
+	// systolic peak followed by the dicrotic wave
+	return gauss(phase, 0.15, 0.06) + 0.4 * gauss(phase, 0.45, 0.08);
+}
+
+double SyntheticPpg::nextArtifact() {
+	if (artifactPosition >= artifactLength) {
+		if (artifactsPerMinute <= 0.0 || uniform(rng) >= artifactsPerMinute / 60.0 / SAMPLING_RATE)
+			return 0.0;
+		auto length = ARTIFACT_MIN_LENGTH + (ARTIFACT_MAX_LENGTH - ARTIFACT_MIN_LENGTH) * uniform(rng);
+		artifactLength = int(length * SAMPLING_RATE);
+		artifactPosition = 0;
+		artifactScale = artifactAmplitude * (0.5 + 0.5 * uniform(rng)) * (uniform(rng) < 0.5 ? -1 : 1);
+	}
+	// baseline bump with tremor on top of it
+	auto t = double(artifactPosition++) / artifactLength;
+	return artifactScale * (std::sin(M_PI * t)
+		+ 0.3 * std::sin(2 * M_PI * ARTIFACT_TREMOR_FREQ * artifactLength / SAMPLING_RATE * t));
+}
+
+SensorFrame SyntheticPpg::nextFrame(size_t count) {
+	auto constexpr samplePeriod = 1000.0 / SAMPLING_RATE;
+	std::vector<SensorData> samples;
+	samples.reserve(count);
+	auto firstSeq = seq;
+	for (size_t i = 0; i < count; ++i, ++seq) {
+		auto shape = pulseShape(phase);
+		auto artifact = nextArtifact();
+		// blood absorbs light, so the pulse lowers the readout
+		samples.emplace_back(
+			qint64(seq * samplePeriod),
+			int(IR_DC - IR_AC * shape + artifact + noiseLevel * noise(rng)),
+			int(RED_DC - RED_AC * shape + artifact * RED_AC / IR_AC + noiseLevel * noise(rng))
+		);
+
+		phase += beatHeartRate / 60.0 / SAMPLING_RATE;
+		if (phase >= 1.0) {
+			phase -= 1.0;
+			beatHeartRate = heartRate + HR_VARIABILITY * noise(rng);
+		}
+	}
+	return SensorFrame(firstSeq, std::move(samples));
+}
@@ -0,0 +1,66 @@
+#pragma once
+#include <QtGlobal>
+#include <random>
+#include "SensorFrame.h"
+
+/**
+ * Generator syntetycznego sygnału fotopletyzmograficznego (PPG) w formacie czujnika MAX30100.
+ * Każdy okres pulsu składa się z fali skurczowej i mniejszej fali dykrotycznej,
+ * do których dodawany jest szum oraz zmienność rytmu serca.
+ * Opcjonalnie generowane są artefakty ruchowe - krótkie, silne zaburzenia linii bazowej.
+ * Służy do symulacji modułów WiFi bez fizycznego czujnika.
+ */
+class SyntheticPpg {
+	double heartRate;
+	double beatHeartRate;
+	double phase = 0.0;
+	quint32 seq = 0;
+	std::mt19937 rng;
+	std::normal_distribution<double> noise{ 0.0, 1.0 };
+	std::uniform_real_distribution<double> uniform{ 0.0, 1.0 };
+	double noiseLevel;
+
+	double artifactsPerMinute = 0.0;
+	double artifactAmplitude = 0.0;
+	int artifactLength = 0;
+	int artifactPosition = 0;
+	double artifactScale = 0.0;
+
+	double pulseShape(double phase) const;
+	double nextArtifact();
+
+public:
+	/**
+	 * Konstruktor inicjalizujący.
+	 * @param heartRate_ Średni puls w uderzeniach na minutę.
+	 * @param seed Ziarno generatora liczb losowych, te same wartości dają ten sam sygnał.
+	 */
+	SyntheticPpg(double heartRate_ = 72.0, unsigned int seed = 0);
+
+	/**
+	 * Setter.
+	 * @param level Odchylenie standardowe szumu dodawanego do każdej próbki.
+	 */
+	void setNoiseLevel(double level) {
+		noiseLevel = level;
+	}
+
+	/**
+	 * Setter.
+	 * Artefakt trwa od 0.5 do 2 sekund i zaburza oba kanały czujnika.
+	 * @param perMinute Średnia liczba artefaktów na minutę, 0 wyłącza artefakty.
+	 * @param amplitude Maksymalna amplituda artefaktu w jednostkach odczytu czujnika.
+	 */
+	void setMotionArtifacts(double perMinute, double amplitude) {
+		artifactsPerMinute = perMinute;
+		artifactAmplitude = amplitude;
+	}
+
+	/**
+	 * Generuje kolejną paczkę próbek próbkowanych z częstotliwością SAMPLING_RATE.
+	 * Stemple czasowe i numery sekwencyjne są ciągłe pomiędzy paczkami.
+	 * @param count Liczba próbek.
+	 * @return Paczka próbek ze stemplami czasowymi zegara modułu.
+	 */
+	SensorFrame nextFrame(size_t count);
+};
@@ -0,0 +1,386 @@
+#include "TextExporter.h"
+
+#include <QDateTime>
+#include <QDir>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <deque>
+#include <future>
+#include <limits>
+#include <memory>
+#include <vector>
+
+namespace {
+	auto constexpr CHUNKS_PER_THREAD = 2;	// chunks in flight per formatting thread
+	auto constexpr MAX_ROW_SIZE = 160;		// upper bound of a formatted row in bytes
+	const char DIGIT_PAIRS[] =
+		"0001020304050607080910111213141516171819"
+		"2021222324252627282930313233343536373839"
+		"4041424344454647484950515253545556575859"
+		"6061626364656667686970717273747576777879"
+		"8081828384858687888990919293949596979899";
+
+	const char CSV_SAMPLES_HEADER[] = "Timestamp,IR led,Red led\n";
+	const char CSV_HEART_RATE_HEADER[] = "Timestamp,Heart Rate Raw [bpm],Heart Quantile Mean [bpm]\n";
+	const char CSV_SPO2_HEADER[] = "Timestamp,SpO2 [%],R ratio\n";
+
+	template<size_t N>
+	char * writeLiteral(char * out, const char (&text)[N]) {
+		std::memcpy(out, text, N - 1);
+		return out + N - 1;
+	}
+
+	char * writeUnsigned(char * out, quint64 value) {
+		char digits[20];
+		auto end = digits + sizeof(digits);
+		auto p = end;
+		while (value >= 100) {
+			auto pair = DIGIT_PAIRS + value % 100 * 2;
+			value /= 100;
+			*--p = pair[1];
+			*--p = pair[0];
+		}
+		if (value >= 10) {
+			auto pair = DIGIT_PAIRS + value * 2;
+			*--p = pair[1];
+			*--p = pair[0];
+		}
+		else {
+			*--p = char('0' + value);
+		}
+		std::memcpy(out, p, size_t(end - p));
+		return out + (end - p);
+	}
+
+	char * writeInt(char * out, qint64 value) {
+		if (value < 0) {
+			*out++ = '-';
+			return writeUnsigned(out, 0 - quint64(value));
+		}
+		return writeUnsigned(out, quint64(value));
+	}
+
+	char * writeTwoDigits(char * out, int value) {
+		std::memcpy(out, DIGIT_PAIRS + value * 2, 2);
+		return out + 2;
+	}
+
+	/**
+	 * Wartość pulsu w zapisie najkrótszym pozwalającym odtworzyć liczbę, tak jak w pliku .xlsx.
+	 * Wartości pulsu stanowią ok. 1% wierszy, więc alokacja QByteArray::number nie ma tu znaczenia.
+	 */
+	char * writeDouble(char * out, double value, const char * nonFinite) {
+		if (!std::isfinite(value)) {
+			auto size = std::strlen(nonFinite);
+			std::memcpy(out, nonFinite, size);
+			return out + size;
+		}
+		auto text = QByteArray::number(value, 'g', 17);
+		std::memcpy(out, text.constData(), size_t(text.size()));
+		return out + text.size();
+	}
+
+	/**
+	 * Formatowanie stempli czasowych "yyyy-MM-dd hh:mm:ss.zzz" (czas lokalny, jak w pliku .xlsx),
+	 * część bez milisekund wyznaczana jest raz na sekundę.
+	 */
+	class TimestampWriter {
+		qint64 second = std::numeric_limits<qint64>::min();
+		char prefix[32];
+		size_t prefixSize = 0;
+
+	public:
+		char * write(char * out, qint64 ms) {
+			auto s = ms >= 0 ? ms / 1000 : (ms - 999) / 1000;
+			if (s != second) {
+				second = s;
+				auto dateTime = QDateTime::fromMSecsSinceEpoch(s * 1000);
+				auto date = dateTime.date();
+				auto time = dateTime.time();
+				auto p = prefix;
+				auto year = date.year();
+				if (year >= 0 && year < 1000)
+					*p++ = '0';
+				if (year >= 0 && year < 100)
+					*p++ = '0';
+				if (year >= 0 && year < 10)
+					*p++ = '0';
+				p = writeInt(p, year);
+				*p++ = '-';
+				p = writeTwoDigits(p, date.month());
+				*p++ = '-';
+				p = writeTwoDigits(p, date.day());
+				*p++ = ' ';
+				p = writeTwoDigits(p, time.hour());
+				*p++ = ':';
+				p = writeTwoDigits(p, time.minute());
+				*p++ = ':';
+				p = writeTwoDigits(p, time.second());
+				*p++ = '.';
+				prefixSize = size_t(p - prefix);
+			}
+			std::memcpy(out, prefix, prefixSize);
+			out += prefixSize;
+			auto milli = int(ms - s * 1000);
+			*out++ = char('0' + milli / 100);
+			return writeTwoDigits(out, milli % 100);
+		}
+	};
+
+	char * formatSamples(const DataSnapshot & snapshot, TextExporter::Format format, size_t begin, size_t end,
+		char * out)
+	{
+		TimestampWriter timestamp;
+		auto & samples = snapshot.sensorData;
+		for (auto i = begin; i < end; ++i) {
+			if (format == TextExporter::CSV) {
+				out = timestamp.write(out, samples.getMs(i));
+				*out++ = ',';
+				out = writeInt(out, samples.getIrLed(i));
+				*out++ = ',';
+				out = writeInt(out, samples.getRedLed(i));
+			}
+			else {
+				out = writeLiteral(out, "{\"timestamp\":\"");
+				out = timestamp.write(out, samples.getMs(i));
+				out = writeLiteral(out, "\",\"ir\":");
+				out = writeInt(out, samples.getIrLed(i));
+				out = writeLiteral(out, ",\"red\":");
+				out = writeInt(out, samples.getRedLed(i));
+				*out++ = '}';
+			}
+			*out++ = '\n';
+		}
+		return out;
+	}
+
+	char * formatHeartRates(const DataSnapshot & snapshot, TextExporter::Format format, size_t begin, size_t end,
+		char * out)
+	{
+		TimestampWriter timestamp;
+		for (auto i = begin; i < end; ++i) {
+			auto ms = snapshot.heartRate[i].getEndMs();
+			if (format == TextExporter::CSV) {
+				out = timestamp.write(out, ms);
+				*out++ = ',';
+				out = writeDouble(out, snapshot.heartRateRaw[i].getHR(), "");
+				*out++ = ',';
+				out = writeDouble(out, snapshot.heartRate[i].getHR(), "");
+			}
+			else {
+				out = writeLiteral(out, "{\"timestamp\":\"");
+				out = timestamp.write(out, ms);
+				out = writeLiteral(out, "\",\"hr_raw\":");
+				out = writeDouble(out, snapshot.heartRateRaw[i].getHR(), "null");
+				out = writeLiteral(out, ",\"hr_mean\":");
+				out = writeDouble(out, snapshot.heartRate[i].getHR(), "null");
+				*out++ = '}';
+			}
+			*out++ = '\n';
+		}
+		return out;
+	}
+
+	char * formatSpO2(const DataSnapshot & snapshot, TextExporter::Format format, size_t begin, size_t end,
+		char * out)
+	{
+		TimestampWriter timestamp;
+		for (auto i = begin; i < end; ++i) {
+			auto & spo2 = snapshot.spo2[i];
+			if (format == TextExporter::CSV) {
+				out = timestamp.write(out, spo2.getMs());
+				*out++ = ',';
+				out = writeDouble(out, spo2.getSpO2(), "");
+				*out++ = ',';
+				out = writeDouble(out, spo2.getRatio(), "");
+			}
+			else {
+				out = writeLiteral(out, "{\"timestamp\":\"");
+				out = timestamp.write(out, spo2.getMs());
+				out = writeLiteral(out, "\",\"spo2\":");
+				out = writeDouble(out, spo2.getSpO2(), "null");
+				out = writeLiteral(out, ",\"ratio\":");
+				out = writeDouble(out, spo2.getRatio(), "null");
+				*out++ = '}';
+			}
+			*out++ = '\n';
+		}
+		return out;
+	}
+
+	QString siblingPath(const QString & path, const QString & suffix) {
+		QFileInfo info(path);
+		auto name = info.completeBaseName() + suffix;
+		if (!info.suffix().isEmpty())
+			name += "." + info.suffix();
+		return info.dir().filePath(name);
+	}
+
+	using RowFormatter = std::function<char *(size_t begin, size_t end, char * out)>;
+
+	/**
+	 * Bufor jednej paczki wierszy, używany ponownie dla kolejnych paczek.
+	 */
+	struct Chunk {
+		std::vector<char> buffer;
+		size_t size = 0;
+		size_t rows = 0;
+	};
+
+	/**
+	 * Zapis paczek wierszy do plików wraz z postępem i sprawdzaniem przerwania.
+	 */
+	class ChunkWriter {
+		QThreadPool * pool;
+		const std::function<void(int)> & progress;
+		const std::atomic<bool> * cancelled;
+		size_t totalRows;
+		size_t doneRows = 0;
+		int percent = -1;
+		std::vector<std::shared_ptr<Chunk>> spare;
+
+		std::shared_ptr<Chunk> takeChunk() {
+			if (spare.empty())
+				return std::make_shared<Chunk>();
+			auto chunk = std::move(spare.back());
+			spare.pop_back();
+			return chunk;
+		}
+
+	public:
+		ChunkWriter(QThreadPool * pool_, size_t totalRows_, const std::function<void(int)> & progress_,
+			const std::atomic<bool> * cancelled_)
+			: pool(pool_), progress(progress_), cancelled(cancelled_), totalRows(std::max<size_t>(totalRows_, 1))
+		{
+		}
+
+		/**
+		 * Zapisuje wiersze [0, rows) sformatowane przez format.
+		 * @return false jeżeli zapis się nie powiódł lub został przerwany.
+		 */
+		bool write(QSaveFile & file, size_t rows, const RowFormatter & format) {
+			auto inFlight = size_t(std::max(1, pool->maxThreadCount()) * CHUNKS_PER_THREAD);
+			std::deque<std::pair<std::shared_ptr<Chunk>, std::future<void>>> pending;
+			size_t next = 0;
+			auto submit = [&] {
+				auto begin = next;
+				auto end = std::min(rows, begin + TEXT_EXPORT_CHUNK_ROWS);
+				next = end;
+				auto chunk = takeChunk();
+				auto task = std::make_shared<std::packaged_task<void()>>([chunk, begin, end, &format] {
+					// grows only for the first chunks, later ones reuse the memory
+					chunk->buffer.resize((end - begin) * MAX_ROW_SIZE);
+					chunk->size = size_t(format(begin, end, chunk->buffer.data()) - chunk->buffer.data());
+					chunk->rows = end - begin;
+				});
+				pending.emplace_back(chunk, task->get_future());
+				pool->start([task] { (*task)(); });
+			};
+
+			while (next < rows && pending.size() < inFlight)
+				submit();
+			auto ok = true;
+			while (!pending.empty()) {
+				// every task has to finish before returning, they reference the snapshot
+				auto chunk = std::move(pending.front().first);
+				pending.front().second.get();
+				pending.pop_front();
+				if (ok) {
+					ok = file.write(chunk->buffer.data(), qint64(chunk->size)) == qint64(chunk->size)
+						&& !(cancelled && *cancelled);
+				}
+				auto chunkRows = chunk->rows;
+				spare.push_back(std::move(chunk));
+				if (ok) {
+					if (next < rows)
+						submit();
+					reportProgress(chunkRows);
+				}
+			}
+			return ok;
+		}
+
+		void reportProgress(size_t rows) {
+			doneRows += rows;
+			auto p = int(std::min(doneRows, totalRows) * 100 / totalRows);
+			if (p != percent && progress) {
+				percent = p;
+				progress(percent);
+			}
+		}
+	};
+}
+
+bool TextExporter::formatFor(const QString & path, Format & format) {
+	auto suffix = QFileInfo(path).suffix().toLower();
+	if (suffix == "csv")
+		format = CSV;
+	else if (suffix == "ndjson" || suffix == "jsonl")
+		format = NDJSON;
+	else
+		return false;
+	return true;
+}
+
+QString TextExporter::heartRatePath(const QString & path) {
+	return siblingPath(path, "_heart_rate");
+}
+
+QString TextExporter::spo2Path(const QString & path) {
+	return siblingPath(path, "_spo2");
+}
+
+bool TextExporter::write(const DataSnapshot & snapshot, const QString & path, Format format,
+	const std::function<void(int)> & progress, const std::atomic<bool> * cancelled, QThreadPool * pool)
+{
+	if (pool == nullptr)
+		pool = QThreadPool::globalInstance();
+
+	// chunks are large already, the QFileDevice buffer would only copy them
+	QSaveFile samplesFile(path);
+	QSaveFile heartRateFile(heartRatePath(path));
+	QSaveFile spo2File(spo2Path(path));
+	if (!samplesFile.open(QIODevice::WriteOnly | QIODevice::Unbuffered)
+		|| !heartRateFile.open(QIODevice::WriteOnly | QIODevice::Unbuffered)
+		|| !spo2File.open(QIODevice::WriteOnly | QIODevice::Unbuffered))
+		return false;
+
+	auto samples = snapshot.sensorData.size();
+	auto heartRates = std::min(snapshot.heartRate.size(), snapshot.heartRateRaw.size());
+	auto spo2 = snapshot.spo2.size();
+	ChunkWriter writer(pool, samples + heartRates + spo2, progress, cancelled);
+
+	auto ok = true;
+	if (format == CSV) {
+		ok = samplesFile.write(CSV_SAMPLES_HEADER, sizeof(CSV_SAMPLES_HEADER) - 1) > 0
+			&& heartRateFile.write(CSV_HEART_RATE_HEADER, sizeof(CSV_HEART_RATE_HEADER) - 1) > 0
+			&& spo2File.write(CSV_SPO2_HEADER, sizeof(CSV_SPO2_HEADER) - 1) > 0;
+	}
+	ok = ok && writer.write(samplesFile, samples, [&snapshot, format](size_t begin, size_t end, char * out) {
+		return formatSamples(snapshot, format, begin, end, out);
+	});
+	ok = ok && writer.write(heartRateFile, heartRates, [&snapshot, format](size_t begin, size_t end, char * out) {
+		return formatHeartRates(snapshot, format, begin, end, out);
+	});
+	ok = ok && writer.write(spo2File, spo2, [&snapshot, format](size_t begin, size_t end, char * out) {
+		return formatSpO2(snapshot, format, begin, end, out);
+	});
+	if (!ok) {
+		samplesFile.cancelWriting();
+		heartRateFile.cancelWriting();
+		spo2File.cancelWriting();
+		samplesFile.commit();
+		heartRateFile.commit();
+		spo2File.commit();
+		return false;
+	}
+
+	if (!spo2File.commit() || !heartRateFile.commit() || !samplesFile.commit())
+		return false;
+	if (progress)
+		progress(100);
+	return true;
+}
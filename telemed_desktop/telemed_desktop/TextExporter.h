@@ -0,0 +1,74 @@
+#pragma once
+#include <QString>
+#include <QThreadPool>
+#include <atomic>
+#include <functional>
+#include "DataSnapshot.h"
+
+auto constexpr TEXT_EXPORT_CHUNK_ROWS = 1 << 15;		/**< Liczba wierszy formatowanych w jednym zadaniu puli wątków. */
+
+/**
+ * Zapis migawki danych do plików tekstowych CSV lub NDJSON, np. dla narzędzi analitycznych.
+ *
+ * Próbki zapisywane są do wskazanego pliku, wartości pulsu do pliku obok, z przyrostkiem "_heart_rate"
+ * (TextExporter::heartRatePath), a oszacowania saturacji z przyrostkiem "_spo2" (TextExporter::spo2Path).
+ * Kolumny są takie same jak w arkuszach pliku .xlsx:
+ *	- CSV: wiersz nagłówków, następnie "Timestamp,IR led,Red led",
+ *	  "Timestamp,Heart Rate Raw [bpm],Heart Quantile Mean [bpm]" lub "Timestamp,SpO2 [%],R ratio",
+ *	- NDJSON: jeden obiekt na wiersz, {"timestamp":...,"ir":...,"red":...},
+ *	  {"timestamp":...,"hr_raw":...,"hr_mean":...} lub {"timestamp":...,"spo2":...,"ratio":...},
+ *	  wartość nieskończona zapisywana jest jako null.
+ *
+ * Wiersze formatowane są równolegle w paczkach po TEXT_EXPORT_CHUNK_ROWS w puli wątków, bezpośrednio
+ * do wielokrotnie używanych buforów, bez alokacji na wiersz. Gotowe paczki zapisywane są w kolejności,
+ * w wątku wywołującym, podczas gdy pula formatuje kolejne.
+ */
+class TextExporter {
+public:
+	/**
+	 * Format pliku.
+	 */
+	enum Format {
+		CSV,
+		NDJSON
+	};
+
+	/**
+	 * Wyznacza format pliku na podstawie rozszerzenia (.csv, .ndjson lub .jsonl).
+	 * @param path Ścieżka do pliku.
+	 * @param format Wyznaczony format.
+	 * @return false jeżeli rozszerzenie nie odpowiada żadnemu formatowi tekstowemu.
+	 */
+	static bool formatFor(const QString & path, Format & format);
+
+	/**
+	 * Getter.
+	 * @param path Ścieżka do pliku z próbkami.
+	 * @return Ścieżka do pliku z wartościami pulsu.
+	 */
+	static QString heartRatePath(const QString & path);
+
+	/**
+	 * Getter.
+	 * @param path Ścieżka do pliku z próbkami.
+	 * @return Ścieżka do pliku z oszacowaniami saturacji krwi tlenem.
+	 */
+	static QString spo2Path(const QString & path);
+
+	/**
+	 * Zapisuje migawkę danych w bieżącym wątku, formatując wiersze w puli wątków.
+	 * Pliki zapisywane są przez QSaveFile, więc przerwany zapis nie narusza istniejących plików.
+	 * @param snapshot Migawka danych.
+	 * @param path Ścieżka do pliku z próbkami.
+	 * @param format Format plików.
+	 * @param progress Funkcja wywoływana przy zmianie postępu (0-100), może być pusta.
+	 * @param cancelled Flaga przerwania zapisu, może być pusta.
+	 * @param pool Pula wątków formatujących, domyślnie QThreadPool::globalInstance().
+	 * Wątek wywołujący nie może należeć do tej puli.
+	 * @return false jeżeli zapis się nie powiódł lub został przerwany.
+	 */
+	static bool write(const DataSnapshot & snapshot, const QString & path, Format format,
+		const std::function<void(int)> & progress = nullptr,
+		const std::atomic<bool> * cancelled = nullptr,
+		QThreadPool * pool = nullptr);
+};
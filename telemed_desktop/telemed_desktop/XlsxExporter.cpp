@@ -0,0 +1,399 @@
+#include "XlsxExporter.h"
+
+#include <QDateTime>
+#include <algorithm>
+#include <array>
+#include "TextExporter.h"
+#include "ZipWriter.h"
+
+namespace {
+	auto constexpr FLUSH_SIZE = 1 << 16;		// bytes buffered before writing to the archive
+	auto constexpr CANCEL_CHECK_ROWS = 4096;
+	const QString TIMESTAMP_FORMAT = "yyyy-MM-dd hh:mm:ss";
+	const char XML_HEADER[] = "<?xml version=\"1.0\" encoding=\"UTF-8\" standalone=\"yes\"?>\n";
+	const char MAIN_NS[] = "http://schemas.openxmlformats.org/spreadsheetml/2006/main";
+	const char REL_NS[] = "http://schemas.openxmlformats.org/officeDocument/2006/relationships";
+	const char PKG_REL_NS[] = "http://schemas.openxmlformats.org/package/2006/relationships";
+	const char COLUMNS[] = { 'A', 'B', 'C' };
+
+	/**
+	 * Arkusz, czyli tytuł, nagłówki kolumn i zakres wierszy danych.
+	 */
+	struct Sheet {
+		enum Kind {
+			HEART_RATE,
+			RAW_DATA,
+			SPO2
+		};
+
+		QByteArray name;
+		Kind kind;
+		size_t begin;
+		size_t end;
+	};
+
+	const std::array<QByteArray, 3> HEART_RATE_HEADERS = { "Timestamp", "Heart Rate Raw [bpm]", "Heart Quantile Mean [bpm]" };
+	const std::array<QByteArray, 3> RAW_DATA_HEADERS = { "Timestamp", "IR led", "Red led" };
+	const std::array<QByteArray, 3> SPO2_HEADERS = { "Timestamp", "SpO2 [%]", "R ratio" };
+
+	/**
+	 * Formatowanie stempli czasowych, część bez milisekund wyznaczana jest raz na sekundę.
+	 */
+	class TimestampFormatter {
+		qint64 second = -1;
+		QByteArray prefix;
+
+	public:
+		QByteArray format(qint64 ms) {
+			auto s = ms >= 0 ? ms / 1000 : (ms - 999) / 1000;
+			if (s != second) {
+				second = s;
+				prefix = QDateTime::fromMSecsSinceEpoch(s * 1000).toString(TIMESTAMP_FORMAT).toLatin1() + '.';
+			}
+			auto milli = int(ms - s * 1000);
+			return prefix + char('0' + milli / 100) + char('0' + milli / 10 % 10) + char('0' + milli % 10);
+		}
+	};
+
+	/**
+	 * Zapis kolejnych części dokumentu wraz z postępem i sprawdzaniem przerwania.
+	 */
+	class Writer {
+		ZipWriter & zip;
+		QByteArray buffer;
+		const std::function<void(int)> & progress;
+		const std::atomic<bool> * cancelled;
+		size_t totalRows;
+		size_t doneRows = 0;
+		int percent = -1;
+
+	public:
+		Writer(ZipWriter & zip_, size_t totalRows_, const std::function<void(int)> & progress_,
+			const std::atomic<bool> * cancelled_)
+			: zip(zip_), progress(progress_), cancelled(cancelled_), totalRows(std::max<size_t>(totalRows_, 1))
+		{
+			buffer.reserve(FLUSH_SIZE + 1024);
+		}
+
+		QByteArray & out() {
+			return buffer;
+		}
+
+		void flush() {
+			zip.write(buffer);
+			buffer.clear();
+		}
+
+		/**
+		 * @return false jeżeli zapis został przerwany.
+		 */
+		bool rowDone() {
+			if (buffer.size() >= FLUSH_SIZE)
+				flush();
+			if (++doneRows % CANCEL_CHECK_ROWS != 0)
+				return true;
+			auto p = int(doneRows * 100 / totalRows);
+			if (p != percent && progress) {
+				percent = p;
+				progress(percent);
+			}
+			return !(cancelled && *cancelled);
+		}
+
+		void entry(const QString & name, const QByteArray & content) {
+			zip.beginEntry(name);
+			zip.write(content);
+			zip.endEntry();
+		}
+	};
+
+	/**
+	 * Dopisuje arkusze serii o podanej liczbie wierszy danych, co najmniej jeden, nawet pusty.
+	 * Wiersze nie mieszczące się w arkuszu trafiają do kolejnych arkuszy "nazwa 2", "nazwa 3" itd.
+	 */
+	void appendSheets(std::vector<Sheet> & sheets, const QByteArray & name, Sheet::Kind kind, size_t rows) {
+		size_t begin = 0;
+		auto part = 1;
+		do {
+			auto end = std::min<size_t>(rows, begin + XLSX_MAX_ROWS - 1);
+			auto sheetName = name;
+			if (part > 1)
+				sheetName += ' ' + QByteArray::number(part);
+			sheets.push_back({ sheetName, kind, begin, end });
+			begin = end;
+			++part;
+		} while (begin < rows);
+	}
+
+	std::vector<Sheet> sheetsFor(const DataSnapshot & snapshot) {
+		std::vector<Sheet> sheets;
+		auto heartRates = std::min(snapshot.heartRate.size(), snapshot.heartRateRaw.size());
+		appendSheets(sheets, "Heart rate", Sheet::HEART_RATE, heartRates);
+		appendSheets(sheets, "Raw data", Sheet::RAW_DATA, snapshot.sensorData.size());
+		appendSheets(sheets, "SpO2", Sheet::SPO2, snapshot.spo2.size());
+		return sheets;
+	}
+
+	qint64 rowMs(const DataSnapshot & snapshot, const Sheet & sheet, size_t i) {
+		switch (sheet.kind) {
+		case Sheet::HEART_RATE:
+			return snapshot.heartRate[i].getEndMs();
+		case Sheet::SPO2:
+			return snapshot.spo2[i].getMs();
+		default:
+			return snapshot.sensorData.getMs(i);
+		}
+	}
+
+	const std::array<QByteArray, 3> & headers(const Sheet & sheet) {
+		switch (sheet.kind) {
+		case Sheet::HEART_RATE:
+			return HEART_RATE_HEADERS;
+		case Sheet::SPO2:
+			return SPO2_HEADERS;
+		default:
+			return RAW_DATA_HEADERS;
+		}
+	}
+
+	void appendCell(QByteArray & out, char column, const QByteArray & row, const QByteArray & value, bool string) {
+		out += "<c r=\"";
+		out += column;
+		out += row;
+		out += string ? "\" t=\"s\"><v>" : "\"><v>";
+		out += value;
+		out += "</v></c>";
+	}
+
+	void appendInlineString(QByteArray & out, char column, const QByteArray & row, const QByteArray & value) {
+		out += "<c r=\"";
+		out += column;
+		out += row;
+		out += "\" t=\"inlineStr\"><is><t>";
+		out += value;
+		out += "</t></is></c>";
+	}
+
+	/**
+	 * Tablica współdzielonych napisów, zawiera wyłącznie nagłówki kolumn.
+	 */
+	struct SharedStrings {
+		std::vector<QByteArray> strings;
+		quint64 count = 0;
+
+		QByteArray index(const QByteArray & value) {
+			++count;
+			auto it = std::find(strings.begin(), strings.end(), value);
+			if (it == strings.end())
+				it = strings.insert(strings.end(), value);
+			return QByteArray::number(int(it - strings.begin()));
+		}
+	};
+
+	/**
+	 * Zapisuje arkusz. Nagłówki zapisywane są jako indeksy tablicy współdzielonych napisów, a stemple czasowe,
+	 * unikalne w każdym wierszu, bezpośrednio w komórkach, aby nie powielać ich w tablicy.
+	 */
+	bool writeSheet(Writer & writer, const DataSnapshot & snapshot, const Sheet & sheet, SharedStrings & strings) {
+		auto & out = writer.out();
+		auto rows = sheet.end - sheet.begin + 1;
+		out += XML_HEADER;
+		out += "<worksheet xmlns=\"" + QByteArray(MAIN_NS) + "\" xmlns:r=\"" + REL_NS + "\">";
+		out += "<dimension ref=\"A1:C" + QByteArray::number(quint64(rows)) + "\"/><sheetData>";
+
+		out += "<row r=\"1\">";
+		for (size_t c = 0; c < headers(sheet).size(); ++c)
+			appendCell(out, COLUMNS[c], "1", strings.index(headers(sheet)[c]), true);
+		out += "</row>";
+
+		TimestampFormatter timestamp;
+		auto r = 2;
+		for (auto i = sheet.begin; i < sheet.end; ++i, ++r) {
+			auto row = QByteArray::number(r);
+			out += "<row r=\"" + row + "\">";
+			appendInlineString(out, 'A', row, timestamp.format(rowMs(snapshot, sheet, i)));
+			switch (sheet.kind) {
+			case Sheet::HEART_RATE:
+				appendCell(out, 'B', row, QByteArray::number(snapshot.heartRateRaw[i].getHR(), 'g', 17), false);
+				appendCell(out, 'C', row, QByteArray::number(snapshot.heartRate[i].getHR(), 'g', 17), false);
+				break;
+			case Sheet::SPO2:
+				appendCell(out, 'B', row, QByteArray::number(snapshot.spo2[i].getSpO2(), 'g', 17), false);
+				appendCell(out, 'C', row, QByteArray::number(snapshot.spo2[i].getRatio(), 'g', 17), false);
+				break;
+			default:
+				appendCell(out, 'B', row, QByteArray::number(snapshot.sensorData.getIrLed(i)), false);
+				appendCell(out, 'C', row, QByteArray::number(snapshot.sensorData.getRedLed(i)), false);
+			}
+			out += "</row>";
+			if (!writer.rowDone())
+				return false;
+		}
+		out += "</sheetData></worksheet>";
+		writer.flush();
+		return true;
+	}
+
+	void writeSharedStrings(Writer & writer, const SharedStrings & strings) {
+		auto & out = writer.out();
+		out += XML_HEADER;
+		out += "<sst xmlns=\"" + QByteArray(MAIN_NS) + "\" count=\"" + QByteArray::number(strings.count)
+			+ "\" uniqueCount=\"" + QByteArray::number(quint64(strings.strings.size())) + "\">";
+		for (auto & value : strings.strings)
+			out += "<si><t>" + value + "</t></si>";
+		out += "</sst>";
+		writer.flush();
+	}
+
+	void writePackageParts(Writer & writer, const std::vector<Sheet> & sheets) {
+		auto sheetCount = QByteArray::number(int(sheets.size()));
+		QByteArray contentTypes = XML_HEADER;
+		contentTypes += "<Types xmlns=\"http://schemas.openxmlformats.org/package/2006/content-types\">"
+			"<Default Extension=\"rels\" ContentType=\"application/vnd.openxmlformats-package.relationships+xml\"/>"
+			"<Default Extension=\"xml\" ContentType=\"application/xml\"/>"
+			"<Override PartName=\"/xl/workbook.xml\" ContentType=\"application/vnd.openxmlformats-officedocument.spreadsheetml.sheet.main+xml\"/>"
+			"<Override PartName=\"/xl/styles.xml\" ContentType=\"application/vnd.openxmlformats-officedocument.spreadsheetml.styles+xml\"/>"
+			"<Override PartName=\"/xl/sharedStrings.xml\" ContentType=\"application/vnd.openxmlformats-officedocument.spreadsheetml.sharedStrings+xml\"/>"
+			"<Override PartName=\"/docProps/core.xml\" ContentType=\"application/vnd.openxmlformats-package.core-properties+xml\"/>"
+			"<Override PartName=\"/docProps/app.xml\" ContentType=\"application/vnd.openxmlformats-officedocument.extended-properties+xml\"/>";
+		for (size_t i = 1; i <= sheets.size(); ++i)
+			contentTypes += "<Override PartName=\"/xl/worksheets/sheet" + QByteArray::number(int(i))
+				+ ".xml\" ContentType=\"application/vnd.openxmlformats-officedocument.spreadsheetml.worksheet+xml\"/>";
+		contentTypes += "</Types>";
+		writer.entry("[Content_Types].xml", contentTypes);
+
+		QByteArray rels = XML_HEADER;
+		rels += "<Relationships xmlns=\"" + QByteArray(PKG_REL_NS) + "\">"
+			"<Relationship Id=\"rId1\" Type=\"" + REL_NS + "/officeDocument\" Target=\"xl/workbook.xml\"/>"
+			"<Relationship Id=\"rId2\" Type=\"http://schemas.openxmlformats.org/package/2006/relationships/metadata/core-properties\" Target=\"docProps/core.xml\"/>"
+			"<Relationship Id=\"rId3\" Type=\"" + REL_NS + "/extended-properties\" Target=\"docProps/app.xml\"/>"
+			"</Relationships>";
+		writer.entry("_rels/.rels", rels);
+
+		QByteArray app = XML_HEADER;
+		app += "<Properties xmlns=\"http://schemas.openxmlformats.org/officeDocument/2006/extended-properties\" "
+			"xmlns:vt=\"http://schemas.openxmlformats.org/officeDocument/2006/docPropsVTypes\">"
+			"<Application>Microsoft Excel</Application><DocSecurity>0</DocSecurity><ScaleCrop>false</ScaleCrop>"
+			"<HeadingPairs><vt:vector size=\"2\" baseType=\"variant\">"
+			"<vt:variant><vt:lpstr>Worksheets</vt:lpstr></vt:variant>"
+			"<vt:variant><vt:i4>" + sheetCount + "</vt:i4></vt:variant></vt:vector></HeadingPairs>"
+			"<TitlesOfParts><vt:vector size=\"" + sheetCount + "\" baseType=\"lpstr\">";
+		for (auto & sheet : sheets)
+			app += "<vt:lpstr>" + sheet.name + "</vt:lpstr>";
+		app += "</vt:vector></TitlesOfParts><AppVersion>12.0000</AppVersion></Properties>";
+		writer.entry("docProps/app.xml", app);
+
+		QByteArray core = XML_HEADER;
+		auto created = QDateTime::currentDateTimeUtc().toString(Qt::ISODate).toLatin1();
+		core += "<cp:coreProperties xmlns:cp=\"http://schemas.openxmlformats.org/package/2006/metadata/core-properties\" "
+			"xmlns:dc=\"http://purl.org/dc/elements/1.1/\" xmlns:dcterms=\"http://purl.org/dc/terms/\" "
+			"xmlns:dcmitype=\"http://purl.org/dc/dcmitype/\" xmlns:xsi=\"http://www.w3.org/2001/XMLSchema-instance\">"
+			"<dc:creator>telemed</dc:creator>"
+			"<dcterms:created xsi:type=\"dcterms:W3CDTF\">" + created + "</dcterms:created>"
+			"<dcterms:modified xsi:type=\"dcterms:W3CDTF\">" + created + "</dcterms:modified>"
+			"</cp:coreProperties>";
+		writer.entry("docProps/core.xml", core);
+
+		QByteArray workbook = XML_HEADER;
+		workbook += "<workbook xmlns=\"" + QByteArray(MAIN_NS) + "\" xmlns:r=\"" + REL_NS + "\"><sheets>";
+		for (size_t i = 1; i <= sheets.size(); ++i) {
+			auto id = QByteArray::number(int(i));
+			workbook += "<sheet name=\"" + sheets[i - 1].name + "\" sheetId=\"" + id + "\" r:id=\"rId" + id + "\"/>";
+		}
+		workbook += "</sheets></workbook>";
+		writer.entry("xl/workbook.xml", workbook);
+
+		QByteArray workbookRels = XML_HEADER;
+		workbookRels += "<Relationships xmlns=\"" + QByteArray(PKG_REL_NS) + "\">";
+		for (size_t i = 1; i <= sheets.size(); ++i) {
+			auto id = QByteArray::number(int(i));
+			workbookRels += "<Relationship Id=\"rId" + id + "\" Type=\"" + REL_NS
+				+ "/worksheet\" Target=\"worksheets/sheet" + id + ".xml\"/>";
+		}
+		workbookRels += "<Relationship Id=\"rId" + QByteArray::number(int(sheets.size() + 1)) + "\" Type=\""
+			+ REL_NS + "/styles\" Target=\"styles.xml\"/>";
+		workbookRels += "<Relationship Id=\"rId" + QByteArray::number(int(sheets.size() + 2)) + "\" Type=\""
+			+ REL_NS + "/sharedStrings\" Target=\"sharedStrings.xml\"/>";
+		workbookRels += "</Relationships>";
+		writer.entry("xl/_rels/workbook.xml.rels", workbookRels);
+
+		QByteArray styles = XML_HEADER;
+		styles += "<styleSheet xmlns=\"" + QByteArray(MAIN_NS) + "\">"
+			"<fonts count=\"1\"><font><sz val=\"11\"/><name val=\"Calibri\"/></font></fonts>"
+			"<fills count=\"2\"><fill><patternFill patternType=\"none\"/></fill>"
+			"<fill><patternFill patternType=\"gray125\"/></fill></fills>"
+			"<borders count=\"1\"><border><left/><right/><top/><bottom/><diagonal/></border></borders>"
+			"<cellStyleXfs count=\"1\"><xf numFmtId=\"0\" fontId=\"0\" fillId=\"0\" borderId=\"0\"/></cellStyleXfs>"
+			"<cellXfs count=\"1\"><xf numFmtId=\"0\" fontId=\"0\" fillId=\"0\" borderId=\"0\" xfId=\"0\"/></cellXfs>"
+			"<cellStyles count=\"1\"><cellStyle name=\"Normal\" xfId=\"0\" builtinId=\"0\"/></cellStyles>"
+			"</styleSheet>";
+		writer.entry("xl/styles.xml", styles);
+	}
+}
+
+XlsxExporter::XlsxExporter(QObject * parent)
+	: QObject(parent),
+	strand(&pool)
+{
+	pool.setMaxThreadCount(1);
+}
+
+XlsxExporter::~XlsxExporter() {
+	cancelled = true;
+	strand.close();
+}
+
+bool XlsxExporter::start(DataSnapshot snapshot, const QString & path) {
+	if (running.exchange(true))
+		return false;
+	cancelled = false;
+	auto shared = std::make_shared<DataSnapshot>(std::move(snapshot));
+	strand.post([this, shared, path] {
+		auto progress = [this](int percent) {
+			emit progressChanged(percent);
+		};
+		TextExporter::Format format;
+		auto ok = TextExporter::formatFor(path, format)
+			? TextExporter::write(*shared, path, format, progress, &cancelled)
+			: write(*shared, path, progress, &cancelled);
+		running = false;
+		emit finished(ok, shared->revision);
+	});
+	return true;
+}
+
+void XlsxExporter::cancel() {
+	cancelled = true;
+}
+
+bool XlsxExporter::write(const DataSnapshot & snapshot, const QString & path,
+	const std::function<void(int)> & progress, const std::atomic<bool> * cancelled)
+{
+	ZipWriter zip;
+	if (!zip.open(path))
+		return false;
+
+	auto sheets = sheetsFor(snapshot);
+	size_t dataRows = 0;
+	for (auto & sheet : sheets)
+		dataRows += sheet.end - sheet.begin;
+	Writer writer(zip, dataRows, progress, cancelled);
+
+	SharedStrings strings;
+	for (size_t i = 0; i < sheets.size(); ++i) {
+		zip.beginEntry(QString("xl/worksheets/sheet%1.xml").arg(i + 1));
+		if (!writeSheet(writer, snapshot, sheets[i], strings)) {
+			zip.cancel();
+			return false;
+		}
+	}
+	zip.beginEntry("xl/sharedStrings.xml");
+	writeSharedStrings(writer, strings);
+	writePackageParts(writer, sheets);
+
+	if (!zip.commit())
+		return false;
+	if (progress)
+		progress(100);
+	return true;
+}
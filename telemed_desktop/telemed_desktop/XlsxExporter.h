@@ -0,0 +1,88 @@
+#pragma once
+#include <QObject>
+#include <QString>
+#include <QThreadPool>
+#include <atomic>
+#include <functional>
+#include "DataSnapshot.h"
+#include "SessionStrand.h"
+
+auto constexpr XLSX_MAX_ROWS = 1048576;		/**< Maksymalna liczba wierszy arkusza. */
+
+/**
+ * Klasa zapisująca migawkę danych do pliku .xlsx w wątku tła.
+ * Arkusze "Heart rate", "Raw data" oraz "SpO2" zapisywane są strumieniowo, wiersz po wierszu, bez budowania
+ * dokumentu w pamięci. Wiersze nie mieszczące się w jednym arkuszu zapisywane są w kolejnych arkuszach,
+ * np. "Raw data 2", "Raw data 3" itd. Stemple czasowe zapisywane są w komórkach jako napisy (inlineStr),
+ * a archiwum kompresowane jest przez ZipWriter. Układ arkuszy jest taki sam jak dotychczas zapisywany przez OpenXLSX,
+ * dzięki czemu plik może zostać wczytany przez SessionRecording.
+ * Pliki .csv i .ndjson zapisywane są w tym samym wątku tła przez TextExporter.
+ */
+class XlsxExporter : public QObject
+{
+	Q_OBJECT
+private:
+	QThreadPool pool;
+	SessionStrand strand;
+	std::atomic<bool> running{ false };
+	std::atomic<bool> cancelled{ false };
+
+public:
+	/**
+	 * Konstruktor inicjalizujący.
+	 * Eksport wykonywany jest we własnym wątku, aby nie zajmować puli przetwarzającej próbki.
+	 * @param parent Przodek obiektu.
+	 */
+	XlsxExporter(QObject * parent = nullptr);
+
+	/**
+	 * Destruktor, przerywa trwający eksport i czeka na jego zakończenie.
+	 */
+	~XlsxExporter();
+
+	/**
+	 * Rozpoczyna eksport w wątku tła. Po zakończeniu emitowany jest sygnał finished.
+	 * @param snapshot Migawka danych.
+	 * @param path Ścieżka do pliku .xlsx, .csv lub .ndjson.
+	 * @return false jeżeli poprzedni eksport jeszcze trwa.
+	 */
+	bool start(DataSnapshot snapshot, const QString & path);
+
+	/**
+	 * Przerywa trwający eksport, plik docelowy pozostaje niezmieniony.
+	 */
+	void cancel();
+
+	/**
+	 * Metoda sprawdzająca czy eksport trwa.
+	 */
+	bool isRunning() const {
+		return running;
+	}
+
+	/**
+	 * Zapisuje migawkę danych w bieżącym wątku.
+	 * @param snapshot Migawka danych.
+	 * @param path Ścieżka do pliku .xlsx.
+	 * @param progress Funkcja wywoływana przy zmianie postępu (0-100), może być pusta.
+	 * @param cancelled Flaga przerwania zapisu, może być pusta.
+	 * @return false jeżeli zapis się nie powiódł lub został przerwany.
+	 */
+	static bool write(const DataSnapshot & snapshot, const QString & path,
+		const std::function<void(int)> & progress = nullptr,
+		const std::atomic<bool> * cancelled = nullptr);
+
+signals:
+	/**
+	 * Sygnał emitowany przy zmianie postępu eksportu.
+	 * @param percent Postęp w procentach.
+	 */
+	void progressChanged(int percent);
+
+	/**
+	 * Sygnał emitowany po zakończeniu eksportu.
+	 * @param ok false jeżeli zapis się nie powiódł lub został przerwany.
+	 * @param revision Wersja zapisanych danych, DataSnapshot::revision.
+	 */
+	void finished(bool ok, quint64 revision);
+};
@@ -0,0 +1,278 @@
+#include "ZipWriter.h"
+
+#include <QDateTime>
+#include <QDebug>
+#include <QtEndian>
+#include <algorithm>
+#include <limits>
+#if __has_include(<QtZlib/zlib.h>)
+#include <QtZlib/zlib.h>
+#else
+#include <zlib.h>
+#endif
+#include "Crc32.h"
+
+namespace {
+	auto constexpr LOCAL_HEADER_SIGNATURE = 0x04034b50u;
+	auto constexpr CENTRAL_HEADER_SIGNATURE = 0x02014b50u;
+	auto constexpr ZIP64_END_OF_CENTRAL_DIR_SIGNATURE = 0x06064b50u;
+	auto constexpr ZIP64_END_LOCATOR_SIGNATURE = 0x07064b50u;
+	auto constexpr END_OF_CENTRAL_DIR_SIGNATURE = 0x06054b50u;
+	auto constexpr ZIP_VERSION = 45;		// 4.5, deflated entries with ZIP64 extra fields
+	auto constexpr METHOD_DEFLATE = 8;
+	auto constexpr ZIP64_EXTRA_ID = 0x0001;
+	auto constexpr LOCAL_EXTRA_SIZE = 20;	// id, length, uncompressed and compressed size
+	auto constexpr CRC_OFFSET = 14;			// of the crc field in the local header
+	auto constexpr LOCAL_HEADER_SIZE = 30;
+	auto constexpr DEFLATE_CHUNK = 1 << 16;
+	auto constexpr MAX_U16 = std::numeric_limits<quint16>::max();
+	auto constexpr MAX_U32 = std::numeric_limits<quint32>::max();
+
+	void putU16(QByteArray & out, quint16 value) {
+		char bytes[2];
+		qToLittleEndian<quint16>(value, bytes);
+		out.append(bytes, 2);
+	}
+
+	void putU32(QByteArray & out, quint32 value) {
+		char bytes[4];
+		qToLittleEndian<quint32>(value, bytes);
+		out.append(bytes, 4);
+	}
+
+	void putU64(QByteArray & out, quint64 value) {
+		char bytes[8];
+		qToLittleEndian<quint64>(value, bytes);
+		out.append(bytes, 8);
+	}
+
+	/**
+	 * Wartość pola 32-bitowego, większe wartości zapisywane są w polu rozszerzeń ZIP64.
+	 */
+	quint32 field32(quint64 value) {
+		return value >= MAX_U32 ? MAX_U32 : quint32(value);
+	}
+}
+
+/**
+ * Strumień zlib kompresujący bieżący plik, bez nagłówka zlib (surowy deflate, wymagany przez ZIP).
+ */
+struct ZipWriter::Deflater {
+	z_stream stream = {};
+	QByteArray buffer = QByteArray(DEFLATE_CHUNK, '\0');
+
+	Deflater() {
+		deflateInit2(&stream, Z_BEST_SPEED, Z_DEFLATED, -MAX_WBITS, 8, Z_DEFAULT_STRATEGY);
+	}
+
+	~Deflater() {
+		deflateEnd(&stream);
+	}
+};
+
+ZipWriter::ZipWriter()
+	: deflater(new Deflater())
+{
+}
+
+ZipWriter::~ZipWriter() = default;
+
+bool ZipWriter::open(const QString & path) {
+	entries.clear();
+	entryOpen = false;
+	failed = false;
+	file.setFileName(path);
+	if (!file.open(QIODevice::WriteOnly)) {
+		qDebug() << "Cannot create" << path << file.errorString();
+		return false;
+	}
+
+	auto now = QDateTime::currentDateTime();
+	auto date = now.date();
+	auto time = now.time();
+	dosTime = quint16((time.hour() << 11) | (time.minute() << 5) | (time.second() / 2));
+	dosDate = quint16(((date.year() - 1980) << 9) | (date.month() << 5) | date.day());
+	return true;
+}
+
+void ZipWriter::writeRaw(const QByteArray & data) {
+	if (!failed && file.write(data) != data.size())
+		failed = true;
+}
+
+void ZipWriter::deflateData(const QByteArray & data, bool finish) {
+	auto & stream = deflater->stream;
+	stream.next_in = reinterpret_cast<Bytef *>(const_cast<char *>(data.constData()));
+	stream.avail_in = uInt(data.size());
+	int result;
+	do {
+		stream.next_out = reinterpret_cast<Bytef *>(deflater->buffer.data());
+		stream.avail_out = uInt(deflater->buffer.size());
+		result = ::deflate(&stream, finish ? Z_FINISH : Z_NO_FLUSH);
+		if (result == Z_STREAM_ERROR) {
+			failed = true;
+			return;
+		}
+		auto produced = deflater->buffer.size() - int(stream.avail_out);
+		compressedSize += quint64(produced);
+		writeRaw(QByteArray::fromRawData(deflater->buffer.constData(), produced));
+	} while (stream.avail_out == 0 || (finish && result != Z_STREAM_END));
+}
+
+void ZipWriter::beginEntry(const QString & name) {
+	if (entryOpen)
+		endEntry();
+
+	Entry entry;
+	entry.name = name.toUtf8();
+	entry.offset = quint64(file.pos());
+	entries.push_back(entry);
+	entryOpen = true;
+	crc = 0;
+	entrySize = 0;
+	compressedSize = 0;
+	deflateReset(&deflater->stream);
+
+	// crc and sizes are filled in by endEntry
+	QByteArray header;
+	putU32(header, LOCAL_HEADER_SIGNATURE);
+	putU16(header, ZIP_VERSION);
+	putU16(header, 0);			// flags
+	putU16(header, METHOD_DEFLATE);
+	putU16(header, dosTime);
+	putU16(header, dosDate);
+	putU32(header, 0);			// crc
+	putU32(header, 0);			// compressed size
+	putU32(header, 0);			// uncompressed size
+	putU16(header, quint16(entry.name.size()));
+	putU16(header, LOCAL_EXTRA_SIZE);
+	header.append(entry.name);
+	// the sizes are not known yet, so room for 64-bit ones is always reserved
+	putU16(header, ZIP64_EXTRA_ID);
+	putU16(header, LOCAL_EXTRA_SIZE - 4);
+	putU64(header, 0);			// uncompressed size
+	putU64(header, 0);			// compressed size
+	writeRaw(header);
+}
+
+void ZipWriter::write(const QByteArray & data) {
+	crc = crc32(crc, data.constData(), size_t(data.size()));
+	entrySize += quint64(data.size());
+	deflateData(data, false);
+}
+
+void ZipWriter::endEntry() {
+	if (!entryOpen)
+		return;
+	entryOpen = false;
+	deflateData(QByteArray(), true);
+	auto & entry = entries.back();
+	entry.crc = crc;
+	entry.size = entrySize;
+	entry.compressedSize = compressedSize;
+
+	QByteArray fields;
+	putU32(fields, entry.crc);
+	putU32(fields, field32(entry.compressedSize));
+	putU32(fields, field32(entry.size));
+	QByteArray extraFields;
+	putU64(extraFields, entry.size);
+	putU64(extraFields, entry.compressedSize);
+	auto end = file.pos();
+	if (!file.seek(qint64(entry.offset) + CRC_OFFSET))
+		failed = true;
+	writeRaw(fields);
+	if (!file.seek(qint64(entry.offset) + LOCAL_HEADER_SIZE + entry.name.size() + 4))
+		failed = true;
+	writeRaw(extraFields);
+	if (!file.seek(end))
+		failed = true;
+}
+
+bool ZipWriter::commit() {
+	endEntry();
+	auto centralDirOffset = quint64(file.pos());
+	QByteArray centralDir;
+	for (auto & entry : entries) {
+		// only the fields which do not fit in 32 bits go to the extra field, in this order
+		QByteArray fields;
+		if (entry.size >= MAX_U32)
+			putU64(fields, entry.size);
+		if (entry.compressedSize >= MAX_U32)
+			putU64(fields, entry.compressedSize);
+		if (entry.offset >= MAX_U32)
+			putU64(fields, entry.offset);
+		QByteArray extra;
+		if (!fields.isEmpty()) {
+			putU16(extra, ZIP64_EXTRA_ID);
+			putU16(extra, quint16(fields.size()));
+			extra.append(fields);
+		}
+
+		putU32(centralDir, CENTRAL_HEADER_SIGNATURE);
+		putU16(centralDir, ZIP_VERSION);	// version made by
+		putU16(centralDir, ZIP_VERSION);	// version needed
+		putU16(centralDir, 0);				// flags
+		putU16(centralDir, METHOD_DEFLATE);
+		putU16(centralDir, dosTime);
+		putU16(centralDir, dosDate);
+		putU32(centralDir, entry.crc);
+		putU32(centralDir, field32(entry.compressedSize));
+		putU32(centralDir, field32(entry.size));
+		putU16(centralDir, quint16(entry.name.size()));
+		putU16(centralDir, quint16(extra.size()));
+		putU16(centralDir, 0);				// comment length
+		putU16(centralDir, 0);				// disk number
+		putU16(centralDir, 0);				// internal attributes
+		putU32(centralDir, 0);				// external attributes
+		putU32(centralDir, field32(entry.offset));
+		centralDir.append(entry.name);
+		centralDir.append(extra);
+	}
+
+	auto centralDirSize = quint64(centralDir.size());
+	auto zip64 = entries.size() >= MAX_U16 || centralDirOffset >= MAX_U32 || centralDirSize >= MAX_U32;
+	QByteArray end;
+	if (zip64) {
+		auto zip64EndOffset = centralDirOffset + centralDirSize;
+		putU32(end, ZIP64_END_OF_CENTRAL_DIR_SIGNATURE);
+		putU64(end, 44);					// size of the remaining record
+		putU16(end, ZIP_VERSION);			// version made by
+		putU16(end, ZIP_VERSION);			// version needed
+		putU32(end, 0);						// disk number
+		putU32(end, 0);						// disk with the central directory
+		putU64(end, entries.size());
+		putU64(end, entries.size());
+		putU64(end, centralDirSize);
+		putU64(end, centralDirOffset);
+		putU32(end, ZIP64_END_LOCATOR_SIGNATURE);
+		putU32(end, 0);						// disk with the ZIP64 end record
+		putU64(end, zip64EndOffset);
+		putU32(end, 1);						// number of disks
+	}
+	auto entryCount = quint16(std::min<size_t>(entries.size(), MAX_U16));
+	putU32(end, END_OF_CENTRAL_DIR_SIGNATURE);
+	putU16(end, 0);							// disk number
+	putU16(end, 0);							// disk with the central directory
+	putU16(end, entryCount);
+	putU16(end, entryCount);
+	putU32(end, field32(centralDirSize));
+	putU32(end, field32(centralDirOffset));
+	putU16(end, 0);							// comment length
+	writeRaw(centralDir);
+	writeRaw(end);
+
+	if (failed) {
+		qDebug() << "Cannot write" << file.fileName() << file.errorString();
+		file.cancelWriting();
+		file.commit();
+		return false;
+	}
+	return file.commit();
+}
+
+void ZipWriter::cancel() {
+	entryOpen = false;
+	file.cancelWriting();
+	file.commit();
+}
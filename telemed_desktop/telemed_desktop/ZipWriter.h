@@ -0,0 +1,85 @@
+#pragma once
+#include <QByteArray>
+#include <QSaveFile>
+#include <QString>
+#include <memory>
+#include <vector>
+
+/**
+ * Klasa zapisująca archiwum ZIP strumieniowo, plik po pliku, z kompresją deflate (zlib dostarczany z Qt).
+ * Zawartość pliku w archiwum nie musi być znana z góry, rozmiary i suma kontrolna uzupełniane są
+ * w nagłówku po zakończeniu pliku. Archiwum zapisywane jest przez QSaveFile, więc przerwany zapis
+ * nie pozostawia niepełnego pliku. Nagłówki lokalne zawierają pole rozszerzeń ZIP64, a katalog archiwum
+ * zapisywany jest w formacie ZIP64, jeżeli rozmiary lub przesunięcia przekraczają 4 GB.
+ */
+class ZipWriter {
+	struct Entry {
+		QByteArray name;
+		quint32 crc;
+		quint64 size;
+		quint64 compressedSize;
+		quint64 offset;
+	};
+
+	struct Deflater;
+
+	QSaveFile file;
+	std::vector<Entry> entries;
+	std::unique_ptr<Deflater> deflater;
+	quint16 dosTime = 0;
+	quint16 dosDate = 0;
+	bool entryOpen = false;
+	bool failed = false;
+	quint32 crc = 0;
+	quint64 entrySize = 0;
+	quint64 compressedSize = 0;
+
+	void writeRaw(const QByteArray & data);
+	void deflateData(const QByteArray & data, bool finish);
+
+public:
+	/**
+	 * Konstruktor.
+	 */
+	ZipWriter();
+
+	/**
+	 * Destruktor, porzuca niezatwierdzone archiwum.
+	 */
+	~ZipWriter();
+
+	/**
+	 * Tworzy archiwum.
+	 * @param path Ścieżka do pliku archiwum.
+	 * @return false jeżeli pliku nie udało się otworzyć.
+	 */
+	bool open(const QString & path);
+
+	/**
+	 * Rozpoczyna kolejny plik w archiwum, poprzedni plik jest kończony.
+	 * @param name Ścieżka pliku wewnątrz archiwum.
+	 */
+	void beginEntry(const QString & name);
+
+	/**
+	 * Dopisuje dane do bieżącego pliku, kompresując je.
+	 * @param data Dane.
+	 */
+	void write(const QByteArray & data);
+
+	/**
+	 * Kończy bieżący plik, uzupełniając rozmiary i sumę kontrolną w jego nagłówku.
+	 */
+	void endEntry();
+
+	/**
+	 * Zapisuje katalog archiwum i zastępuje nim plik docelowy.
+	 * @return false jeżeli którykolwiek zapis się nie powiódł.
+	 */
+	bool commit();
+
+	/**
+	 * Porzuca archiwum, plik docelowy pozostaje niezmieniony.
+	 */
+	void cancel();
+};
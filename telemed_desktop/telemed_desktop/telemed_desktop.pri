@@ -14,12 +14,63 @@ HEADERS += ./HeartRate.h \
     ./MAX30100_BeatDetector.h \
     ./MainWin.h \
     ./Data.h \
-    ./DeviceApi.h
+    ./DeviceApi.h \
+    ./SensorDataStore.h \
+    ./SlidingMinMax.h \
+    ./StreamingTrimmedMean.h \
+    ./SensorFrame.h \
+    ./SignalPipeline.h \
+    ./SpscQueue.h \
+    ./DataWorker.h \
+    ./SessionStrand.h \
+    ./SyntheticPpg.h \
+    ./RawCapture.h \
+    ./Clock.h \
+    ./SessionRecording.h \
+    ./ReplayEngine.h \
+    ./DataSnapshot.h \
+    ./ZipWriter.h \
+    ./XlsxExporter.h \
+    ./Crc32.h \
+    ./SessionJournal.h \
+    ./SessionArchive.h \
+    ./TextExporter.h \
+    ./MinMaxPyramid.h \
+    ./HeartRateTableModel.h \
+    ./RenderScheduler.h \
+    ./DualBiquadCascade.h \
+    ./SpO2.h \
+    ./SpO2Estimator.h \
+    ./LatencyHistogram.h \
+    ./LatencyMonitor.h \
+    ./SessionJournalWorker.h
 SOURCES += ./Data.cpp \
     ./DeviceApi.cpp \
     ./main.cpp \
     ./MainWin.cpp \
     ./MAX30100_BeatDetector.cpp \
-    ./ObjectFactory.cpp
+    ./ObjectFactory.cpp \
+    ./SensorDataStore.cpp \
+    ./StreamingTrimmedMean.cpp \
+    ./SensorFrame.cpp \
+    ./SignalPipeline.cpp \
+    ./DataWorker.cpp \
+    ./SessionStrand.cpp \
+    ./SyntheticPpg.cpp \
+    ./RawCapture.cpp \
+    ./SessionRecording.cpp \
+    ./ReplayEngine.cpp \
+    ./ZipWriter.cpp \
+    ./XlsxExporter.cpp \
+    ./SessionJournal.cpp \
+    ./SessionArchive.cpp \
+    ./TextExporter.cpp \
+    ./HeartRateTableModel.cpp \
+    ./RenderScheduler.cpp \
+    ./DualBiquadCascade.cpp \
+    ./SpO2Estimator.cpp \
+    ./LatencyHistogram.cpp \
+    ./LatencyMonitor.cpp \
+    ./SessionJournalWorker.cpp
 FORMS += ./MainWin.ui
 RESOURCES += MainWin.qrc
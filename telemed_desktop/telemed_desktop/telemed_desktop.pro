@@ -6,6 +6,7 @@ TEMPLATE = app
 TARGET = telemed_desktop
 DESTDIR = ../Release
 CONFIG += release
+QT += core gui network printsupport widgets websockets
 LIBS += -L"../../../../../libs/OpenXLSX-master/lib" \
     -L"../../../../../libs/iir/lib" \
     -L"../../../../../libs/QCustomPlot/lib" \
@@ -13,6 +14,8 @@ LIBS += -L"../../../../../libs/OpenXLSX-master/lib" \
     -liir_static \
     -l/"$(INHERIT)/" \
     -lOpenXLSX
+# zlib for ZipWriter, bundled with Qt on Windows
+unix:LIBS += -lz
 DEPENDPATH += .
 MOC_DIR += .
 OBJECTS_DIR += release
@@ -0,0 +1,219 @@
+#include "SensorEmulator.h"
+
+#include <QTcpServer>
+#include <QTcpSocket>
+#include <QTimer>
+#include <QUrl>
+#include <QUrlQuery>
+#include <QWebSocket>
+#include <QWebSocketServer>
+#include <nlohmann/json.h>
+#include <algorithm>
+#include "SignalPipeline.h"
+
+namespace {
+	auto constexpr SAMPLE_TIMER_INTERVAL = 10;		// ms
+	auto constexpr MAX_REQUEST_SIZE = 8192;
+	auto constexpr REFERENCE_LED_CURRENT = 8;		// 27.1 mA, nominal amplitude of SyntheticPpg
+	const double LED_CURRENT_MA[] = {
+		0.0, 4.4, 7.6, 11.0, 14.2, 17.4, 20.8, 24.0, 27.1, 30.6, 33.8, 37.0, 40.2, 43.6, 46.8, 50.0
+	};
+
+	QByteArray httpResponse(int status, const QByteArray & reason, const QByteArray & contentType,
+		const QByteArray & body)
+	{
+		return "HTTP/1.1 " + QByteArray::number(status) + " " + reason + "\r\n"
+			"Content-Type: " + contentType + "\r\n"
+			"Content-Length: " + QByteArray::number(body.size()) + "\r\n"
+			"Connection: keep-alive\r\n"
+			"\r\n" + body;
+	}
+
+	QByteArray toJson(const SensorFrame & frame) {
+		auto rows = nlohmann::json::array();
+		auto seq = frame.getSeq();
+		for (auto & sample : frame.getSamples())
+			rows.push_back({ { "seq", seq++ }, { "ms", sample.getMs() },
+				{ "ir", sample.getIrLed() }, { "red", sample.getRedLed() } });
+		return QByteArray::fromStdString(rows.dump());
+	}
+}
+
+SensorEmulator::SensorEmulator(const EmulatorConfig & config_, QObject * parent)
+	: QObject(parent),
+	config(config_),
+	ppg(config_.heartRate, config_.seed),
+	rng(config_.seed)
+{
+	ppg.setMotionArtifacts(config.artifactsPerMinute, 3000.0);
+	server = new QTcpServer(this);
+	wsServer = new QWebSocketServer("HRSensor", QWebSocketServer::NonSecureMode, this);
+	sampleTimer = new QTimer(this);
+	connect(server, &QTcpServer::newConnection, this, &SensorEmulator::newConnection);
+	connect(wsServer, &QWebSocketServer::newConnection, this, &SensorEmulator::newWebSocketConnection);
+	connect(sampleTimer, &QTimer::timeout, this, &SensorEmulator::generateSamples);
+	sampleTimer->setInterval(SAMPLE_TIMER_INTERVAL);
+}
+
+bool SensorEmulator::listen(const QHostAddress & address, quint16 port) {
+	if (!server->listen(address, port))
+		return false;
+	uptime.start();
+	sampleTimer->start();
+	return true;
+}
+
+quint16 SensorEmulator::port() const {
+	return server->serverPort();
+}
+
+void SensorEmulator::newConnection() {
+	while (server->hasPendingConnections()) {
+		auto socket = server->nextPendingConnection();
+		connect(socket, &QTcpSocket::readyRead, this, &SensorEmulator::readRequests);
+		connect(socket, &QTcpSocket::disconnected, socket, &QObject::deleteLater);
+	}
+}
+
+void SensorEmulator::newWebSocketConnection() {
+	while (wsServer->hasPendingConnections()) {
+		auto client = wsServer->nextPendingConnection();
+		clients.append(client);
+		connect(client, &QWebSocket::disconnected, this, [this, client]() {
+			clients.removeAll(client);
+			client->deleteLater();
+		});
+	}
+}
+
+void SensorEmulator::readRequests() {
+	auto socket = qobject_cast<QTcpSocket *>(sender());
+	if (!socket)
+		return;
+	while (socket->bytesAvailable() > 0) {
+		auto pending = socket->peek(socket->bytesAvailable());
+		auto end = pending.indexOf("\r\n\r\n");
+		if (end < 0) {
+			if (pending.size() > MAX_REQUEST_SIZE)
+				socket->abort();
+			return;
+		}
+		if (pending.startsWith("GET /ws ") || pending.startsWith("GET /ws?")) {
+			// the handshake stays in the socket, the WebSocket server reads it itself
+			socket->disconnect();
+			wsServer->handleConnection(socket);
+			return;
+		}
+
+		// the response is built right away, like the module reading its buffer
+		auto response = handleRequest(socket->read(end + 4));
+		++stats.requests;
+		// the module never answers, the connection stays open until the client gives up
+		if (hung())
+			continue;
+		auto drop = dropped();
+		QTimer::singleShot(responseDelay(), socket, [socket, response, drop]() {
+			if (drop)
+				socket->abort();
+			else
+				socket->write(response);
+		});
+	}
+}
+
+QByteArray SensorEmulator::handleRequest(const QByteArray & head) {
+	auto requestLine = head.left(head.indexOf("\r\n")).split(' ');
+	if (requestLine.size() < 2 || requestLine[0] != "GET")
+		return httpResponse(404, "Not Found", "text/plain", "Not found");
+
+	QUrl url(QString::fromLatin1(requestLine[1]));
+	QUrlQuery query(url);
+	auto path = url.path();
+	if (path == "/" || (path == "/bin" && config.binaryEnabled)) {
+		auto frame = frameSince(firstRequestedSeq(query.queryItemValue("since")));
+		if (path == "/bin")
+			return httpResponse(200, "OK", "application/octet-stream", frame.toBinary());
+		return httpResponse(200, "OK", "application/json", toJson(frame));
+	}
+	if (path == "/set_led_current") {
+		if (query.hasQueryItem("ir"))
+			irLedCurrent = std::clamp(query.queryItemValue("ir").toInt(), 0, 15);
+		if (query.hasQueryItem("red"))
+			redLedCurrent = std::clamp(query.queryItemValue("red").toInt(), 0, 15);
+		return httpResponse(200, "OK", "application/json", "{\"status\":\"OK\"}");
+	}
+	return httpResponse(404, "Not Found", "text/plain", "Not found");
+}
+
+quint32 SensorEmulator::firstRequestedSeq(const QString & since) const {
+	quint32 oldest = sampleSeq < BUFF_SIZE ? 0 : sampleSeq - BUFF_SIZE;
+	if (since.isEmpty())
+		return oldest;
+	auto seq = since.toUInt();
+	return (seq < oldest || seq > sampleSeq) ? oldest : seq;
+}
+
+SensorFrame SensorEmulator::frameSince(quint32 first) const {
+	std::vector<SensorData> samples;
+	samples.reserve(sampleSeq - first);
+	for (auto seq = first; seq != sampleSeq; ++seq)
+		samples.push_back(buffer[seq % BUFF_SIZE]);
+	return SensorFrame(first, std::move(samples));
+}
+
+int SensorEmulator::responseDelay() {
+	if (config.jitterMs <= 0)
+		return config.latencyMs;
+	return config.latencyMs + std::uniform_int_distribution<int>(0, config.jitterMs)(rng);
+}
+
+bool SensorEmulator::dropped() {
+	if (config.dropRate <= 0.0 || uniform(rng) >= config.dropRate)
+		return false;
+	++stats.dropped;
+	return true;
+}
+
+bool SensorEmulator::hung() {
+	if (config.hangRate <= 0.0 || uniform(rng) >= config.hangRate)
+		return false;
+	++stats.hung;
+	return true;
+}
+
+int SensorEmulator::sampleValue(int value, int ledCurrent) const {
+	auto scaled = value * LED_CURRENT_MA[ledCurrent] / LED_CURRENT_MA[REFERENCE_LED_CURRENT];
+	return std::clamp(int(scaled), 0, 0xFFFF);
+}
+
+void SensorEmulator::generateSamples() {
+	// the clock of the module runs faster or slower than the system clock
+	auto deviceMs = qint64(uptime.nsecsElapsed() / 1e6 * (1.0 + config.clockDriftPpm * 1e-6));
+	while (nextSampleMs <= deviceMs) {
+		auto sample = ppg.nextFrame(1).getSamples().front();
+		buffer[sampleSeq % BUFF_SIZE] = SensorData(
+			sample.getMs(),
+			sampleValue(sample.getIrLed(), irLedCurrent),
+			sampleValue(sample.getRedLed(), redLedCurrent)
+		);
+		++sampleSeq;
+		++stats.samples;
+		nextSampleMs = qint64(sampleSeq * 1000.0 / SAMPLING_RATE);
+
+		if (sampleSeq - wsSentSeq < WS_PUSH_SAMPLES)
+			continue;
+		if (!clients.isEmpty() && !dropped()) {
+			quint32 oldest = sampleSeq < BUFF_SIZE ? 0 : sampleSeq - BUFF_SIZE;
+			auto message = frameSince(std::max(wsSentSeq, oldest)).toBinary();
+			// frames must not overtake each other, so the jitter never moves one before the previous
+			auto dueMs = std::max(uptime.elapsed() + responseDelay(), lastWsDueMs);
+			lastWsDueMs = dueMs;
+			for (auto client : clients) {
+				QTimer::singleShot(int(dueMs - uptime.elapsed()), client, [client, message]() {
+					client->sendBinaryMessage(message);
+				});
+			}
+		}
+		wsSentSeq = sampleSeq;
+	}
+}
@@ -0,0 +1,125 @@
+#pragma once
+
+#include <QElapsedTimer>
+#include <QHostAddress>
+#include <QObject>
+#include <QList>
+#include <array>
+#include <random>
+#include "SensorData.h"
+#include "SensorFrame.h"
+#include "SyntheticPpg.h"
+
+class QTcpServer;
+class QTcpSocket;
+class QTimer;
+class QWebSocket;
+class QWebSocketServer;
+
+/**
+ * Parametry emulowanego modułu oraz sieci.
+ */
+struct EmulatorConfig {
+	double heartRate = 72.0;			/**< Puls sygnału syntetycznego w bpm. */
+	unsigned int seed = 0;				/**< Ziarno generatora szumu. */
+	int latencyMs = 0;					/**< Stałe opóźnienie odpowiedzi. */
+	int jitterMs = 0;					/**< Maksymalne losowe opóźnienie dodawane do latencyMs. */
+	double dropRate = 0.0;				/**< Prawdopodobieństwo utraty odpowiedzi, od 0 do 1. */
+	double hangRate = 0.0;				/**< Prawdopodobieństwo zawieszenia odpowiedzi, od 0 do 1. */
+	double clockDriftPpm = 0.0;			/**< Odchyłka zegara modułu w ppm, dodatnia - zegar się spieszy. */
+	double artifactsPerMinute = 0.0;	/**< Średnia liczba artefaktów ruchowych na minutę. */
+	bool binaryEnabled = true;			/**< false - emulacja starszego oprogramowania bez adresu /bin. */
+};
+
+/**
+ * Klasa emulująca moduł HRSensor (telemed_esp.ino) na lokalnym porcie TCP.
+ * Obsługiwane są te same adresy co w module:
+ *	- / i /bin - próbki z bufora cyklicznego (BUFF_SIZE próbek) od numeru sekwencyjnego since,
+ *	- /set_led_current - ustawienie prądu diod, od którego zależy amplituda sygnału,
+ *	- /ws - kanał WebSocket wysyłający ramki co WS_PUSH_SAMPLES próbek.
+ * Próbki generowane są z częstotliwością SAMPLING_RATE według zegara modułu, który może odbiegać
+ * od zegara systemowego o clockDriftPpm. Odpowiedzi wysyłane są z opóźnieniem, utrata odpowiedzi
+ * emulowana jest zerwaniem połączenia, a zawieszenie - pozostawieniem otwartego połączenia bez odpowiedzi,
+ * które DeviceApi przerywa po DATA_REQUEST_TIMEOUT.
+ */
+class SensorEmulator : public QObject
+{
+	Q_OBJECT
+public:
+	static constexpr int BUFF_SIZE = 130;		/**< Rozmiar bufora cyklicznego, jak w module. */
+	static constexpr int WS_PUSH_SAMPLES = 5;	/**< Liczba próbek wysyłanych w pojedynczej ramce WebSocket. */
+
+	/**
+	 * Statystyki emulatora.
+	 */
+	struct Stats {
+		quint64 requests = 0;	/**< Liczba obsłużonych żądań HTTP. */
+		quint64 dropped = 0;	/**< Liczba utraconych odpowiedzi i ramek WebSocket. */
+		quint64 hung = 0;		/**< Liczba zawieszonych odpowiedzi. */
+		quint64 samples = 0;	/**< Liczba wygenerowanych próbek. */
+	};
+
+private:
+	EmulatorConfig config;
+	QTcpServer * server;
+	QWebSocketServer * wsServer;
+	QTimer * sampleTimer;
+	QElapsedTimer uptime;
+	SyntheticPpg ppg;
+	std::mt19937 rng;
+	std::uniform_real_distribution<double> uniform{ 0.0, 1.0 };
+
+	std::array<SensorData, BUFF_SIZE> buffer;
+	quint32 sampleSeq = 0;
+	quint32 wsSentSeq = 0;
+	qint64 nextSampleMs = 0;
+	int irLedCurrent = 0;
+	int redLedCurrent = 0;
+	QList<QWebSocket *> clients;
+	qint64 lastWsDueMs = 0;
+	Stats stats;
+
+	quint32 firstRequestedSeq(const QString & since) const;
+	SensorFrame frameSince(quint32 first) const;
+	QByteArray handleRequest(const QByteArray & head);
+	int responseDelay();
+	bool dropped();
+	bool hung();
+	int sampleValue(int value, int ledCurrent) const;
+
+private slots:
+	void newConnection();
+	void newWebSocketConnection();
+	void readRequests();
+	void generateSamples();
+
+public:
+	/**
+	 * Konstruktor inicjalizujący.
+	 * @param config_ Parametry emulowanego modułu.
+	 * @param parent Przodek obiektu.
+	 */
+	SensorEmulator(const EmulatorConfig & config_, QObject * parent = nullptr);
+
+	/**
+	 * Uruchamia serwer, od tej chwili liczony jest czas pracy modułu.
+	 * @param address Adres, na którym nasłuchuje serwer.
+	 * @param port Port serwera.
+	 * @return false jeżeli portu nie udało się otworzyć.
+	 */
+	bool listen(const QHostAddress & address, quint16 port);
+
+	/**
+	 * Getter.
+	 * @return Port, na którym nasłuchuje serwer.
+	 */
+	quint16 port() const;
+
+	/**
+	 * Getter.
+	 * @return Statystyki emulatora.
+	 */
+	const Stats & getStats() const {
+		return stats;
+	}
+};
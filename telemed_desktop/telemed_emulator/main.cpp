@@ -0,0 +1,111 @@
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QDebug>
+#include <QHostAddress>
+#include <QTimer>
+#include <QTextStream>
+#include <nlohmann/json.h>
+#include <csignal>
+#include <random>
+#include <vector>
+#include "SensorEmulator.h"
+
+namespace {
+	auto constexpr STOP_POLL_INTERVAL = 200;	// ms
+
+	volatile std::sig_atomic_t stopRequested = 0;
+
+	void requestStop(int) {
+		stopRequested = 1;
+	}
+}
+
+int main(int argc, char *argv[])
+{
+	QCoreApplication a(argc, argv);
+	QCoreApplication::setApplicationName("telemed_emulator");
+
+	QCommandLineParser parser;
+	parser.setApplicationDescription(
+		"Emulator of HRSensor modules serving a synthetic PPG signal, one module per port.");
+	parser.addHelpOption();
+	QCommandLineOption listenOpt("listen", "Address the modules listen on.", "address", "127.0.0.1");
+	QCommandLineOption portOpt({ "p", "port" }, "Port of the first module, next modules use next ports.", "port", "8080");
+	QCommandLineOption countOpt({ "n", "count" }, "Number of emulated modules.", "n", "1");
+	QCommandLineOption hrOpt("heart-rate", "Heart rate of the synthetic signal in bpm.", "bpm", "72");
+	QCommandLineOption hrSpreadOpt("heart-rate-spread", "Heart rate of each module differs randomly by up to this value.", "bpm", "0");
+	QCommandLineOption latencyOpt("latency", "Delay of every response in ms.", "ms", "0");
+	QCommandLineOption jitterOpt("jitter", "Random delay added to the latency, up to this value in ms.", "ms", "0");
+	QCommandLineOption dropOpt("drop", "Fraction of responses lost, from 0 to 1.", "fraction", "0");
+	QCommandLineOption hangOpt("hang", "Fraction of responses never sent, the connection stays open, from 0 to 1.", "fraction", "0");
+	QCommandLineOption driftOpt("drift", "Clock of each module drifts randomly by up to this value in ppm.", "ppm", "0");
+	QCommandLineOption artifactsOpt("artifacts", "Motion artifacts per minute.", "count", "0");
+	QCommandLineOption jsonOnlyOpt("json-only", "Emulate firmware without binary frames (/bin returns 404).");
+	QCommandLineOption seedOpt("seed", "Seed of the random generators.", "n", "0");
+	parser.addOptions({ listenOpt, portOpt, countOpt, hrOpt, hrSpreadOpt, latencyOpt, jitterOpt, dropOpt, hangOpt,
+		driftOpt, artifactsOpt, jsonOnlyOpt, seedOpt });
+	parser.process(a);
+
+	QHostAddress address(parser.value(listenOpt));
+	auto firstPort = parser.value(portOpt).toUShort();
+	auto count = std::max(1, parser.value(countOpt).toInt());
+	auto seed = parser.value(seedOpt).toUInt();
+	std::mt19937 rng(seed);
+	std::uniform_real_distribution<double> spread(-1.0, 1.0);
+
+	QTextStream out(stdout);
+	std::vector<SensorEmulator *> emulators;
+	for (int i = 0; i < count; ++i) {
+		EmulatorConfig config;
+		config.heartRate = parser.value(hrOpt).toDouble() + parser.value(hrSpreadOpt).toDouble() * spread(rng);
+		config.seed = seed + unsigned(i);
+		config.latencyMs = parser.value(latencyOpt).toInt();
+		config.jitterMs = parser.value(jitterOpt).toInt();
+		config.dropRate = parser.value(dropOpt).toDouble();
+		config.hangRate = parser.value(hangOpt).toDouble();
+		config.clockDriftPpm = parser.value(driftOpt).toDouble() * spread(rng);
+		config.artifactsPerMinute = parser.value(artifactsOpt).toDouble();
+		config.binaryEnabled = !parser.isSet(jsonOnlyOpt);
+
+		auto emulator = new SensorEmulator(config, &a);
+		auto port = quint16(firstPort + i);
+		if (!emulator->listen(address, port)) {
+			qCritical() << "Cannot listen on port" << port;
+			return 1;
+		}
+		emulators.push_back(emulator);
+
+		nlohmann::json line = {
+			{ "device", QString("%1:%2").arg(address.toString()).arg(port).toStdString() },
+			{ "heart_rate", config.heartRate },
+			{ "drift_ppm", config.clockDriftPpm }
+		};
+		out << QString::fromStdString(line.dump()) << '\n';
+	}
+	out.flush();
+
+	std::signal(SIGINT, requestStop);
+	std::signal(SIGTERM, requestStop);
+	QTimer stopTimer;
+	QObject::connect(&stopTimer, &QTimer::timeout, [] {
+		if (stopRequested)
+			QCoreApplication::quit();
+	});
+	stopTimer.start(STOP_POLL_INTERVAL);
+
+	auto rc = a.exec();
+
+	for (auto emulator : emulators) {
+		auto & stats = emulator->getStats();
+		nlohmann::json line = {
+			{ "device", QString("%1:%2").arg(address.toString()).arg(emulator->port()).toStdString() },
+			{ "requests", stats.requests },
+			{ "dropped", stats.dropped },
+			{ "hung", stats.hung },
+			{ "samples", stats.samples }
+		};
+		out << QString::fromStdString(line.dump()) << '\n';
+	}
+	out.flush();
+	return rc;
+}
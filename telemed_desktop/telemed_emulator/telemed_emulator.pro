@@ -0,0 +1,25 @@
+# ----------------------------------------------------
+# Emulator of HRSensor modules serving a synthetic
+# PPG signal over HTTP and WebSocket, for load tests.
+# ------------------------------------------------------
+
+TEMPLATE = app
+TARGET = telemed_emulator
+DESTDIR = ../Release
+CONFIG += console release
+CONFIG -= app_bundle
+QT += core network websockets
+QT -= gui
+INCLUDEPATH += ../telemed_desktop \
+    "../../../../../libs/json/include"
+DEPENDPATH += . ../telemed_desktop
+MOC_DIR += .
+OBJECTS_DIR += release
+HEADERS += ./SensorEmulator.h \
+    ../telemed_desktop/SensorData.h \
+    ../telemed_desktop/SensorFrame.h \
+    ../telemed_desktop/SyntheticPpg.h
+SOURCES += ./main.cpp \
+    ./SensorEmulator.cpp \
+    ../telemed_desktop/SensorFrame.cpp \
+    ../telemed_desktop/SyntheticPpg.cpp
@@ -11,17 +11,25 @@
 #define PULSE_WIDTH         MAX30100_SPC_PW_1600US_16BITS	/**< Dokadno pomieru, 16 bitw. */
 #define HIGHRES_MODE        true
 #define BUFF_SIZE			130
+#define FRAME_VERSION		1								/**< Wersja formatu ramki binarnej. */
+#define FRAME_HEADER_SIZE	14								/**< Rozmiar nagwka ramki binarnej w bajtach. */
+#define FRAME_SAMPLE_SIZE	6								/**< Rozmiar pojedynczej prbki w ramce binarnej w bajtach. */
+#define WS_PUSH_SAMPLES		5								/**< Liczba prbek wysyanych w pojedynczej ramce WebSocket. */
 
 const char* ssid     = "HRSensor";		/**< SSID udostpnianej sieci. */
 const char* password = "123456789";		/**< Haso sieci. */
 
 AsyncWebServer server(80);				/**< Asynchroniczny obiekt na porcie 80. */
+AsyncWebSocket ws("/ws");				/**< Kana WebSocket do strumieniowego wysyania prbek. */
 MAX30100 sensor;						/**< Obiekt sonsora MAX30100. */
 
 uint8_t buffCurrId = 0;						/**< Id obecnej komrki w buforze. */
 unsigned long buffMs[BUFF_SIZE] = { 0 };	/**< Bufor milisekund. */
 uint16_t buffIrVals[BUFF_SIZE] = { 0 };		/**< Bufor warto diody podczerwonej. */
 uint16_t buffRedVals[BUFF_SIZE] = { 0 };	/**< Bufor warto diody czerwonej. */
+uint32_t sampleSeq = 0;						/**< Numer sekwencyjny kolejnej prbki, rwny liczbie odczytanych prbek. */
+uint8_t frameBuff[FRAME_HEADER_SIZE + FRAME_SAMPLE_SIZE * BUFF_SIZE];	/**< Bufor ramki binarnej. */
+uint32_t wsSentSeq = 0;						/**< Numer sekwencyjny pierwszej prbki jeszcze nie wysanej przez WebSocket. */
 
 LEDCurrent	irLedCurrent = IR_LED_CURRENT,		/**< Zmienna wartoci prdu diody podczerwonej. */
 			redLedCurrent = RED_LED_CURRENT;	/**< Zmienna wartoci prdu diody czerwonej. */
@@ -45,30 +53,137 @@ void setLedCurrentRequest(AsyncWebServerRequest * request) {
 	request->send(200, "application/json", "{\"status\":\"OK\"}");
 }
 
+/**
+ * Funkcja wyznaczajca numer sekwencyjny pierwszej prbki do wysania.
+ * Klient przekazuje w parametrze since numer pierwszej prbki ktrej jeszcze nie otrzyma.
+ * Jeeli prbka nie jest ju dostpna w buforze, lub numer jest wikszy od numeru kolejnej prbki
+ * (np. po restarcie moduu), zwracany jest numer najstarszej prbki w buforze.
+ * @param request Obiekt dania.
+ * @return Numer sekwencyjny pierwszej prbki.
+ */
+uint32_t firstRequestedSeq(AsyncWebServerRequest * request) {
+	uint32_t oldest = sampleSeq < BUFF_SIZE ? 0 : sampleSeq - BUFF_SIZE;
+	if (!request->hasParam("since"))
+		return oldest;
+	uint32_t since = strtoul(request->getParam("since")->value().c_str(), NULL, 10);
+	return (since < oldest || since > sampleSeq) ? oldest : since;
+}
+
 /**
  * Funkcja obsugujca adania typu GET przychodzce na adres:
- * <pre>http://192.168.4.1/</pre>.
- * dania pobrania dancyh z bufora.
+ * <pre>http://192.168.4.1/?since=seq</pre>.
+ * dania pobrania dancyh z bufora, prbki od numeru sekwencyjnego since.
  * @param request Obiekt dania.
  */
 void dataRequest(AsyncWebServerRequest * request) {
+	uint32_t last = sampleSeq;
 	String str = "[";
-	for (uint8_t i = 0; i < BUFF_SIZE; ++i) {
+	for (uint32_t seq = firstRequestedSeq(request); seq != last; ++seq) {
+		uint8_t i = seq % BUFF_SIZE;
 		str += "{";
+		str += "\"seq\":" + String(seq) + ",";
 		str += "\"ms\":" + String(buffMs[i]) + ",";
 		str += "\"ir\":" + String(buffIrVals[i]) + ",";
 		str += "\"red\":" + String(buffRedVals[i]) + "}";
-		if(i != (BUFF_SIZE-1)) str += ",";
+		if(seq + 1 != last) str += ",";
 	}
 	str += "]";
 	request->send(200, "application/json", str.c_str());
 }
 
+/**
+ * Funkcja zapisujca liczb 16 bitow w kolejnoci little-endian.
+ */
+void putU16(uint8_t * dst, uint16_t val) {
+	dst[0] = val & 0xFF;
+	dst[1] = val >> 8;
+}
+
+/**
+ * Funkcja zapisujca liczb 32 bitow w kolejnoci little-endian.
+ */
+void putU32(uint8_t * dst, uint32_t val) {
+	putU16(dst, val & 0xFFFF);
+	putU16(dst + 2, val >> 16);
+}
+
+/**
+ * Funkcja kodujca prbki z bufora do ramki binarnej.
+ * Format ramki (little-endian):
+ *	- 'T', 'M', wersja (uint8_t), zarezerwowany (uint8_t),
+ *	- liczba prbek (uint16_t),
+ *	- numer sekwencyjny pierwszej prbki (uint32_t),
+ *	- stempel czasowy pierwszej prbki w milisekundach (uint32_t),
+ *	- prbki: przyrost czasu wzgldem poprzedniej prbki w ms (uint16_t), ir (uint16_t), red (uint16_t).
+ * @param first Numer sekwencyjny pierwszej prbki.
+ * @param count Liczba prbek.
+ * @return Rozmiar ramki w bajtach.
+ */
+size_t encodeFrame(uint32_t first, uint16_t count) {
+	uint8_t * p = frameBuff;
+	*p++ = 'T';
+	*p++ = 'M';
+	*p++ = FRAME_VERSION;
+	*p++ = 0;
+	putU16(p, count);
+	p += 2;
+	putU32(p, first);
+	p += 4;
+	unsigned long prevMs = buffMs[first % BUFF_SIZE];
+	putU32(p, prevMs);
+	p += 4;
+	for (uint32_t seq = first; seq != first + count; ++seq) {
+		uint8_t id = seq % BUFF_SIZE;
+		unsigned long delta = buffMs[id] - prevMs;
+		putU16(p, delta > 0xFFFF ? 0xFFFF : delta);
+		p += 2;
+		putU16(p, buffIrVals[id]);
+		p += 2;
+		putU16(p, buffRedVals[id]);
+		p += 2;
+		prevMs = buffMs[id];
+	}
+	return p - frameBuff;
+}
+
+/**
+ * Funkcja obsugujca adania typu GET przychodzce na adres:
+ * <pre>http://192.168.4.1/bin?since=seq</pre>.
+ * dania pobrania danych z bufora w postaci ramki binarnej, prbki od numeru sekwencyjnego since.
+ * @param request Obiekt dania.
+ * @see encodeFrame
+ */
+void dataBinRequest(AsyncWebServerRequest * request) {
+	uint32_t first = firstRequestedSeq(request);
+	size_t len = encodeFrame(first, sampleSeq - first);
+	AsyncResponseStream * response = request->beginResponseStream("application/octet-stream", len);
+	response->write(frameBuff, len);
+	request->send(response);
+}
+
+/**
+ * Funkcja wysyajca nowe prbki do wszystkich klientw WebSocket.
+ * Ramka wysyana jest co WS_PUSH_SAMPLES prbek, w formacie identycznym z adresem /bin.
+ * @see encodeFrame
+ */
+void pushNewSamples() {
+	if (sampleSeq - wsSentSeq < WS_PUSH_SAMPLES)
+		return;
+	if (ws.count()) {
+		uint32_t oldest = sampleSeq < BUFF_SIZE ? 0 : sampleSeq - BUFF_SIZE;
+		uint32_t first = wsSentSeq < oldest ? oldest : wsSentSeq;
+		size_t len = encodeFrame(first, sampleSeq - first);
+		ws.binaryAll(frameBuff, len);
+	}
+	wsSentSeq = sampleSeq;
+	ws.cleanupClients();
+}
+
 /**
  * Funkcja inicjalizujca:
  *	- Access Point,
  *	- Czujnik MAX30100,
- *	- Serwer.
+ *	- Serwer wraz z kanaem WebSocket.
  */
 void setup(){
 	Serial.begin(115200);
@@ -84,7 +199,9 @@ void setup(){
 	sensor.setHighresModeEnabled(HIGHRES_MODE);
 
 	server.on("/", HTTP_GET, dataRequest);
+	server.on("/bin", HTTP_GET, dataBinRequest);
 	server.on("/set_led_current", HTTP_GET, setLedCurrentRequest);
+	server.addHandler(&ws);
 	server.begin();
 }
  
@@ -100,6 +217,8 @@ void loop(){
 		buffIrVals[buffCurrId] = ir;
 		buffRedVals[buffCurrId] = red;
 		buffCurrId = (++buffCurrId % BUFF_SIZE);
+		++sampleSeq;
+		pushNewSamples();
 	}
 	delay(5);
 }
\ No newline at end of file